@@ -4,13 +4,19 @@
 #
 #-------------------------------------------------
 
-QT       += core gui opengl xml
+QT       += core gui opengl
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = 3DMarker
 TEMPLATE = app
 
+# Offscreen bookmark thumbnails (--thumbnails) need OSMesa: qmake CONFIG+=osmesa
+osmesa {
+    DEFINES += HAVE_OSMESA
+    LIBS += -lOSMesa
+}
+
 SOURCES += main.cpp\
         mainwindow.cpp \
     vertex.cpp \
@@ -19,7 +25,27 @@ SOURCES += main.cpp\
     model.cpp \
     bookmark.cpp \
     bookmarklist.cpp \
-    plyimporter.cpp
+    plyimporter.cpp \
+    camera.cpp \
+    raypicker.cpp \
+    projectedfacegrid.cpp \
+    meshclusters.cpp \
+    glscene.cpp \
+    thumbnailrenderer.cpp \
+    profiler.cpp \
+    modelloader.cpp \
+    lodmesh.cpp \
+    renderthread.cpp \
+    bookmarklabels.cpp \
+    labelmesh.cpp \
+    meshedges.cpp \
+    faceselection.cpp \
+    selectionhistory.cpp \
+    faceadjacency.cpp \
+    regiongrow.cpp \
+    geodesicbrush.cpp \
+    bookmarkindex.cpp \
+    bookmarkjournal.cpp
 
 HEADERS  += mainwindow.h \
     vertex.h \
@@ -29,7 +55,28 @@ HEADERS  += mainwindow.h \
     bookmark.h \
     bookmarklist.h \
     plyimporter.h \
-    modelimporter.h
+    modelimporter.h \
+    camera.h \
+    raypicker.h \
+    projectedfacegrid.h \
+    meshclusters.h \
+    glscene.h \
+    thumbnailrenderer.h \
+    profiler.h \
+    modelloader.h \
+    lodmesh.h \
+    renderthread.h \
+    bookmarklabels.h \
+    labelmesh.h \
+    meshedges.h \
+    faceselection.h \
+    selectionhistory.h \
+    faceadjacency.h \
+    regiongrow.h \
+    geodesicbrush.h \
+    bookmarkindex.h \
+    bookmarkjournal.h \
+    parallel.h
 
 FORMS    += mainwindow.ui
 
@@ -1,10 +1,42 @@
 #include "bookmark.h"
 
-Bookmark::Bookmark(QString name, QString comments, std::set<unsigned int> faces)
+#include <algorithm>
+#include <vector>
+#include <QByteArray>
+
+Bookmark::Bookmark(QString name, QString comments, const FaceSelection &faces)
 {
     _name = name;
     _comments = comments;
-    _faces.insert(faces.begin(), faces.end());
+    _faces = faces;
+    _hasOutline = false;
+    _packed = 0;
+    _packedSize = 0;
+    _compressed = false;
+    _limit = -1;
+    _id = 0;
+}
+
+Bookmark::Bookmark(QString name, QString comments, const char *packed, unsigned int size, bool compressed, int limit)
+{
+    _name = name;
+    _comments = comments;
+    _hasOutline = false;
+    _packed = packed;
+    _packedSize = size;
+    _compressed = compressed;
+    _limit = limit;
+    _id = 0;
+}
+
+unsigned int Bookmark::getId()
+{
+    return _id;
+}
+
+void Bookmark::setId(unsigned int id)
+{
+    _id = id;
 }
 
 QString Bookmark::getName()
@@ -27,13 +59,71 @@ void Bookmark::setComments(QString comments)
     _comments = comments;
 }
 
-std::set<unsigned int>* Bookmark::getFaces()
+FaceSelection* Bookmark::getFaces()
 {
+    decode();
     return &_faces;
 }
 
-void Bookmark::setFaces(std::set<unsigned int> faces)
+void Bookmark::setFaces(const FaceSelection &faces)
+{
+    _faces = faces;
+    _packed = 0;
+    clearOutline();
+}
+
+bool Bookmark::isDecoded()
+{
+    return _packed == 0;
+}
+
+void Bookmark::decode()
+{
+    if ( !_packed )
+        return;
+
+    bool valid;
+    if ( _compressed )
+    {
+        QByteArray data = qUncompress(reinterpret_cast<const uchar*>(_packed), _packedSize);
+        valid = _faces.deserialize(data.constData(), data.size());
+    }
+    else
+        valid = _faces.deserialize(_packed, _packedSize);
+    _packed = 0;
+
+    if ( !valid )
+        qWarning("Bookmark %s: invalid face data.", qPrintable(_name));
+
+    if ( _limit >= 0 )
+    {
+        // Faces are sorted, the ones out of the model are at the end.
+        std::vector<unsigned int> faces;
+        _faces.toVector(&faces);
+        faces.erase(std::upper_bound(faces.begin(), faces.end(), (unsigned int)_limit), faces.end());
+        _faces.clear();
+        _faces.insert(faces);
+    }
+}
+
+bool Bookmark::hasOutline()
+{
+    return _hasOutline;
+}
+
+FaceSelection* Bookmark::getOutline()
+{
+    return &_outline;
+}
+
+void Bookmark::setOutline(const FaceSelection &edges)
+{
+    _outline = edges;
+    _hasOutline = true;
+}
+
+void Bookmark::clearOutline()
 {
-    _faces.clear();
-    _faces.insert(faces.begin(), faces.end() );
+    _outline.clear();
+    _hasOutline = false;
 }
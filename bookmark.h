@@ -2,7 +2,7 @@
 #define BOOKMARK_H
 
 #include <QString>
-#include <set>
+#include "faceselection.h"
 
 /**
  * This source file is part of 3DMarker.
@@ -24,6 +24,9 @@
  * @section DESCRIPTION
  *
  * The bookmark class represents a region of 3D model selected by user.
+ * The boundary edges of the region are cached to draw its outline, until
+ * its faces change. Faces of bookmarks opened from a binary file stay
+ * serialized in the mapped file until first used.
  */
 class Bookmark
 {
@@ -31,20 +34,48 @@ private:
 
     QString _name;                               /**< The name of the bookmark. */
     QString _comments;                           /**< The comments of the bookmark. */
-    std::set<unsigned int> _faces;              /**< The face list of the bookmark. */
+    FaceSelection _faces;                        /**< The face list of the bookmark. */
+    FaceSelection _outline;                      /**< Cached boundary edges of the faces. */
+    bool _hasOutline;                            /**< True when the cached outline is valid. */
+    const char* _packed;                         /**< Serialized faces not decoded yet, null when decoded. */
+    unsigned int _packedSize;                    /**< Size of the serialized faces. */
+    bool _compressed;                            /**< True if the serialized faces are compressed with qCompress. */
+    int _limit;                                  /**< Faces above it are dropped when decoded, -1 for none. */
+    unsigned int _id;                            /**< Id given by the bookmark list, kept while the bookmark lives. */
+
+    /**
+     * @brief Decode the serialized faces, if not decoded yet.
+     */
+    void decode();
 
 public:
 
     /**
      * @brief Constructor.
      */
-    Bookmark(QString name, QString comments, std::set<unsigned int> faces);
+    Bookmark(QString name, QString comments, const FaceSelection &faces);
+
+    /**
+     * @brief Constructor. Faces are decoded on first use.
+     * @param packed Serialized faces (see FaceSelection::serialize). Must live until decoded.
+     * @param size Size of the serialized faces.
+     * @param compressed True if the serialized faces are compressed with qCompress.
+     * @param limit Faces above it are dropped when decoded, -1 for none.
+     */
+    Bookmark(QString name, QString comments, const char *packed, unsigned int size, bool compressed, int limit);
+    unsigned int getId();
+    void setId(unsigned int id);
     QString getName();
     void setName(QString name);
     QString getComments();
     void setComments(QString comments);
-    std::set<unsigned int>* getFaces();
-    void setFaces(std::set<unsigned int> faces);
+    FaceSelection* getFaces();                     /**< Decodes the faces on first use. */
+    bool isDecoded();
+    void setFaces(const FaceSelection &faces);     /**< Also drops the cached outline. */
+    bool hasOutline();
+    FaceSelection* getOutline();
+    void setOutline(const FaceSelection &edges);
+    void clearOutline();
 
 };
 
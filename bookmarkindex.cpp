@@ -0,0 +1,114 @@
+#include "bookmarkindex.h"
+
+#include <algorithm>
+
+BookmarkIndex::BookmarkIndex()
+{
+}
+
+void BookmarkIndex::clear()
+{
+    std::vector<unsigned int>().swap(_slots);
+    std::vector<SharedFace>().swap(_shared);
+}
+
+void BookmarkIndex::insert(unsigned int id, const FaceSelection &faces)
+{
+    // New pairs are sorted as faces are, they are merged once.
+    std::vector<SharedFace>::size_type merged = _shared.size();
+    FaceSelection::const_iterator it = faces.begin();
+    for ( ; it != faces.end(); ++it )
+    {
+        unsigned int face = *it;
+        if ( face >= _slots.size() )
+            _slots.resize(std::max(face + 1, (unsigned int)_slots.size() * 2), 0);
+
+        unsigned int &slot = _slots[face];
+        if ( slot == 0 )
+            slot = id + 1;
+        else if ( slot == SHARED )
+            _shared.push_back(SharedFace(face, id));
+        else
+        {
+            // Second bookmark of the face.
+            _shared.push_back(SharedFace(face, std::min(slot - 1, id)));
+            _shared.push_back(SharedFace(face, std::max(slot - 1, id)));
+            slot = SHARED;
+        }
+    }
+
+    if ( merged > 0 && merged < _shared.size() )
+        std::inplace_merge(_shared.begin(), _shared.begin() + merged, _shared.end());
+}
+
+void BookmarkIndex::remove(unsigned int id, const FaceSelection &faces)
+{
+    std::vector<SharedFace> removed;
+    FaceSelection::const_iterator it = faces.begin();
+    for ( ; it != faces.end() && *it < _slots.size(); ++it )
+    {
+        unsigned int &slot = _slots[*it];
+        if ( slot == id + 1 )
+            slot = 0;
+        else if ( slot == SHARED )
+            removed.push_back(SharedFace(*it, id));
+    }
+
+    if ( removed.empty() )
+        return;
+
+    // Pairs kept are moved down in place, face by face.
+    std::vector<SharedFace>::iterator in = _shared.begin();
+    std::vector<SharedFace>::iterator out = _shared.begin();
+    std::vector<SharedFace>::const_iterator gone = removed.begin();
+    while ( in != _shared.end() )
+    {
+        unsigned int face = in->first;
+        std::vector<SharedFace>::iterator first = out;
+        for ( ; in != _shared.end() && in->first == face; ++in )
+        {
+            while ( gone != removed.end() && *gone < *in )
+                ++gone;
+            if ( gone != removed.end() && *gone == *in )
+                ++gone;
+            else
+                *out++ = *in;
+        }
+
+        // Back to a single slot.
+        if ( out - first == 1 )
+        {
+            _slots[face] = first->second + 1;
+            out = first;
+        }
+    }
+    _shared.erase(out, _shared.end());
+}
+
+void BookmarkIndex::find(unsigned int face, std::vector<unsigned int> *ids) const
+{
+    ids->clear();
+    if ( face >= _slots.size() || _slots[face] == 0 )
+        return;
+
+    if ( _slots[face] != SHARED )
+    {
+        ids->push_back(_slots[face] - 1);
+        return;
+    }
+
+    std::vector<SharedFace>::const_iterator it = std::lower_bound(_shared.begin(), _shared.end(), SharedFace(face, 0));
+    for ( ; it != _shared.end() && it->first == face; ++it )
+        ids->push_back(it->second);
+}
+
+bool BookmarkIndex::contains(unsigned int face, unsigned int id) const
+{
+    if ( face >= _slots.size() || _slots[face] == 0 )
+        return false;
+
+    if ( _slots[face] != SHARED )
+        return _slots[face] == id + 1;
+
+    return std::binary_search(_shared.begin(), _shared.end(), SharedFace(face, id));
+}
@@ -0,0 +1,91 @@
+#ifndef BOOKMARKINDEX_H
+#define BOOKMARKINDEX_H
+
+#include <utility>
+#include <vector>
+#include "faceselection.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The BookmarkIndex class is an inverted index from faces to the ids of
+ * the bookmarks containing them. Most faces are in one bookmark or none,
+ * so each face keeps a single slot: no bookmark, the id of its only
+ * bookmark, or SHARED when the face is in several bookmarks. Faces in
+ * several bookmarks are kept as (face, id) pairs in one sorted array, 8
+ * bytes per pair. Each edit merges or removes its pairs in one pass over
+ * the array.
+ */
+class BookmarkIndex
+{
+private:
+
+    typedef std::pair<unsigned int, unsigned int> SharedFace;      /**< Face and id of one of its bookmarks. */
+
+    std::vector<unsigned int> _slots;                               /**< Per face: 0, id + 1 or SHARED. */
+    std::vector<SharedFace> _shared;                                /**< Sorted pairs of faces in several bookmarks. */
+
+    static const unsigned int SHARED = 0xffffffff;                  /**< Slot of faces in several bookmarks. */
+
+public:
+
+    static const unsigned int MAX_ID = 0xfffffffd;                  /**< Largest bookmark id. */
+
+    /**
+     * @brief Default constructor. Empty index.
+     */
+    BookmarkIndex();
+
+    /**
+     * @brief Remove all bookmarks.
+     */
+    void clear();
+
+    /**
+     * @brief Add faces to a bookmark.
+     * @param id Bookmark id, up to MAX_ID.
+     * @param faces Faces not in the bookmark yet.
+     */
+    void insert(unsigned int id, const FaceSelection &faces);
+
+    /**
+     * @brief Remove faces from a bookmark.
+     * @param id Bookmark id.
+     * @param faces Faces in the bookmark.
+     */
+    void remove(unsigned int id, const FaceSelection &faces);
+
+    /**
+     * @brief Return the bookmarks containing a face.
+     * @param face Face index.
+     * @param ids Result bookmark ids, increasing, replaced.
+     */
+    void find(unsigned int face, std::vector<unsigned int> *ids) const;
+
+    /**
+     * @brief Get if a bookmark contains a face.
+     * @param face Face index.
+     * @param id Bookmark id.
+     * @return True if contained, false otherwise.
+     */
+    bool contains(unsigned int face, unsigned int id) const;
+
+};
+
+#endif // BOOKMARKINDEX_H
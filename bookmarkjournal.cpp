@@ -0,0 +1,429 @@
+#include "bookmarkjournal.h"
+
+#include <algorithm>
+#include <string.h>
+#include <QDataStream>
+#include <QDateTime>
+#include "bookmarklist.h"
+
+static const char JOURNAL_MAGIC[4] = { '3', 'D', 'M', 'J' };
+static const int HEADER_SIZE = 16;     // Magic, version, faces and model path size, then the model path.
+
+/**
+ * @brief Return the serialized faces of a selection.
+ */
+static QByteArray facesData(const FaceSelection &faces)
+{
+    QByteArray data(faces.serializedSize(), 0);
+    faces.serialize(data.data());
+    return data;
+}
+
+/**
+ * @brief Read serialized faces, dropping the ones above maxIndex.
+ * @return False if the faces are not valid.
+ */
+static bool readFaces(QDataStream &stream, int maxIndex, int *errors, FaceSelection *faces)
+{
+    QByteArray data;
+    stream >> data;
+    if ( stream.status() != QDataStream::Ok || !faces->deserialize(data.constData(), data.size()) )
+        return false;
+
+    std::vector<unsigned int> list;
+    faces->toVector(&list);
+    std::vector<unsigned int>::iterator valid = maxIndex < 0 ? list.begin()
+            : std::upper_bound(list.begin(), list.end(), (unsigned int)maxIndex);
+
+    if ( valid != list.end() )
+    {
+        *errors += list.end() - valid;
+        list.erase(valid, list.end());
+        faces->clear();
+        faces->insert(list);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Read a bookmark written by logAdd or checkpoint.
+ * @return Bookmark read, null if not valid.
+ */
+static Bookmark* readBookmark(QDataStream &stream, int maxIndex, int *errors)
+{
+    QString name;
+    QString comments;
+    FaceSelection faces;
+    stream >> name >> comments;
+    if ( stream.status() != QDataStream::Ok || !readFaces(stream, maxIndex, errors, &faces) )
+        return 0;
+
+    return new Bookmark(name, comments, faces);
+}
+
+BookmarkJournal::BookmarkJournal()
+{
+    _snapshotSize = 0;
+    _faces = 0;
+#if QT_VERSION >= 0x050100
+    _lock = 0;
+#endif
+}
+
+BookmarkJournal::~BookmarkJournal()
+{
+    close(false);
+}
+
+quint32 BookmarkJournal::checksum(const QByteArray &payload)
+{
+    quint32 hash = 2166136261u;
+    for ( int i = 0; i < payload.size(); ++i )
+        hash = (hash ^ (unsigned char)payload[i]) * 16777619u;
+    return hash;
+}
+
+bool BookmarkJournal::writeHeader(QFile &file) const
+{
+    QByteArray model = _model.toUtf8();
+    quint32 fields[3] = { VERSION, _faces, (quint32)model.size() };
+    QByteArray header(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+    header.append(model);
+    return file.write(header) == header.size();
+}
+
+bool BookmarkJournal::writeRecord(QFile &file, const QByteArray &payload)
+{
+    quint32 header[2] = { (quint32)payload.size(), checksum(payload) };
+    QByteArray record(reinterpret_cast<const char*>(header), sizeof(header));
+    record.append(payload);
+    return file.write(record) == record.size();
+}
+
+bool BookmarkJournal::open(QString path, QString model, unsigned int faces, bool keep)
+{
+    close(false);
+
+#if QT_VERSION >= 0x050100
+    // Locks of crashed instances are stale, they are taken over.
+    _lock = new QLockFile(path + ".lock");
+    if ( !_lock->tryLock(0) )
+    {
+        delete _lock;
+        _lock = 0;
+        return false;
+    }
+#endif
+
+    QFile::remove(path + ".tmp");
+    _model = model;
+    _faces = faces;
+
+    _file.setFileName(path);
+    if ( keep && _file.exists() )
+    {
+        if ( !_file.open(QIODevice::WriteOnly | QIODevice::Append) )
+        {
+            close(false);
+            return false;
+        }
+    }
+    else if ( !_file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !writeHeader(_file) )
+    {
+        close(true);
+        return false;
+    }
+
+    _file.flush();
+    _snapshotSize = _file.size();
+    return true;
+}
+
+bool BookmarkJournal::restart(QString path)
+{
+    QString model = _model;
+    close(true);
+    return open(path, model, _faces);
+}
+
+void BookmarkJournal::close(bool remove)
+{
+#if QT_VERSION >= 0x050100
+    delete _lock;
+    _lock = 0;
+#endif
+
+    if ( !_file.isOpen() )
+        return;
+
+    _file.close();
+    if ( remove )
+        _file.remove();
+}
+
+bool BookmarkJournal::isOpen() const
+{
+    return _file.isOpen();
+}
+
+QString BookmarkJournal::getPath() const
+{
+    return _file.isOpen() ? _file.fileName() : QString();
+}
+
+bool BookmarkJournal::needsCheckpoint() const
+{
+    qint64 size = _file.size();
+    return _file.isOpen() && size > CHECKPOINT_SIZE && size > 2 * _snapshotSize;
+}
+
+bool BookmarkJournal::append(const QByteArray &payload)
+{
+    if ( !_file.isOpen() )
+        return false;
+
+    // Flushed now, a crash of the program does not lose the edit.
+    bool written = writeRecord(_file, payload);
+    _file.flush();
+    return written;
+}
+
+void BookmarkJournal::logAdd(Bookmark *bookmark)
+{
+    if ( !_file.isOpen() )
+        return;
+
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << (quint8)ADD_RECORD << bookmark->getName() << bookmark->getComments()
+           << facesData(*bookmark->getFaces());
+    append(payload);
+}
+
+void BookmarkJournal::logUpdate(unsigned int index, Bookmark *bookmark, const FaceSelection &added, const FaceSelection &removed)
+{
+    if ( !_file.isOpen() )
+        return;
+
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << (quint8)UPDATE_RECORD << (quint32)index << bookmark->getName() << bookmark->getComments()
+           << facesData(added) << facesData(removed);
+    append(payload);
+}
+
+void BookmarkJournal::logDelete(unsigned int index)
+{
+    if ( !_file.isOpen() )
+        return;
+
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << (quint8)DELETE_RECORD << (quint32)index;
+    append(payload);
+}
+
+bool BookmarkJournal::checkpoint(const std::vector<Bookmark*> &bookmarks)
+{
+    if ( !_file.isOpen() )
+        return false;
+
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << (quint8)SNAPSHOT_RECORD << (quint32)bookmarks.size();
+    for ( unsigned int i = 0; i < bookmarks.size(); ++i )
+        stream << bookmarks[i]->getName() << bookmarks[i]->getComments() << facesData(*bookmarks[i]->getFaces());
+
+    // The snapshot replaces the journal once it is complete. A crash after removing the journal leaves the snapshot.
+    QString path = _file.fileName();
+    QFile snapshot(path + ".tmp");
+    if ( !snapshot.open(QIODevice::WriteOnly | QIODevice::Truncate) || !writeHeader(snapshot)
+         || !writeRecord(snapshot, payload) )
+    {
+        snapshot.close();
+        snapshot.remove();
+        return false;
+    }
+    snapshot.close();
+
+    _file.close();
+    bool replaced = QFile::remove(path) && QFile::rename(snapshot.fileName(), path);
+    if ( replaced || QFile::exists(path) )
+    {
+        // Either compacted, or the journal could not be removed and is still complete.
+        QFile::remove(snapshot.fileName());
+    }
+    else
+    {
+        // Not renamed: the snapshot is written again as the journal. Until then, or
+        // if it fails, the .tmp copy is the journal and no partial file shadows it.
+        _file.setFileName(path);
+        replaced = _file.open(QIODevice::WriteOnly | QIODevice::Truncate) && writeHeader(_file)
+                && writeRecord(_file, payload);
+        _file.close();
+        QFile::remove(replaced ? snapshot.fileName() : path);
+    }
+
+    // Without a journal file, journaling stops. The edits so far are left in the .tmp snapshot.
+    _file.setFileName(path);
+    if ( !QFile::exists(path) || !_file.open(QIODevice::WriteOnly | QIODevice::Append) )
+    {
+        close(false);
+        return false;
+    }
+
+    _snapshotSize = _file.size();
+    return replaced;
+}
+
+bool BookmarkJournal::readRecords(QString path, std::vector<QByteArray> *records, QString *model, unsigned int *faces)
+{
+    records->clear();
+
+    // A crash between removing a compacted journal and renaming its snapshot leaves only the snapshot.
+    if ( !QFile::exists(path) && QFile::exists(path + ".tmp") )
+        QFile::rename(path + ".tmp", path);
+
+    QFile file(path);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return false;
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    quint32 fields[3];
+    if ( data.size() < HEADER_SIZE || memcmp(data.constData(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 )
+        return false;
+    memcpy(fields, data.constData() + 4, sizeof(fields));
+    if ( fields[0] > VERSION || fields[2] > (quint32)(data.size() - HEADER_SIZE) )
+        return false;
+    *faces = fields[1];
+    *model = QString::fromUtf8(data.constData() + HEADER_SIZE, fields[2]);
+
+    // Records after a damaged one are lost with it.
+    qint64 position = HEADER_SIZE + fields[2];
+    while ( position + 8 <= data.size() )
+    {
+        quint32 header[2];
+        memcpy(header, data.constData() + position, 8);
+        if ( (qint64)header[0] > data.size() - position - 8 )
+            break;
+
+        QByteArray payload = data.mid(position + 8, header[0]);
+        if ( checksum(payload) != header[1] )
+            break;
+
+        records->push_back(payload);
+        position += 8 + header[0];
+    }
+
+    return true;
+}
+
+bool BookmarkJournal::hasRecords(QString path, QString *model, unsigned int *faces)
+{
+    std::vector<QByteArray> records;
+    return readRecords(path, &records, model, faces) && !records.empty();
+}
+
+bool BookmarkJournal::isInUse(QString path)
+{
+#if QT_VERSION >= 0x050100
+    QLockFile lock(path + ".lock");
+    if ( !lock.tryLock(0) )
+        return true;
+    lock.unlock();
+#else
+    Q_UNUSED(path);
+#endif
+    return false;
+}
+
+QString BookmarkJournal::setAside(QString path)
+{
+    QString aside = path + "." + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".unrecovered";
+    return QFile::rename(path, aside) ? aside : QString();
+}
+
+int BookmarkJournal::replay(QString path, BookmarkList *bookmarkList, int maxIndex, int *errors, bool *complete)
+{
+    std::vector<QByteArray> records;
+    QString model;
+    unsigned int faces = 0;
+    *complete = readRecords(path, &records, &model, &faces);
+    if ( !*complete )
+        return 0;
+
+    // Edits depend on the previous ones, replay stops at the first invalid record.
+    int applied = 0;
+    for ( unsigned int i = 0; i < records.size(); ++i )
+    {
+        QDataStream stream(records[i]);
+        stream.setVersion(QDataStream::Qt_4_6);
+        quint8 type = 0;
+        quint32 index = 0;
+        stream >> type;
+
+        bool valid = false;
+        if ( type == ADD_RECORD )
+        {
+            Bookmark *bookmark = readBookmark(stream, maxIndex, errors);
+            if ( bookmark )
+                bookmarkList->add(bookmark);
+            valid = bookmark != 0;
+        }
+        else if ( type == UPDATE_RECORD )
+        {
+            QString name;
+            QString comments;
+            FaceSelection added;
+            FaceSelection removed;
+            stream >> index >> name >> comments;
+            valid = stream.status() == QDataStream::Ok && index > 0 && index < (quint32)bookmarkList->size()
+                    && readFaces(stream, maxIndex, errors, &added) && readFaces(stream, maxIndex, errors, &removed);
+            if ( valid )
+            {
+                FaceSelection faces = *bookmarkList->getAt(index)->getFaces();
+                faces.subtract(removed).unite(added);
+                bookmarkList->update(index, name, comments, faces);
+            }
+        }
+        else if ( type == DELETE_RECORD )
+        {
+            stream >> index;
+            valid = stream.status() == QDataStream::Ok && index > 0 && index < (quint32)bookmarkList->size();
+            if ( valid )
+                bookmarkList->deleteAt(index);
+        }
+        else if ( type == SNAPSHOT_RECORD )
+        {
+            quint32 count = 0;
+            stream >> count;
+            valid = stream.status() == QDataStream::Ok;
+            if ( valid )
+                bookmarkList->clear();
+            for ( quint32 b = 0; b < count && valid; ++b )
+            {
+                Bookmark *bookmark = readBookmark(stream, maxIndex, errors);
+                if ( bookmark )
+                    bookmarkList->add(bookmark);
+                valid = bookmark != 0;
+            }
+        }
+
+        if ( !valid )
+        {
+            *complete = false;
+            break;
+        }
+        applied++;
+    }
+
+    return applied;
+}
@@ -0,0 +1,237 @@
+#ifndef BOOKMARKJOURNAL_H
+#define BOOKMARKJOURNAL_H
+
+#include <vector>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+#include "bookmark.h"
+
+#if QT_VERSION >= 0x050100
+#include <QLockFile>
+#endif
+
+class BookmarkList;
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The BookmarkJournal class is an append-only log of the edits of a
+ * bookmark list since it was last saved, replayed to recover them after a
+ * crash. Each record holds its length, a checksum and one edit: a bookmark
+ * added with its faces, a bookmark updated with only the faces added and
+ * removed, a bookmark deleted, or a snapshot of the whole list. Records
+ * are flushed as they are written, so autosaving costs the size of the
+ * edit. Once the journal outgrows CHECKPOINT_SIZE and twice its last
+ * snapshot, it is compacted into a single snapshot. A record cut by a
+ * crash fails its checksum and ends the replay.
+ *
+ * The header holds the path and number of faces of the model the edits
+ * refer to, face indices of another model are meaningless. With Qt 5.1 or
+ * later an open journal is locked, so another instance does not replace
+ * or recover it while in use.
+ */
+class BookmarkJournal
+{
+private:
+
+    QFile _file;                /**< Journal file, open for append. */
+    qint64 _snapshotSize;       /**< Size of the journal after the last snapshot. */
+    QString _model;             /**< Path of the model the edits refer to. */
+    quint32 _faces;             /**< Number of faces of the model. */
+#if QT_VERSION >= 0x050100
+    QLockFile *_lock;           /**< Lock of the open journal, null if none. */
+#endif
+
+    /**
+     * @brief Append a record and flush it.
+     * @param payload Record contents.
+     * @return True if written, false otherwise.
+     */
+    bool append(const QByteArray &payload);
+
+    /**
+     * @brief Write a record with its length and checksum.
+     * @param file File open for writing.
+     * @param payload Record contents.
+     * @return True if written, false otherwise.
+     */
+    static bool writeRecord(QFile &file, const QByteArray &payload);
+
+    /**
+     * @brief Write the journal header, with the model of the journal, to an empty file.
+     * @param file File open for writing.
+     * @return True if written, false otherwise.
+     */
+    bool writeHeader(QFile &file) const;
+
+    /**
+     * @brief Return the checksum of a record.
+     * @param payload Record contents.
+     * @return FNV-1a hash of the contents.
+     */
+    static quint32 checksum(const QByteArray &payload);
+
+    /**
+     * @brief Read every complete and valid record of a journal.
+     * @param path Journal file.
+     * @param records Record contents, replaced.
+     * @param model Result path of the model of the journal.
+     * @param faces Result number of faces of the model.
+     * @return False if the file is not a journal, true otherwise.
+     */
+    static bool readRecords(QString path, std::vector<QByteArray> *records, QString *model, unsigned int *faces);
+
+public:
+
+    /**
+     * @brief Record types.
+     */
+    enum RecordType {
+        ADD_RECORD = 1,
+        UPDATE_RECORD = 2,
+        DELETE_RECORD = 3,
+        SNAPSHOT_RECORD = 4
+    };
+
+    static const quint32 VERSION = 1;                           /**< Version of the journals written. */
+    static const qint64 CHECKPOINT_SIZE = 4 * 1024 * 1024;      /**< Minimum journal size to compact (bytes). */
+
+    /**
+     * @brief Default constructor. No journal open.
+     */
+    BookmarkJournal();
+
+    /**
+     * @brief Destructor. The journal is closed and kept.
+     */
+    ~BookmarkJournal();
+
+    /**
+     * @brief Start an empty journal, replacing the file if it exists.
+     * @param path Journal file.
+     * @param model Path of the model the edits refer to.
+     * @param faces Number of faces of the model.
+     * @param keep True to keep the records of an existing file until the next checkpoint.
+     * @return True if opened, false otherwise (also if another instance uses it).
+     */
+    bool open(QString path, QString model, unsigned int faces, bool keep = false);
+
+    /**
+     * @brief Delete the journal and start an empty one for the same model.
+     * @param path New journal file.
+     * @return True if opened, false otherwise.
+     */
+    bool restart(QString path);
+
+    /**
+     * @brief Close the journal.
+     * @param remove True to also delete the file, its edits are saved or discarded.
+     */
+    void close(bool remove);
+
+    /**
+     * @brief Get if a journal is open.
+     * @return True if open, false otherwise.
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Return the path of the journal open.
+     * @return Journal file, empty if none is open.
+     */
+    QString getPath() const;
+
+    /**
+     * @brief Get if the journal grew enough since its last snapshot to be compacted.
+     * @return True if a checkpoint is due, false otherwise.
+     */
+    bool needsCheckpoint() const;
+
+    /**
+     * @brief Record a bookmark appended to the list.
+     * @param bookmark Bookmark added.
+     */
+    void logAdd(Bookmark *bookmark);
+
+    /**
+     * @brief Record a bookmark updated.
+     * @param index Index of the bookmark.
+     * @param bookmark Bookmark, with its new name and comments.
+     * @param added Faces added to the bookmark.
+     * @param removed Faces removed from the bookmark.
+     */
+    void logUpdate(unsigned int index, Bookmark *bookmark, const FaceSelection &added, const FaceSelection &removed);
+
+    /**
+     * @brief Record a bookmark deleted.
+     * @param index Index of the bookmark.
+     */
+    void logDelete(unsigned int index);
+
+    /**
+     * @brief Replace the journal by a snapshot of a list. The snapshot is
+     * written to a .tmp file, then the journal is removed and the .tmp file
+     * renamed over it. A crash between both steps leaves only the .tmp file,
+     * which readRecords takes as the journal. If the rename fails, the
+     * journal is written again from the snapshot; if that fails too, the
+     * journal is closed and the .tmp file kept.
+     * @param bookmarks Bookmarks of the list, without the 'None' bookmark.
+     * @return True if compacted, false otherwise (the journal may be closed, see isOpen).
+     */
+    bool checkpoint(const std::vector<Bookmark*> &bookmarks);
+
+    /**
+     * @brief Get if a journal file holds edits to recover.
+     * @param path Journal file.
+     * @param model Result path of the model of the journal.
+     * @param faces Result number of faces of the model.
+     * @return True if it has valid records, false otherwise.
+     */
+    static bool hasRecords(QString path, QString *model, unsigned int *faces);
+
+    /**
+     * @brief Get if another instance has a journal file open. Always false before Qt 5.1.
+     * @param path Journal file.
+     * @return True if in use, false otherwise.
+     */
+    static bool isInUse(QString path);
+
+    /**
+     * @brief Rename a journal that could not be recovered, so it is neither replaced nor offered again.
+     * @param path Journal file.
+     * @return New path of the journal, empty if it could not be renamed.
+     */
+    static QString setAside(QString path);
+
+    /**
+     * @brief Apply the edits of a journal to a list. The list must not journal them again.
+     * @param path Journal file.
+     * @param bookmarkList List the journal was written from, as last saved.
+     * @param maxIndex Maximum index allowed.
+     * @param errors Number of face index that exceed the maxIndex value, increased.
+     * @param complete Result: false if a record could not be applied, and the ones after it were skipped.
+     * @return Number of records applied.
+     */
+    static int replay(QString path, BookmarkList *bookmarkList, int maxIndex, int *errors, bool *complete);
+
+};
+
+#endif // BOOKMARKJOURNAL_H
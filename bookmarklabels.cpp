@@ -0,0 +1,139 @@
+#include "bookmarklabels.h"
+
+#include <algorithm>
+#include <QColor>
+
+BookmarkLabels::BookmarkLabels()
+{
+    _version = 0;
+    clear();
+}
+
+void BookmarkLabels::clear()
+{
+    _labels.clear();
+    _head.clear();
+    _deltaFaces = 0;
+}
+
+bool BookmarkLabels::isBuilt() const
+{
+    return !_head.isNull();
+}
+
+QSharedPointer<const FaceLabels> BookmarkLabels::getLabels() const
+{
+    return _head;
+}
+
+void BookmarkLabels::build(BookmarkList *bookmarkList, unsigned int numFaces)
+{
+    _labels.assign(numFaces, 0);
+
+    // Later bookmarks overwrite earlier ones. Bookmark 0 is the empty 'None'.
+    unsigned int count = std::min(bookmarkList->size(), 0xffff);
+    for ( unsigned int b = 1; b < count; ++b )
+    {
+        FaceSelection *faces = bookmarkList->getAt(b)->getFaces();
+        FaceSelection::const_iterator it = faces->begin();
+        for ( ; it != faces->end(); ++it )
+            if ( *it < numFaces )
+                _labels[*it] = b;
+    }
+
+    publishFull();
+}
+
+void BookmarkLabels::updateBookmark(BookmarkList *bookmarkList, unsigned int index, const FaceSelection &oldFaces)
+{
+    if ( !isBuilt() || index == 0 || index > 0xffff )
+        return;
+
+    FaceSelection *newFaces = bookmarkList->getAt(index)->getFaces();
+    FaceLabels *delta = new FaceLabels();
+
+    // Faces added: the bookmark takes them unless a later one has them.
+    FaceSelection::const_iterator it = newFaces->begin();
+    for ( ; it != newFaces->end(); ++it )
+    {
+        if ( *it < _labels.size() && _labels[*it] < index )
+        {
+            _labels[*it] = index;
+            delta->faces.push_back(*it);
+        }
+    }
+
+    // Faces removed: go to the last other bookmark having them.
+    FaceSelection candidates = oldFaces;
+    std::vector<unsigned int> removed;
+    for ( it = candidates.subtract(*newFaces).begin(); it != candidates.end(); ++it )
+        if ( *it < _labels.size() && _labels[*it] == index )
+            removed.push_back(*it);
+    delta->faces.insert(delta->faces.end(), removed.begin(), removed.end());
+
+    candidates.clear();
+    candidates.insert(removed);
+    relabel(bookmarkList, index, candidates);
+
+    std::sort(delta->faces.begin(), delta->faces.end());
+    _deltaFaces += delta->faces.size();
+
+    if ( _deltaFaces * COMPACT_RATIO > _labels.size() )
+    {
+        delete delta;
+        publishFull();
+        return;
+    }
+
+    delta->faceLabels.resize(delta->faces.size());
+    for ( unsigned int i = 0; i < delta->faces.size(); ++i )
+        delta->faceLabels[i] = _labels[delta->faces[i]];
+
+    delta->version = ++_version;
+    delta->previous = _head;
+    _head = QSharedPointer<const FaceLabels>(delta);
+}
+
+void BookmarkLabels::publishFull()
+{
+    FaceLabels *full = new FaceLabels();
+    full->version = ++_version;
+    full->labels = _labels;
+
+    _head = QSharedPointer<const FaceLabels>(full);
+    _deltaFaces = 0;
+}
+
+void BookmarkLabels::relabel(BookmarkList *bookmarkList, unsigned int index, FaceSelection faces)
+{
+    FaceSelection::const_iterator it;
+    for ( int b = std::min((int)index, bookmarkList->size()) - 1; b > 0 && !faces.isEmpty(); --b )
+    {
+        FaceSelection found = faces;
+        found.intersect(*bookmarkList->getAt(b)->getFaces());
+        for ( it = found.begin(); it != found.end(); ++it )
+            _labels[*it] = b;
+        faces.subtract(found);
+    }
+
+    for ( it = faces.begin(); it != faces.end(); ++it )
+        _labels[*it] = 0;
+}
+
+void BookmarkLabels::labelColor(unsigned short label, unsigned char rgb[3])
+{
+    if ( label == 0 )
+    {
+        // Model color.
+        rgb[0] = 112;
+        rgb[1] = 153;
+        rgb[2] = 242;
+        return;
+    }
+
+    // Golden angle hue steps keep neighbour labels apart.
+    QColor color = QColor::fromHsv((label * 137) % 360, 200, 230);
+    rgb[0] = color.red();
+    rgb[1] = color.green();
+    rgb[2] = color.blue();
+}
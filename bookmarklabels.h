@@ -0,0 +1,122 @@
+#ifndef BOOKMARKLABELS_H
+#define BOOKMARKLABELS_H
+
+#include <vector>
+#include <QSharedPointer>
+#include "bookmarklist.h"
+
+/**
+ * @brief Immutable version of the face labels, shared with the render
+ * thread. A full version holds every label; a delta version holds the
+ * faces changed since the previous version, which it keeps alive.
+ */
+struct FaceLabels
+{
+    unsigned int version;                       /**< Version number, increasing. */
+    QSharedPointer<const FaceLabels> previous;  /**< Previous version, null for a full version. */
+    std::vector<unsigned short> labels;         /**< Full version: label of each face. */
+    std::vector<unsigned int> faces;            /**< Delta version: changed faces, sorted. */
+    std::vector<unsigned short> faceLabels;     /**< Delta version: new label of each changed face. */
+};
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The BookmarkLabels class labels each model face with the bookmark it
+ * belongs to, so all bookmarks can be drawn at once. Label 0 is no
+ * bookmark; a face in several bookmarks takes the last one. Editing one
+ * bookmark publishes only the faces whose label changed. Deltas are
+ * folded in a new full version once they cover COMPACT_RATIO of the
+ * faces.
+ */
+class BookmarkLabels
+{
+private:
+
+    std::vector<unsigned short> _labels;        /**< Current label of each face. */
+    QSharedPointer<const FaceLabels> _head;     /**< Latest published version. */
+    unsigned int _version;                      /**< Latest version number. */
+    unsigned int _deltaFaces;                   /**< Faces in deltas since last full version. */
+
+    /**
+     * @brief Publish the current labels as a full version.
+     */
+    void publishFull();
+
+    /**
+     * @brief Label faces with the last bookmark before another one containing them.
+     * Bookmarks are intersected with the faces still unlabeled, from the
+     * last one down, until all faces are labeled.
+     * @param bookmarkList Bookmark list.
+     * @param index Bookmark the faces left, no later bookmark contains them.
+     * @param faces Faces to label, 0 if no bookmark contains them.
+     */
+    void relabel(BookmarkList *bookmarkList, unsigned int index, FaceSelection faces);
+
+public:
+
+    static const unsigned int COMPACT_RATIO = 4;   /**< Compact when deltas hold 1/COMPACT_RATIO of faces. */
+
+    /**
+     * @brief Default constructor.
+     */
+    BookmarkLabels();
+
+    /**
+     * @brief Label every face from a bookmark list.
+     * @param bookmarkList Bookmark list.
+     * @param numFaces Number of model faces.
+     */
+    void build(BookmarkList *bookmarkList, unsigned int numFaces);
+
+    /**
+     * @brief Update the labels after one bookmark was added or edited.
+     * @param bookmarkList Bookmark list, with the bookmark already changed.
+     * @param index Index of the bookmark.
+     * @param oldFaces Faces of the bookmark before the change.
+     */
+    void updateBookmark(BookmarkList *bookmarkList, unsigned int index, const FaceSelection &oldFaces);
+
+    /**
+     * @brief Clear the labels.
+     */
+    void clear();
+
+    /**
+     * @brief Get if labels are built.
+     * @return True if built, false otherwise.
+     */
+    bool isBuilt() const;
+
+    /**
+     * @brief Return the latest version.
+     * @return Latest version, null if not built.
+     */
+    QSharedPointer<const FaceLabels> getLabels() const;
+
+    /**
+     * @brief Return the color of a label.
+     * @param label Label.
+     * @param rgb Result color.
+     */
+    static void labelColor(unsigned short label, unsigned char rgb[3]);
+
+};
+
+#endif // BOOKMARKLABELS_H
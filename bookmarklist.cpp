@@ -1,10 +1,154 @@
 #include "bookmarklist.h"
 
+#include <algorithm>
+#include <string.h>
+
+/**
+ * @brief Parse comma separated face indices or runs, in chunks that may split a token.
+ */
+struct FaceListParser
+{
+    int maxIndex;
+    bool ranges;
+    int errors;
+    unsigned int value;
+    unsigned int gap;
+    bool digits;
+    bool hasCount;
+    bool invalid;
+    unsigned long long next;
+    std::vector<unsigned int> batch;
+    FaceSelection *faces;
+
+    FaceListParser(int max, bool runs, FaceSelection *result)
+        : maxIndex(max), ranges(runs), errors(0), value(0), gap(0), digits(false), hasCount(false),
+          invalid(false), next(0), faces(result)
+    {
+        batch.reserve(BookmarkList::FACE_CHUNK);
+    }
+
+    void push(unsigned int face)
+    {
+        batch.push_back(face);
+        if ( batch.size() == (unsigned int)BookmarkList::FACE_CHUNK )
+            flush();
+    }
+
+    void endIndex()
+    {
+        if ( invalid || (hasCount && !digits) )
+            errors++;
+        else if ( digits && !ranges )
+        {
+            if ( maxIndex < 0 || value > (unsigned int)maxIndex )
+                errors++;
+            else
+                push(value);
+        }
+        else if ( digits )
+        {
+            // Run of count faces, gap faces after the previous one.
+            unsigned long long first = next + (hasCount ? gap : value);
+            unsigned long long end = first + (hasCount ? value : 1);
+            unsigned long long valid = maxIndex < 0 ? first : std::min(end, (unsigned long long)maxIndex + 1);
+            for ( unsigned long long face = first; face < valid; ++face )
+                push((unsigned int)face);
+            if ( end > valid )
+                errors++;
+            next = end;
+        }
+
+        value = 0;
+        gap = 0;
+        digits = false;
+        hasCount = false;
+        invalid = false;
+    }
+
+    void parse(const QChar *text, int length)
+    {
+        for ( int i = 0; i < length; ++i )
+        {
+            ushort c = text[i].unicode();
+            if ( c >= '0' && c <= '9' )
+            {
+                // Saturate, any index this long exceeds maxIndex.
+                value = value < 0x0fffffff ? 10 * value + (c - '0') : 0xffffffff;
+                digits = true;
+            }
+            else if ( c == ',' )
+                endIndex();
+            else if ( c == '-' && ranges && digits && !hasCount )
+            {
+                gap = value;
+                value = 0;
+                digits = false;
+                hasCount = true;
+            }
+            else if ( c != ' ' && c != '\t' && c != '\n' && c != '\r' )
+                invalid = true;
+        }
+    }
+
+    void flush()
+    {
+        // Faces are saved in order, so they are added block by block.
+        faces->insert(batch);
+        batch.clear();
+    }
+};
+
+/**
+ * @brief Header of binary bookmark files.
+ */
+struct BinaryHeader
+{
+    char magic[4];              /**< BINARY_MAGIC. */
+    quint32 version;            /**< BINARY_VERSION. */
+    quint32 byteOrder;          /**< BYTE_ORDER_MARK as written by the saving host. */
+    quint32 count;              /**< Number of bookmarks. */
+    quint64 indexOffset;        /**< Offset of the index entries. */
+    quint64 stringsOffset;      /**< Offset of the string table. */
+    quint64 stringsSize;        /**< Size of the string table. */
+};
+
+/**
+ * @brief Index entry of a bookmark in binary bookmark files.
+ */
+struct BinaryEntry
+{
+    quint64 facesOffset;        /**< Offset of the serialized faces. */
+    quint32 facesSize;          /**< Size of the serialized faces. */
+    quint32 flags;              /**< COMPRESSED_FACES if compressed with qCompress. */
+    quint32 faceCount;          /**< Number of faces. */
+    quint32 lastFace;           /**< Largest face, to check faces against the model without decoding. */
+    quint32 nameOffset;         /**< Name, in the string table. */
+    quint32 nameSize;
+    quint32 commentsOffset;     /**< Comments, in the string table. */
+    quint32 commentsSize;
+};
+
+static const char BINARY_MAGIC[4] = { '3', 'D', 'M', 'B' };
+static const quint32 BYTE_ORDER_MARK = 0x01020304;
+static const quint32 COMPRESSED_FACES = 1;
+
+const char* const BookmarkList::BINARY_SUFFIX = "3dmb";
+
 BookmarkList::BookmarkList()
 {
+    _file = 0;
+    _map = 0;
+    _nextId = 0;
+    _indexed = false;
+    _journalError = false;
     clear();
 }
 
+BookmarkList::~BookmarkList()
+{
+    unmapFile();
+}
+
 std::vector<Bookmark*>* BookmarkList::getList()
 {
     return &_list;
@@ -25,126 +169,551 @@ int BookmarkList::size()
     return _list.size();
 }
 
-void BookmarkList::add(Bookmark *bookmark)
+void BookmarkList::append(Bookmark *bookmark)
 {
+    bookmark->setId(_nextId++);
+    _ids[bookmark->getId()] = bookmark;
     _list.push_back(bookmark);
+
+    if ( _indexed )
+        _index.insert(bookmark->getId(), *bookmark->getFaces());
+}
+
+void BookmarkList::add(Bookmark *bookmark)
+{
+    append(bookmark);
     _updated = true;
+
+    _journal.logAdd(bookmark);
+    checkpointIfNeeded();
+}
+
+void BookmarkList::update(unsigned int index, QString name, QString comments, const FaceSelection &faces)
+{
+    Bookmark *bookmark = _list[index];
+    FaceSelection removed = *bookmark->getFaces();
+    FaceSelection added = faces;
+    removed.subtract(faces);
+    added.subtract(*bookmark->getFaces());
+
+    if ( _indexed )
+    {
+        _index.remove(bookmark->getId(), removed);
+        _index.insert(bookmark->getId(), added);
+    }
+
+    bookmark->setName(name);
+    bookmark->setComments(comments);
+    bookmark->setFaces(faces);
+    _updated = true;
+
+    _journal.logUpdate(index, bookmark, added, removed);
+    checkpointIfNeeded();
 }
 
 void BookmarkList::deleteAt(int index)
 {
+    Bookmark *bookmark = _list[index];
+    if ( _indexed )
+        _index.remove(bookmark->getId(), *bookmark->getFaces());
+    _ids.erase(bookmark->getId());
+
     _list.erase(_list.begin() + index);
     _updated = true;
+
+    _journal.logDelete(index);
+    checkpointIfNeeded();
+}
+
+bool BookmarkList::setJournal(QString path, QString model, unsigned int faces, bool snapshot)
+{
+    if ( path.isEmpty() )
+    {
+        _journal.close(false);
+        return false;
+    }
+
+    // Replayed records are kept until the snapshot replaces them.
+    if ( !snapshot )
+        return _journal.open(path, model, faces);
+
+    return _journal.open(path, model, faces, true)
+            && _journal.checkpoint(std::vector<Bookmark*>(_list.begin() + 1, _list.end()));
+}
+
+QString BookmarkList::getJournal() const
+{
+    return _journal.getPath();
+}
+
+int BookmarkList::recover(QString path, int maxIndex, int *errors, bool *complete)
+{
+    *errors = 0;
+
+    // Replayed edits must not be journaled again.
+    _journal.close(false);
+    return BookmarkJournal::replay(path, this, maxIndex, errors, complete);
+}
+
+void BookmarkList::checkpointIfNeeded()
+{
+    // A compaction that fails keeps the journal open if it is still complete.
+    if ( _journal.needsCheckpoint() && !_journal.checkpoint(std::vector<Bookmark*>(_list.begin() + 1, _list.end()))
+         && !_journal.isOpen() )
+        _journalError = true;
+}
+
+bool BookmarkList::takeJournalError()
+{
+    bool error = _journalError;
+    _journalError = false;
+    return error;
+}
+
+QString BookmarkList::journalPath(QString path)
+{
+    return path + ".journal";
+}
+
+Bookmark* BookmarkList::getById(unsigned int id)
+{
+    std::map<unsigned int, Bookmark*>::const_iterator it = _ids.find(id);
+    return it == _ids.end() ? 0 : it->second;
+}
+
+void BookmarkList::buildIndex()
+{
+    if ( _indexed )
+        return;
+
+    for ( unsigned int i = 0; i < _list.size(); ++i )
+        _index.insert(_list[i]->getId(), *_list[i]->getFaces());
+    _indexed = true;
+}
+
+bool BookmarkList::isIndexed() const
+{
+    return _indexed;
+}
+
+void BookmarkList::bookmarksAt(unsigned int face, std::vector<Bookmark*> *bookmarks)
+{
+    buildIndex();
+
+    // Ids grow with each bookmark added, as the list order.
+    std::vector<unsigned int> ids;
+    _index.find(face, &ids);
+    bookmarks->clear();
+    for ( unsigned int i = 0; i < ids.size(); ++i )
+        bookmarks->push_back(getById(ids[i]));
+}
+
+bool BookmarkList::contains(unsigned int face, Bookmark *bookmark)
+{
+    if ( !_indexed )
+        return bookmark->getFaces()->contains(face);
+
+    return _index.contains(face, bookmark->getId());
 }
 
 void BookmarkList::clear()
 {
+    _journal.close(true);
     _list.clear();
+    _ids.clear();
+    _index.clear();
+    _indexed = false;
+    unmapFile();
     _updated = false;
-    std::set<unsigned int> faces;
+    FaceSelection faces;
     Bookmark *bookmark = new Bookmark("None", "None", faces);
-    _list.push_back(bookmark);
+    append(bookmark);
 }
 
-bool BookmarkList::save(QString path)
+bool BookmarkList::save(QString path, QStringList *kept)
+{
+    // The file written may be the one mapped.
+    releaseFile();
+
+    // A failed save keeps the previous file.
+    QString temp = path + ".tmp";
+    QString backup = path + ".bak";
+    bool saved;
+    if ( QFileInfo(path).suffix().compare(BINARY_SUFFIX, Qt::CaseInsensitive) == 0 )
+        saved = saveBinary(temp);
+    else
+        saved = saveXml(temp);
+
+    bool backedUp = false;
+    if ( saved && QFile::exists(path) )
+    {
+        QFile::remove(backup);
+        saved = backedUp = QFile::rename(path, backup);
+    }
+    if ( saved )
+        saved = QFile::rename(temp, path);
+
+    if ( saved )
+        QFile::remove(backup);
+    else if ( !backedUp || QFile::rename(backup, path) )
+        QFile::remove(temp);
+    else if ( kept )
+    {
+        // Neither file is at path, both are left for the user.
+        kept->clear();
+        kept->append(temp);
+        kept->append(backup);
+    }
+
+    // Edits are saved, the journal starts again next to the file.
+    if ( saved && _journal.isOpen() )
+        _journal.restart(journalPath(path));
+
+    return saved;
+}
+
+bool BookmarkList::saveXml(QString path)
 {
     QFile file(path);
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
         return false;
     }
 
-    QDomDocument* xml = new QDomDocument;
-    QDomElement root = xml->createElement("bookmarks");
-    xml->appendChild(root);
+    QXmlStreamWriter writer(&file);
+    writer.setAutoFormatting(true);
+    writer.writeStartDocument();
+    writer.writeStartElement("bookmarks");
+    writer.writeAttribute("version", QString::number(FILE_VERSION));
 
-    // Create node for each bookmark.
+    // Write node for each bookmark.
     for (unsigned int i = 1; i < _list.size(); i++)
     {
         Bookmark* bookmark = _list[i];
-        QDomElement bookmarkNode = xml->createElement("bookmark");
-        root.appendChild(bookmarkNode);
+        writer.writeStartElement("bookmark");
+        writer.writeTextElement("name", bookmark->getName());
+        writer.writeTextElement("comments", bookmark->getComments());
+
+        writer.writeStartElement("faces");
+        writer.writeAttribute("encoding", "ranges");
+        writeFaces(writer, *bookmark->getFaces());
+        writer.writeEndElement();
+
+        writer.writeEndElement();
+    }
 
-        // Set name.
-        QDomElement nameNode = xml->createElement("name");
-        nameNode.appendChild(xml->createTextNode(bookmark->getName()));
-        bookmarkNode.appendChild(nameNode);
+    writer.writeEndElement();
+    writer.writeEndDocument();
 
-        // Set comments.
-        QDomElement commentsNode = xml->createElement("comments");
-        commentsNode.appendChild(xml->createTextNode(bookmark->getComments()));
-        bookmarkNode.appendChild(commentsNode);
+    file.close();
 
-        // Set faces.
-        QDomElement facesNode = xml->createElement("faces");
-        QString faces = "";
+    return !writer.hasError() && file.error() == QFile::NoError;
+}
 
-        std::set<unsigned int>::const_iterator it = bookmark->getFaces()->begin();
-        for ( ; it != bookmark->getFaces()->end(); ++it )
-            faces.append( QString().setNum( *it ) ).append(",");
+/**
+ * @brief Format a number in decimal.
+ * @return Number of characters written.
+ */
+static inline unsigned int formatNumber(unsigned int value, char *text)
+{
+    char digits[16];
+    unsigned int count = 0;
+    do
+    {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while ( value > 0 );
 
-        // Remove last comma.
-        faces = faces.remove(faces.length()-1,1);
+    for ( unsigned int i = 0; i < count; ++i )
+        text[i] = digits[count - 1 - i];
+    return count;
+}
 
-        facesNode.appendChild(xml->createTextNode(faces));
-        bookmarkNode.appendChild(facesNode);
+void BookmarkList::writeFaces(QXmlStreamWriter &writer, const FaceSelection &faces)
+{
+    // Digits are formatted by hand, a QString per run is the bottleneck of large bookmarks.
+    std::vector<char> buffer(FACE_CHUNK + 32);
+    unsigned int length = 0;
+    unsigned int next = 0;
 
-    }
+    FaceSelection::const_iterator it = faces.begin();
+    while ( it != faces.end() )
+    {
+        // Extend the run while faces are consecutive.
+        unsigned int first = *it;
+        unsigned int count = 1;
+        for ( ++it; it != faces.end() && *it == first + count; ++it )
+            ++count;
 
-    QTextStream textStream(&file);
-    textStream << xml->toString();
+        if ( next > 0 )
+            buffer[length++] = ',';
 
-    file.close();
+        length += formatNumber(first - next, &buffer[length]);
+        if ( count > 1 )
+        {
+            buffer[length++] = '-';
+            length += formatNumber(count, &buffer[length]);
+        }
+        next = first + count;
 
-    return true;
+        if ( length >= (unsigned int)FACE_CHUNK )
+        {
+            writer.writeCharacters(QString::fromLatin1(&buffer[0], length));
+            length = 0;
+        }
+    }
+
+    if ( length > 0 )
+        writer.writeCharacters(QString::fromLatin1(&buffer[0], length));
 }
 
 bool BookmarkList::open(QString path, int maxIndex, int* errors)
 {
-    errors = 0; // Reset errors.
+    *errors = 0; // Reset errors.
 
     clear();
 
-    QFile* file = new QFile(path);
-    if (!file->open(QIODevice::ReadOnly | QIODevice::Text)) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         return false;
     }
 
-    QDomDocument doc("mydocument");
-    if (!doc.setContent(file)) {
+    if ( file.peek(sizeof(BINARY_MAGIC)) == QByteArray(BINARY_MAGIC, sizeof(BINARY_MAGIC)) )
+    {
+        file.close();
+        return openBinary(path, maxIndex, errors);
+    }
+
+    QXmlStreamReader reader(&file);
+    while ( !reader.atEnd() )
+    {
+        reader.readNext();
+        if ( reader.isStartElement() && reader.name() == QLatin1String("bookmarks") )
+        {
+            // Files without version are version 1.
+            int version = reader.attributes().value("version").toString().toInt();
+            if ( version > FILE_VERSION )
+                reader.raiseError("Unsupported bookmark file version.");
+        }
+        else if ( reader.isStartElement() && reader.name() == QLatin1String("bookmark") )
+            readBookmark(reader, maxIndex, errors);
+    }
+
+    file.close();
+
+    if ( reader.hasError() )
+    {
+        clear();
         return false;
     }
 
-    // Get the root element.
-    QDomElement docElem = doc.documentElement();
+    return true;
+}
 
-    // Get <bookmark> nodes
-    QDomNodeList nodeList = docElem.elementsByTagName("bookmark");
+void BookmarkList::readBookmark(QXmlStreamReader &reader, int maxIndex, int *errors)
+{
+    QString name;
+    QString comments;
+    FaceSelection faces;
 
-    for (int i = 0; i < nodeList.count(); i++)
+    while ( reader.readNextStartElement() )
     {
-        QDomElement bookmarkNode = nodeList.at(i).toElement();
-        QDomElement nameNode = bookmarkNode.elementsByTagName("name").at(0).toElement();
-        QDomElement commentsNode = bookmarkNode.elementsByTagName("comments").at(0).toElement();
-        QDomElement facesNode = bookmarkNode.elementsByTagName("faces").at(0).toElement();
+        if ( reader.name() == QLatin1String("name") )
+            name = reader.readElementText();
+        else if ( reader.name() == QLatin1String("comments") )
+            comments = reader.readElementText();
+        else if ( reader.name() == QLatin1String("faces") )
+            readFaces(reader, maxIndex, errors, &faces);
+        else
+            reader.skipCurrentElement();
+    }
 
-        QString faces = facesNode.text();
-        QStringList faceList = faces.split(",");
-        std::set<unsigned int> faceSet;
+    Bookmark* bookmark = new Bookmark(name, comments, faces);
+    append(bookmark);
+}
+
+void BookmarkList::readFaces(QXmlStreamReader &reader, int maxIndex, int *errors, FaceSelection *faces)
+{
+    faces->clear();
 
-        for (int j = 0; j < faceList.count(); j++)
+    QXmlStreamAttributes attributes = reader.attributes();
+    QStringRef encoding = attributes.value("encoding");
+    if ( !encoding.isEmpty() && encoding != QLatin1String("ranges") )
+    {
+        (*errors)++;
+        reader.skipCurrentElement();
+        return;
+    }
+    FaceListParser parser(maxIndex, !encoding.isEmpty(), faces);
+
+    // Text may come in several chunks, an index can be split between them.
+    while ( !reader.atEnd() )
+    {
+        reader.readNext();
+        if ( reader.isCharacters() )
+            parser.parse(reader.text().unicode(), reader.text().size());
+        else if ( reader.isEndElement() )
+            break;
+        else if ( reader.isStartElement() )
+            reader.skipCurrentElement();
+    }
+
+    parser.endIndex();
+    parser.flush();
+    *errors += parser.errors;
+}
+
+bool BookmarkList::saveBinary(QString path)
+{
+    QFile file(path);
+    if ( !file.open(QIODevice::WriteOnly) )
+        return false;
+
+    // Strings and index go first, faces are appended one bookmark at a time.
+    unsigned int count = _list.size() - 1;
+    std::vector<BinaryEntry> entries(count);
+    QByteArray strings;
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        QByteArray name = _list[i + 1]->getName().toUtf8();
+        QByteArray comments = _list[i + 1]->getComments().toUtf8();
+        entries[i].nameOffset = strings.size();
+        entries[i].nameSize = name.size();
+        strings.append(name);
+        entries[i].commentsOffset = strings.size();
+        entries[i].commentsSize = comments.size();
+        strings.append(comments);
+    }
+
+    BinaryHeader header;
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.count = count;
+    header.indexOffset = sizeof(BinaryHeader);
+    header.stringsOffset = header.indexOffset + count * sizeof(BinaryEntry);
+    header.stringsSize = strings.size();
+
+    quint64 offset = header.stringsOffset + header.stringsSize;
+    bool written = file.seek(offset);
+
+    for ( unsigned int i = 0; i < count && written; ++i )
+    {
+        const FaceSelection &faces = *_list[i + 1]->getFaces();
+        QByteArray data(faces.serializedSize(), 0);
+        faces.serialize(data.data());
+
+        // Region shaped bookmarks are full bitmaps, they compress well.
+        QByteArray compressed = qCompress(data);
+        bool useCompressed = compressed.size() < data.size() * 3 / 4;
+        const QByteArray &packed = useCompressed ? compressed : data;
+
+        unsigned int lastFace = 0;
+        for ( FaceSelection::const_iterator it = faces.begin(); it != faces.end(); ++it )
+            lastFace = *it;
+
+        entries[i].facesOffset = offset;
+        entries[i].facesSize = packed.size();
+        entries[i].flags = useCompressed ? COMPRESSED_FACES : 0;
+        entries[i].faceCount = faces.size();
+        entries[i].lastFace = lastFace;
+        written = file.write(packed) == packed.size();
+        offset += packed.size();
+    }
+
+    written = written && file.seek(0)
+            && file.write(reinterpret_cast<const char*>(&header), sizeof(BinaryHeader)) == (qint64)sizeof(BinaryHeader);
+    if ( written && count > 0 )
+        written = file.write(reinterpret_cast<const char*>(&entries[0]), count * sizeof(BinaryEntry))
+                == (qint64)(count * sizeof(BinaryEntry));
+    written = written && file.write(strings) == strings.size();
+    file.close();
+
+    return written && file.error() == QFile::NoError;
+}
+
+bool BookmarkList::openBinary(QString path, int maxIndex, int *errors)
+{
+    _file = new QFile(path);
+    qint64 size = _file->size();
+    if ( !_file->open(QIODevice::ReadOnly) || size < (qint64)sizeof(BinaryHeader) )
+    {
+        unmapFile();
+        return false;
+    }
+
+    _map = _file->map(0, size);
+    if ( !_map )
+    {
+        unmapFile();
+        return false;
+    }
+
+    BinaryHeader header;
+    memcpy(&header, _map, sizeof(BinaryHeader));
+    bool valid = memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0
+            && header.version <= (quint32)BINARY_VERSION && header.byteOrder == BYTE_ORDER_MARK
+            && header.indexOffset <= (quint64)size && header.stringsOffset <= (quint64)size
+            && header.indexOffset + (quint64)header.count * sizeof(BinaryEntry) <= (quint64)size
+            && header.stringsSize <= (quint64)size - header.stringsOffset;
+
+    const char *data = reinterpret_cast<const char*>(_map);
+    const char *strings = data + header.stringsOffset;
+    for ( unsigned int i = 0; i < header.count && valid; ++i )
+    {
+        BinaryEntry entry;
+        memcpy(&entry, data + header.indexOffset + i * sizeof(BinaryEntry), sizeof(BinaryEntry));
+        valid = entry.facesOffset <= (quint64)size && entry.facesOffset + entry.facesSize <= (quint64)size
+                && (quint64)entry.nameOffset + entry.nameSize <= header.stringsSize
+                && (quint64)entry.commentsOffset + entry.commentsSize <= header.stringsSize;
+        if ( !valid )
+            break;
+
+        // Faces out of the model are dropped when decoded, all of them without a model.
+        int limit = -1;
+        if ( entry.faceCount > 0 && (maxIndex < 0 || entry.lastFace > (unsigned int)maxIndex) )
         {
-            int index = faceList[j].toInt();
-            if ( index <= maxIndex )
-                faceSet.insert(index);
-            else
-                errors++;
+            limit = maxIndex;
+            (*errors)++;
         }
 
-        Bookmark* bookmark = new Bookmark(nameNode.text(), commentsNode.text(), faceSet);
-        _list.push_back(bookmark);
+        QString name = QString::fromUtf8(strings + entry.nameOffset, entry.nameSize);
+        QString comments = QString::fromUtf8(strings + entry.commentsOffset, entry.commentsSize);
+        Bookmark* bookmark;
+        if ( maxIndex < 0 )
+            bookmark = new Bookmark(name, comments, FaceSelection());
+        else
+            bookmark = new Bookmark(name, comments, data + entry.facesOffset, entry.facesSize,
+                                    (entry.flags & COMPRESSED_FACES) != 0, limit);
+        append(bookmark);
     }
 
-    file->close();
+    if ( !valid )
+    {
+        clear();
+        return false;
+    }
 
     return true;
 }
+
+void BookmarkList::releaseFile()
+{
+    if ( !_file )
+        return;
+
+    for ( unsigned int i = 0; i < _list.size(); ++i )
+        _list[i]->getFaces();
+    unmapFile();
+}
+
+void BookmarkList::unmapFile()
+{
+    if ( !_file )
+        return;
+
+    if ( _map )
+        _file->unmap(_map);
+    _map = 0;
+    delete _file;
+    _file = 0;
+}
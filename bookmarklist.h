@@ -2,11 +2,15 @@
 #define BOOKMARKLIST_H
 
 #include <QFile>
-#include <QDomDocument>
+#include <QFileInfo>
 #include <QStringList>
-#include <QTextStream>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <map>
 #include <vector>
 #include "bookmark.h"
+#include "bookmarkindex.h"
+#include "bookmarkjournal.h"
 
 /**
  * This source file is part of 3DMarker.
@@ -30,6 +34,29 @@
  * The BookmarkList class represents the user's bookmarks list. The
  * bookmark list always contains almost one bookmark ('None' bookmark).
  * 'None' bookmark represents the no selection.
+ *
+ * Bookmark files are read and written as XML streams, face indices are
+ * formatted and parsed in chunks without building a document in memory.
+ * Version 1 files list every face index, comma separated. Version 2 files
+ * (<bookmarks version="2">) write <faces encoding="ranges"> as comma
+ * separated runs of consecutive faces, "gap" or "gap-count": the run
+ * starts gap faces after the end of the previous run, or after face 0 for
+ * the first run, and has count faces (1 if omitted). Both are read.
+ *
+ * Files saved with the BINARY_SUFFIX suffix use a binary container: a
+ * header, an index entry per bookmark, a table of UTF-8 names and
+ * comments, and the serialized faces of each bookmark, compressed when it
+ * pays off. Binary files are memory-mapped when opened, only the index
+ * and strings are read; faces are decoded when a bookmark is first used.
+ *
+ * Each bookmark gets an id that does not change when other bookmarks are
+ * deleted. The index of the bookmarks containing each face is built by
+ * buildIndex or the first bookmarksAt, which decode every bookmark, and
+ * is then updated by add, update and deleteAt.
+ *
+ * When a journal is set, add, update and deleteAt are also appended to it,
+ * so the edits since the list was last saved survive a crash and can be
+ * recovered on the next open.
  */
 class BookmarkList
 {
@@ -37,6 +64,82 @@ private:
 
     std::vector<Bookmark*> _list;       /**< List of bookmarks. */
     bool _updated;                      /**< Indicates if the list was updated. */
+    QFile* _file;                       /**< Binary file mapped, null if none. */
+    uchar* _map;                        /**< Mapped contents of the binary file. */
+    unsigned int _nextId;               /**< Id of the next bookmark added. */
+    std::map<unsigned int, Bookmark*> _ids;  /**< Bookmarks by id. */
+    BookmarkIndex _index;               /**< Bookmarks of each face. */
+    bool _indexed;                      /**< True when the index is built. */
+    BookmarkJournal _journal;           /**< Edits since the list was saved, if a journal is set. */
+    bool _journalError;                 /**< True if the journal stopped after a write error. */
+
+    /**
+     * @brief Append a bookmark, giving it an id.
+     * @param bookmark Bookmark to append.
+     */
+    void append(Bookmark *bookmark);
+
+    /**
+     * @brief Read a binary bookmark file. Faces are left in the mapped file.
+     * @param path File to read.
+     * @param maxIndex Maximum index allowed.
+     * @param errors Number of bookmarks with faces that exceed the maxIndex value, increased.
+     * @return True if loaded, false otherwise.
+     */
+    bool openBinary(QString path, int maxIndex, int *errors);
+
+    /**
+     * @brief Save the bookmark list to a binary file.
+     * @param path File path to save.
+     * @return True if saved, false otherwise.
+     */
+    bool saveBinary(QString path);
+
+    /**
+     * @brief Save the bookmark list to an XML file.
+     * @param path File path to save.
+     * @return True if saved, false otherwise.
+     */
+    bool saveXml(QString path);
+
+    /**
+     * @brief Compact the journal if it grew enough since its last snapshot.
+     */
+    void checkpointIfNeeded();
+
+    /**
+     * @brief Decode the faces of every bookmark and unmap the binary file.
+     */
+    void releaseFile();
+
+    /**
+     * @brief Unmap the binary file. Bookmarks not decoded must be dropped first.
+     */
+    void unmapFile();
+
+    /**
+     * @brief Read a <bookmark> element and add it to the list.
+     * @param reader XML reader, at the start of the element. Left at its end.
+     * @param maxIndex Maximum index allowed.
+     * @param errors Number of face index that exceed the maxIndex value, increased.
+     */
+    void readBookmark(QXmlStreamReader &reader, int maxIndex, int *errors);
+
+    /**
+     * @brief Read the face indices or runs of a <faces> element, as set by its encoding.
+     * @param reader XML reader, at the start of the element. Left at its end.
+     * @param maxIndex Maximum index allowed.
+     * @param errors Number of invalid face index or that exceed the maxIndex value, increased.
+     * @param faces Faces read, replaced.
+     */
+    static void readFaces(QXmlStreamReader &reader, int maxIndex, int *errors, FaceSelection *faces);
+
+    /**
+     * @brief Write the faces as comma separated runs, in increasing order.
+     * @param writer XML writer, inside the <faces> element.
+     * @param faces Faces to write.
+     */
+    static void writeFaces(QXmlStreamWriter &writer, const FaceSelection &faces);
 
 public:
 
@@ -45,6 +148,11 @@ public:
      */
     BookmarkList();
 
+    /**
+     * @brief Destructor. Unmaps the binary file.
+     */
+    ~BookmarkList();
+
     /**
      * @brief Return bookmark list.
      * @return Bookmark list.
@@ -76,6 +184,52 @@ public:
      */
     int size();
 
+    /**
+     * @brief Update the bookmark at index. The face index and the journal get
+     * the faces added and removed only.
+     * @param index Index position.
+     * @param name New name.
+     * @param comments New comments.
+     * @param faces New faces.
+     */
+    void update(unsigned int index, QString name, QString comments, const FaceSelection &faces);
+
+    /**
+     * @brief Return a bookmark by id.
+     * @param id Bookmark id.
+     * @return Bookmark, null if no bookmark has the id.
+     */
+    Bookmark* getById(unsigned int id);
+
+    /**
+     * @brief Build the index of the bookmarks of each face, if not built yet.
+     * Faces of bookmarks not decoded yet are decoded.
+     */
+    void buildIndex();
+
+    /**
+     * @brief Get if the index of the bookmarks of each face is built.
+     * @return True if built, false otherwise.
+     */
+    bool isIndexed() const;
+
+    /**
+     * @brief Return the bookmarks containing a face, in the order they were added.
+     * The index is built first if needed.
+     * @param face Face index.
+     * @param bookmarks Result bookmarks, replaced.
+     */
+    void bookmarksAt(unsigned int face, std::vector<Bookmark*> *bookmarks);
+
+    /**
+     * @brief Get if a bookmark contains a face, using the index if built.
+     * Otherwise only the bookmark asked for is decoded.
+     * @param face Face index.
+     * @param bookmark Bookmark of the list.
+     * @return True if contained, false otherwise.
+     */
+    bool contains(unsigned int face, Bookmark *bookmark);
+
     /**
      * @brief Delete bookmark at index.
      * @param index Index of bookmark to delete.
@@ -84,24 +238,78 @@ public:
 
     /**
      * @brief Clear the bookmark list and add the default bookmark 'None'.
+     * The journal is closed and deleted, its edits are saved or discarded.
      */
     void clear();
 
     /**
-     * @brief Read a bookmark list from file.
-     * @param path File to read.
+     * @brief Start journaling the edits of the list, from its current state.
+     * @param path Journal file, replaced. Empty to stop journaling.
+     * @param model Path of the model the faces refer to.
+     * @param faces Number of faces of the model.
+     * @param snapshot True to write the list as the first record, for a list
+     * not saved yet. Records of an existing file are kept until it is written.
+     * @return True if journaling, false otherwise (also if another instance uses the journal).
+     */
+    bool setJournal(QString path, QString model, unsigned int faces, bool snapshot = false);
+
+    /**
+     * @brief Get if the journal stopped after a write error since the last call.
+     * Later edits are only kept in memory until the list is saved.
+     * @return True if the journal stopped, false otherwise.
+     */
+    bool takeJournalError();
+
+    /**
+     * @brief Return the journal file.
+     * @return Journal file, empty if the list is not journaled.
+     */
+    QString getJournal() const;
+
+    /**
+     * @brief Apply the edits of a journal left by a previous session. Journaling
+     * stops, the file is not modified; setJournal with a snapshot goes next.
+     * @param path Journal file.
      * @param maxIndex Maximum index allowed.
      * @param errors Number of face index that exceed the maxIndex value.
+     * @param complete Result: false if an edit could not be applied, and the ones after it were skipped.
+     * @return Number of edits applied.
+     */
+    int recover(QString path, int maxIndex, int *errors, bool *complete);
+
+    /**
+     * @brief Return the journal file of a bookmark file.
+     * @param path Bookmark file.
+     * @return Journal file.
+     */
+    static QString journalPath(QString path);
+
+    /**
+     * @brief Read a bookmark list from file, XML or binary.
+     * @param path File to read.
+     * @param maxIndex Maximum index allowed.
+     * @param errors Result: how many references to faces out of maxIndex were dropped, counted per
+     * face, run of faces or malformed list in XML files and per bookmark in binary files.
+     * Zero if every face was kept.
      * @return True if loaded, false otherwise.
      */
     bool open(QString path, int maxIndex, int *errors);
 
     /**
-     * @brief Save the bookmark list to file.
+     * @brief Save the bookmark list to file, binary if the path has the BINARY_SUFFIX suffix.
+     * The list is written to a temporary file first, the file is replaced only if it was written.
+     * The previous file is moved to a backup meanwhile, and restored if the new one cannot take its place.
      * @param path File path to save.
+     * @param kept Result, optional: files left if neither the new nor the previous file could be put
+     * at path, empty otherwise.
      * @return True if saved, false otherwise.
      */
-    bool save(QString path);
+    bool save(QString path, QStringList *kept = 0);
+
+    static const int FACE_CHUNK = 65536;    /**< Characters or faces buffered while streaming faces. */
+    static const int FILE_VERSION = 2;      /**< Version of the files written. */
+    static const int BINARY_VERSION = 1;    /**< Version of the binary files written. */
+    static const char* const BINARY_SUFFIX; /**< Suffix of binary files. */
 
 };
 
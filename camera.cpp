@@ -0,0 +1,317 @@
+#include "camera.h"
+
+const float Camera::FOVY = 60.0;
+const float Camera::NEAR_PLANE = 0.01;
+const float Camera::FAR_PLANE = 10000.0;
+
+Camera::Camera()
+{
+    _distance = 1.0;
+    _hAngle = 0.0;
+    _vAngle = 0.0;
+    _target[0] = _target[1] = _target[2] = 0.0;
+    _eyeHeight = 1.0;
+    _width = 1;
+    _height = 1;
+}
+
+float Camera::getDistance() const
+{
+    return _distance;
+}
+
+void Camera::setDistance(float distance)
+{
+    _distance = distance;
+}
+
+float Camera::getHAngle() const
+{
+    return _hAngle;
+}
+
+void Camera::setHAngle(float angle)
+{
+    _hAngle = angle;
+}
+
+float Camera::getVAngle() const
+{
+    return _vAngle;
+}
+
+void Camera::setVAngle(float angle)
+{
+    _vAngle = angle;
+}
+
+void Camera::setTarget(float x, float y, float z)
+{
+    _target[0] = x;
+    _target[1] = y;
+    _target[2] = z;
+}
+
+void Camera::frame(const float center[3], float radius, const float normal[3])
+{
+    setTarget(center[0], center[1], center[2]);
+
+    // Rotate the model so the normal points to the viewer (+z in eye space).
+    double xz = sqrt(normal[0]*normal[0] + normal[2]*normal[2]);
+    _vAngle = atan2(-normal[0], normal[2]) * 180.0 / M_PI;
+    _hAngle = atan2(normal[1], xz) * 180.0 / M_PI;
+    if ( xz == 0.0 && normal[1] == 0.0 )
+        _vAngle = _hAngle = 0.0;
+
+    // Sphere fits in the field of view, with a small margin.
+    _eyeHeight = 0.0;
+    _distance = 1.1 * radius / sin(FOVY * M_PI / 360.0);
+    if ( _distance <= NEAR_PLANE )
+        _distance = 2.0 * NEAR_PLANE;
+}
+
+void Camera::setViewportSize(int width, int height)
+{
+    _width = width > 0 ? width : 1;
+    _height = height > 0 ? height : 1;
+}
+
+int Camera::getWidth() const
+{
+    return _width;
+}
+
+int Camera::getHeight() const
+{
+    return _height;
+}
+
+void Camera::getViewport(int viewport[4]) const
+{
+    float max, position = 0.0;
+    if (_width > _height)
+    {
+        max = _width;
+        position = (max - _height)/2;
+    }
+    else
+        max = _height;
+
+    viewport[0] = 0;
+    viewport[1] = -position;
+    viewport[2] = max;
+    viewport[3] = max;
+}
+
+void Camera::multiply(const double a[16], const double b[16], double result[16])
+{
+    double r[16];
+    for ( int col = 0; col < 4; ++col )
+        for ( int row = 0; row < 4; ++row )
+            r[col*4 + row] = a[row]    * b[col*4]
+                           + a[4+row]  * b[col*4 + 1]
+                           + a[8+row]  * b[col*4 + 2]
+                           + a[12+row] * b[col*4 + 3];
+
+    for ( int i = 0; i < 16; ++i )
+        result[i] = r[i];
+}
+
+bool Camera::invert(const double m[16], double result[16])
+{
+    double inv[16], det;
+
+    inv[0] = m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+    inv[4] = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+    inv[8] = m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+    inv[12] = -m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+    inv[1] = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+    inv[5] = m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+    inv[9] = -m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+    inv[13] = m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+    inv[2] = m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
+    inv[6] = -m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
+    inv[10] = m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
+    inv[14] = -m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
+    inv[3] = -m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
+    inv[7] = m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
+    inv[11] = -m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11] - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
+    inv[15] = m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10] + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
+
+    det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+    if ( det == 0.0 )
+        return false;
+
+    det = 1.0 / det;
+    for ( int i = 0; i < 16; ++i )
+        result[i] = inv[i] * det;
+
+    return true;
+}
+
+void Camera::modelView(double matrix[16]) const
+{
+    // gluLookAt(0, eyeHeight, distance, 0, 0, 0, 0, 1, 0)
+    double eye[3] = { 0.0, _eyeHeight, _distance };
+    double f[3] = { -eye[0], -eye[1], -eye[2] };
+    double len = sqrt(f[0]*f[0] + f[1]*f[1] + f[2]*f[2]);
+    f[0] /= len; f[1] /= len; f[2] /= len;
+
+    // s = f x up, up = (0, 1, 0)
+    double s[3] = { -f[2], 0.0, f[0] };
+    len = sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
+    s[0] /= len; s[1] /= len; s[2] /= len;
+
+    // u = s x f
+    double u[3] = { s[1]*f[2] - s[2]*f[1],
+                    s[2]*f[0] - s[0]*f[2],
+                    s[0]*f[1] - s[1]*f[0] };
+
+    double lookAt[16] = { s[0], u[0], -f[0], 0.0,
+                          s[1], u[1], -f[1], 0.0,
+                          s[2], u[2], -f[2], 0.0,
+                          0.0,  0.0,  0.0,   1.0 };
+    lookAt[12] = -(s[0]*eye[0] + s[1]*eye[1] + s[2]*eye[2]);
+    lookAt[13] = -(u[0]*eye[0] + u[1]*eye[1] + u[2]*eye[2]);
+    lookAt[14] =  (f[0]*eye[0] + f[1]*eye[1] + f[2]*eye[2]);
+
+    // glRotatef(hAngle, 1, 0, 0)
+    double h = _hAngle * M_PI / 180.0;
+    double rotationX[16] = { 1.0, 0.0,     0.0,    0.0,
+                             0.0, cos(h),  sin(h), 0.0,
+                             0.0, -sin(h), cos(h), 0.0,
+                             0.0, 0.0,     0.0,    1.0 };
+
+    // glRotatef(vAngle, 0, 1, 0)
+    double v = _vAngle * M_PI / 180.0;
+    double rotationY[16] = { cos(v), 0.0, -sin(v), 0.0,
+                             0.0,    1.0, 0.0,     0.0,
+                             sin(v), 0.0, cos(v),  0.0,
+                             0.0,    0.0, 0.0,     1.0 };
+
+    // glTranslatef(-target)
+    double translation[16] = { 1.0, 0.0, 0.0, 0.0,
+                               0.0, 1.0, 0.0, 0.0,
+                               0.0, 0.0, 1.0, 0.0,
+                               -_target[0], -_target[1], -_target[2], 1.0 };
+
+    multiply(lookAt, rotationX, matrix);
+    multiply(matrix, rotationY, matrix);
+    multiply(matrix, translation, matrix);
+}
+
+void Camera::projection(double matrix[16]) const
+{
+    // gluPerspective(FOVY, 1.0, NEAR_PLANE, FAR_PLANE)
+    double f = 1.0 / tan(FOVY * M_PI / 360.0);
+
+    for ( int i = 0; i < 16; ++i )
+        matrix[i] = 0.0;
+
+    matrix[0] = f;
+    matrix[5] = f;
+    matrix[10] = (FAR_PLANE + NEAR_PLANE) / (NEAR_PLANE - FAR_PLANE);
+    matrix[11] = -1.0;
+    matrix[14] = (2.0 * FAR_PLANE * NEAR_PLANE) / (NEAR_PLANE - FAR_PLANE);
+}
+
+void Camera::getModelViewMatrix(float matrix[16]) const
+{
+    double m[16];
+    modelView(m);
+    for ( int i = 0; i < 16; ++i )
+        matrix[i] = m[i];
+}
+
+void Camera::getProjectionMatrix(float matrix[16]) const
+{
+    double m[16];
+    projection(m);
+    for ( int i = 0; i < 16; ++i )
+        matrix[i] = m[i];
+}
+
+void Camera::getModelViewProjectionMatrix(float matrix[16]) const
+{
+    double mv[16], proj[16], mvp[16];
+    modelView(mv);
+    projection(proj);
+    multiply(proj, mv, mvp);
+    for ( int i = 0; i < 16; ++i )
+        matrix[i] = mvp[i];
+}
+
+float Camera::linearizeDepth(float depth)
+{
+    double ndcZ = 2.0 * depth - 1.0;
+    return (2.0 * FAR_PLANE * NEAR_PLANE) / ((FAR_PLANE + NEAR_PLANE) - ndcZ * (FAR_PLANE - NEAR_PLANE));
+}
+
+void Camera::getEye(float eye[3]) const
+{
+    double m[16], inverse[16];
+    modelView(m);
+    invert(m, inverse);
+
+    eye[0] = inverse[12];
+    eye[1] = inverse[13];
+    eye[2] = inverse[14];
+}
+
+bool Camera::getRay(int x, int y, float origin[3], float direction[3]) const
+{
+    double mv[16], proj[16], mvp[16], inverse[16];
+    modelView(mv);
+    projection(proj);
+    multiply(proj, mv, mvp);
+    if ( !invert(mvp, inverse) )
+        return false;
+
+    // Window to normalized device coordinates (same convention as picking).
+    int viewport[4];
+    getViewport(viewport);
+    double ndcX = 2.0 * (x - viewport[0]) / viewport[2] - 1.0;
+    double ndcY = 2.0 * ((_height - y) - viewport[1]) / viewport[3] - 1.0;
+
+    // Unproject near and far points.
+    double points[2][3];
+    for ( int i = 0; i < 2; ++i )
+    {
+        double ndcZ = (i == 0) ? -1.0 : 1.0;
+        double p[4];
+        for ( int row = 0; row < 4; ++row )
+            p[row] = inverse[row]*ndcX + inverse[4+row]*ndcY + inverse[8+row]*ndcZ + inverse[12+row];
+        if ( p[3] == 0.0 )
+            return false;
+        points[i][0] = p[0] / p[3];
+        points[i][1] = p[1] / p[3];
+        points[i][2] = p[2] / p[3];
+    }
+
+    double d[3] = { points[1][0] - points[0][0],
+                    points[1][1] - points[0][1],
+                    points[1][2] - points[0][2] };
+    double len = sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+    if ( len == 0.0 )
+        return false;
+
+    for ( int i = 0; i < 3; ++i )
+    {
+        origin[i] = points[0][i];
+        direction[i] = d[i] / len;
+    }
+
+    return true;
+}
+
+bool Camera::operator==(const Camera &other) const
+{
+    return _distance == other._distance && _hAngle == other._hAngle && _vAngle == other._vAngle
+            && _target[0] == other._target[0] && _target[1] == other._target[1] && _target[2] == other._target[2]
+            && _eyeHeight == other._eyeHeight && _width == other._width && _height == other._height;
+}
+
+bool Camera::operator!=(const Camera &other) const
+{
+    return !(*this == other);
+}
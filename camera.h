@@ -0,0 +1,158 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <math.h>
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The Camera class represents the viewer camera. It computes on the CPU
+ * the same matrices the viewer loads in OpenGL (gluLookAt + rotations and
+ * a 60 degrees perspective on a square viewport), so they can be used to
+ * project and unproject points without a GL context.
+ */
+class Camera
+{
+private:
+
+    float _distance;          /**< Camera distance from origin. */
+    float _hAngle;            /**< Camera horizontal angle (degrees). */
+    float _vAngle;            /**< Camera vertical angle (degrees). */
+    float _target[3];         /**< Point the camera rotates around and looks at. */
+    float _eyeHeight;         /**< Camera height over the target before rotation. */
+    int _width;               /**< Viewer width. */
+    int _height;              /**< Viewer height. */
+
+    /**
+     * @brief Multiply two column-major 4x4 matrices (result = a * b).
+     * @param a Left matrix.
+     * @param b Right matrix.
+     * @param result Result matrix.
+     */
+    static void multiply(const double a[16], const double b[16], double result[16]);
+
+    /**
+     * @brief Invert a column-major 4x4 matrix.
+     * @param m Matrix to invert.
+     * @param result Inverted matrix.
+     * @return True if matrix is invertible, false otherwise.
+     */
+    static bool invert(const double m[16], double result[16]);
+
+    void modelView(double matrix[16]) const;
+    void projection(double matrix[16]) const;
+
+public:
+
+    static const float FOVY;        /**< Vertical field of view (degrees). */
+    static const float NEAR_PLANE;  /**< Near clipping plane. */
+    static const float FAR_PLANE;   /**< Far clipping plane. */
+
+    /**
+     * @brief Default constructor.
+     */
+    Camera();
+
+    float getDistance() const;
+    void setDistance(float distance);
+    float getHAngle() const;
+    void setHAngle(float angle);
+    float getVAngle() const;
+    void setVAngle(float angle);
+
+    /**
+     * @brief Set the point the camera looks at. Default is the origin.
+     * @param x X coordinate.
+     * @param y Y coordinate.
+     * @param z Z coordinate.
+     */
+    void setTarget(float x, float y, float z);
+
+    /**
+     * @brief Place the camera to look at a sphere from the side a normal points to.
+     * @param center Sphere center.
+     * @param radius Sphere radius.
+     * @param normal Direction to look from (need not be normalized).
+     */
+    void frame(const float center[3], float radius, const float normal[3]);
+
+    /**
+     * @brief Set viewer size. Viewport is computed as in the viewer: a
+     * square of the biggest dimension, vertically centered.
+     * @param width Viewer width.
+     * @param height Viewer height.
+     */
+    void setViewportSize(int width, int height);
+    int getWidth() const;
+    int getHeight() const;
+
+    /**
+     * @brief Return the viewport (x, y, width, height) in GL window coordinates.
+     * @param viewport Result viewport.
+     */
+    void getViewport(int viewport[4]) const;
+
+    /**
+     * @brief Return the modelview matrix (column-major, as glLoadMatrixf).
+     * @param matrix Result matrix.
+     */
+    void getModelViewMatrix(float matrix[16]) const;
+
+    /**
+     * @brief Return the projection matrix (column-major, as glLoadMatrixf).
+     * @param matrix Result matrix.
+     */
+    void getProjectionMatrix(float matrix[16]) const;
+
+    /**
+     * @brief Return the projection * modelview matrix (column-major).
+     * @param matrix Result matrix.
+     */
+    void getModelViewProjectionMatrix(float matrix[16]) const;
+
+    /**
+     * @brief Convert a depth buffer value to distance along the view axis.
+     * @param depth Window depth, from 0 (near plane) to 1 (far plane).
+     * @return Eye space depth.
+     */
+    static float linearizeDepth(float depth);
+
+    /**
+     * @brief Return the camera position in model coordinates.
+     * @param eye Result position.
+     */
+    void getEye(float eye[3]) const;
+
+    /**
+     * @brief Build the ray under a viewer position (widget coordinates,
+     * origin at top-left corner) in model coordinates.
+     * @param x Horizontal mouse position.
+     * @param y Vertical mouse position.
+     * @param origin Ray origin.
+     * @param direction Normalized ray direction.
+     * @return True if ray was computed, false otherwise.
+     */
+    bool getRay(int x, int y, float origin[3], float direction[3]) const;
+
+    bool operator==(const Camera &other) const;
+    bool operator!=(const Camera &other) const;
+
+};
+
+#endif // CAMERA_H
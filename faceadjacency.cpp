@@ -0,0 +1,190 @@
+#include "faceadjacency.h"
+
+#include <algorithm>
+#include <cmath>
+#include "parallel.h"
+
+/**
+ * @brief Compute the normal (Newell's method) and centroid of each face.
+ */
+struct FaceGeometryKernel
+{
+    Model *model;
+    float *normals;
+    float *centers;
+
+    void operator()(const ParallelRange &range) const
+    {
+        for ( unsigned int f = range.begin; f < range.end; ++f )
+        {
+            Poly *poly = model->getPolyAt(f);
+            float nx = 0.0, ny = 0.0, nz = 0.0;
+            float cx = 0.0, cy = 0.0, cz = 0.0;
+            for ( int j = 0; j < poly->size(); ++j )
+            {
+                Vertex *a = model->getVertexAt(poly->getAt(j));
+                Vertex *b = model->getVertexAt(poly->getAt((j + 1) % poly->size()));
+                nx += (a->getY() - b->getY()) * (a->getZ() + b->getZ());
+                ny += (a->getZ() - b->getZ()) * (a->getX() + b->getX());
+                nz += (a->getX() - b->getX()) * (a->getY() + b->getY());
+                cx += a->getX();
+                cy += a->getY();
+                cz += a->getZ();
+            }
+
+            float length = sqrt(nx*nx + ny*ny + nz*nz);
+            if ( length > 0.0 )
+            {
+                nx /= length;
+                ny /= length;
+                nz /= length;
+            }
+            normals[3*f] = nx;
+            normals[3*f + 1] = ny;
+            normals[3*f + 2] = nz;
+
+            float count = poly->size() > 0 ? poly->size() : 1;
+            centers[3*f] = cx / count;
+            centers[3*f + 1] = cy / count;
+            centers[3*f + 2] = cz / count;
+        }
+    }
+};
+
+/**
+ * @brief Compute the angle between the normals of each face and its neighbors.
+ */
+struct NeighborAngleKernel
+{
+    const unsigned int *first;
+    const unsigned int *neighbors;
+    const float *normals;
+    float *angles;
+
+    void operator()(const ParallelRange &range) const
+    {
+        for ( unsigned int f = range.begin; f < range.end; ++f )
+        {
+            const float *n = normals + 3*f;
+            for ( unsigned int i = first[f]; i < first[f + 1]; ++i )
+            {
+                const float *m = normals + 3*neighbors[i];
+                float cosine = n[0]*m[0] + n[1]*m[1] + n[2]*m[2];
+                angles[i] = acos(std::max(-1.0f, std::min(1.0f, cosine)));
+            }
+        }
+    }
+};
+
+FaceAdjacency::FaceAdjacency()
+{
+}
+
+void FaceAdjacency::clear()
+{
+    _first.clear();
+    _neighbors.clear();
+    _angles.clear();
+    _normals.clear();
+    _centers.clear();
+}
+
+void FaceAdjacency::swap(FaceAdjacency &other)
+{
+    _first.swap(other._first);
+    _neighbors.swap(other._neighbors);
+    _angles.swap(other._angles);
+    _normals.swap(other._normals);
+    _centers.swap(other._centers);
+}
+
+unsigned int FaceAdjacency::numFaces() const
+{
+    return _first.empty() ? 0 : _first.size() - 1;
+}
+
+unsigned int FaceAdjacency::first(unsigned int face) const
+{
+    return _first[face];
+}
+
+unsigned int FaceAdjacency::last(unsigned int face) const
+{
+    return _first[face + 1];
+}
+
+unsigned int FaceAdjacency::getNeighbor(unsigned int entry) const
+{
+    return _neighbors[entry];
+}
+
+float FaceAdjacency::getAngle(unsigned int entry) const
+{
+    return _angles[entry];
+}
+
+const float* FaceAdjacency::getNormal(unsigned int face) const
+{
+    return &_normals[3*face];
+}
+
+const float* FaceAdjacency::getCenter(unsigned int face) const
+{
+    return &_centers[3*face];
+}
+
+void FaceAdjacency::build(Model *model, const MeshEdges &edges)
+{
+    clear();
+
+    unsigned int numFaces = model->numPoly();
+    if ( numFaces == 0 )
+        return;
+
+    // Count the interior edges of each face.
+    _first.assign(numFaces + 1, 0);
+    for ( unsigned int e = 0; e < edges.size(); ++e )
+    {
+        unsigned int a = edges.getFace(e, 0);
+        unsigned int b = edges.getFace(e, 1);
+        if ( b == MeshEdges::NO_FACE )
+            continue;
+        _first[a + 1]++;
+        _first[b + 1]++;
+    }
+
+    for ( unsigned int f = 0; f < numFaces; ++f )
+        _first[f + 1] += _first[f];
+
+    // Each interior edge links its two faces both ways.
+    _neighbors.resize(_first[numFaces]);
+    std::vector<unsigned int> next(_first.begin(), _first.end() - 1);
+    for ( unsigned int e = 0; e < edges.size(); ++e )
+    {
+        unsigned int a = edges.getFace(e, 0);
+        unsigned int b = edges.getFace(e, 1);
+        if ( b == MeshEdges::NO_FACE )
+            continue;
+        _neighbors[next[a]++] = b;
+        _neighbors[next[b]++] = a;
+    }
+
+    _normals.resize(3 * numFaces);
+    _centers.resize(3 * numFaces);
+    FaceGeometryKernel geometry;
+    geometry.model = model;
+    geometry.normals = &_normals[0];
+    geometry.centers = &_centers[0];
+    parallelFor(numFaces, geometry);
+
+    _angles.resize(_neighbors.size());
+    if ( !_angles.empty() )
+    {
+        NeighborAngleKernel angles;
+        angles.first = &_first[0];
+        angles.neighbors = &_neighbors[0];
+        angles.normals = &_normals[0];
+        angles.angles = &_angles[0];
+        parallelFor(numFaces, angles);
+    }
+}
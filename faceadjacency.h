@@ -0,0 +1,118 @@
+#ifndef FACEADJACENCY_H
+#define FACEADJACENCY_H
+
+#include <vector>
+#include "model.h"
+#include "meshedges.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The FaceAdjacency class keeps, for each face of a model, the faces
+ * sharing an edge with it, in a compressed row layout: the neighbors of
+ * face f are the entries [first(f), last(f)). Each entry also keeps the
+ * angle between the normals of both faces, so tools walking the surface
+ * do not compute it again. Built from the unique edges of the model.
+ */
+class FaceAdjacency
+{
+private:
+
+    std::vector<unsigned int> _first;       /**< First entry of each face, one extra at end. */
+    std::vector<unsigned int> _neighbors;   /**< Neighbor face of each entry. */
+    std::vector<float> _angles;             /**< Angle between face normals of each entry (radians). */
+    std::vector<float> _normals;            /**< Unit normal of each face (x, y, z). */
+    std::vector<float> _centers;            /**< Centroid of each face (x, y, z). */
+
+public:
+
+    /**
+     * @brief Default constructor.
+     */
+    FaceAdjacency();
+
+    /**
+     * @brief Build the adjacency of a model. Runs in parallel.
+     * @param model Model to process.
+     * @param edges Unique edges of the model.
+     */
+    void build(Model *model, const MeshEdges &edges);
+
+    /**
+     * @brief Clear the adjacency.
+     */
+    void clear();
+
+    /**
+     * @brief Exchange the adjacency with another instance.
+     * @param other Adjacency to exchange with.
+     */
+    void swap(FaceAdjacency &other);
+
+    /**
+     * @brief Return number of faces.
+     * @return Number of faces, 0 if not built.
+     */
+    unsigned int numFaces() const;
+
+    /**
+     * @brief Return first entry of a face.
+     * @param face Face index.
+     * @return Entry index.
+     */
+    unsigned int first(unsigned int face) const;
+
+    /**
+     * @brief Return the entry after the last one of a face.
+     * @param face Face index.
+     * @return Entry index.
+     */
+    unsigned int last(unsigned int face) const;
+
+    /**
+     * @brief Return the neighbor face of an entry.
+     * @param entry Entry index.
+     * @return Face index.
+     */
+    unsigned int getNeighbor(unsigned int entry) const;
+
+    /**
+     * @brief Return the angle between the normals of a face and the neighbor of an entry.
+     * @param entry Entry index.
+     * @return Angle in radians, from 0 to pi.
+     */
+    float getAngle(unsigned int entry) const;
+
+    /**
+     * @brief Return the unit normal of a face.
+     * @param face Face index.
+     * @return Normal (x, y, z). Zero for degenerate faces.
+     */
+    const float* getNormal(unsigned int face) const;
+
+    /**
+     * @brief Return the centroid of a face.
+     * @param face Face index.
+     * @return Centroid (x, y, z).
+     */
+    const float* getCenter(unsigned int face) const;
+
+};
+
+#endif // FACEADJACENCY_H
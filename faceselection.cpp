@@ -0,0 +1,769 @@
+#include "faceselection.h"
+
+#include <algorithm>
+#include <string.h>
+
+/**
+ * @brief Return number of bits set in a word.
+ */
+static inline unsigned int popCount(unsigned long long word)
+{
+#ifdef __GNUC__
+    return __builtin_popcountll(word);
+#else
+    unsigned int count = 0;
+    for ( ; word != 0; word &= word - 1 )
+        ++count;
+    return count;
+#endif
+}
+
+/**
+ * @brief Return index of the lowest bit set in a word. Word must not be 0.
+ */
+static inline unsigned int lowestBit(unsigned long long word)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(word);
+#else
+    unsigned int index = 0;
+    for ( ; (word & 1) == 0; word >>= 1 )
+        ++index;
+    return index;
+#endif
+}
+
+/**
+ * @brief Return the bit of a low value in its bitmap word.
+ */
+static inline unsigned long long bitOf(unsigned int low)
+{
+    return 1ULL << (low & 63);
+}
+
+FaceSelection::FaceSelection() : d(new Data())
+{
+}
+
+unsigned int FaceSelection::size() const
+{
+    return d->size;
+}
+
+bool FaceSelection::isEmpty() const
+{
+    return d->size == 0;
+}
+
+void FaceSelection::clear()
+{
+    // Other copies keep the blocks.
+    if ( d->size > 0 )
+        d = new Data();
+}
+
+void FaceSelection::toBitmap(Container &container)
+{
+    if ( container.isBitmap() )
+        return;
+
+    container.bitmap.assign(BITMAP_WORDS, 0);
+    std::vector<unsigned short>::const_iterator it = container.array.begin();
+    for ( ; it != container.array.end(); ++it )
+        container.bitmap[*it >> 6] |= bitOf(*it);
+    std::vector<unsigned short>().swap(container.array);
+}
+
+void FaceSelection::shrink(Container &container)
+{
+    if ( !container.isBitmap() || container.cardinality > ARRAY_MAX )
+        return;
+
+    container.array.reserve(container.cardinality);
+    for ( unsigned int word = 0; word < BITMAP_WORDS; ++word )
+    {
+        unsigned long long bits = container.bitmap[word];
+        for ( ; bits != 0; bits &= bits - 1 )
+            container.array.push_back((word << 6) + lowestBit(bits));
+    }
+    std::vector<unsigned long long>().swap(container.bitmap);
+}
+
+void FaceSelection::count(Container &container)
+{
+    if ( !container.isBitmap() )
+    {
+        container.cardinality = container.array.size();
+        return;
+    }
+
+    unsigned int cardinality = 0;
+    for ( unsigned int word = 0; word < BITMAP_WORDS; ++word )
+        cardinality += popCount(container.bitmap[word]);
+    container.cardinality = cardinality;
+}
+
+bool FaceSelection::contains(unsigned int face) const
+{
+    ContainerMap::const_iterator found = d->containers.find(face >> 16);
+    if ( found == d->containers.end() )
+        return false;
+
+    const Container &container = found->second;
+    unsigned int low = face & 0xffff;
+    if ( container.isBitmap() )
+        return (container.bitmap[low >> 6] & bitOf(low)) != 0;
+
+    return std::binary_search(container.array.begin(), container.array.end(), (unsigned short)low);
+}
+
+bool FaceSelection::insert(unsigned int face)
+{
+    // Shared blocks are not copied when nothing changes.
+    if ( contains(face) )
+        return false;
+
+    Data *data = d.data();
+    Container &container = data->containers[face >> 16];
+    unsigned int low = face & 0xffff;
+
+    if ( !container.isBitmap() && container.array.size() >= ARRAY_MAX )
+        toBitmap(container);
+
+    if ( container.isBitmap() )
+        container.bitmap[low >> 6] |= bitOf(low);
+    else
+        container.array.insert(std::lower_bound(container.array.begin(), container.array.end(), (unsigned short)low),
+                               (unsigned short)low);
+
+    ++container.cardinality;
+    ++data->size;
+    return true;
+}
+
+bool FaceSelection::remove(unsigned int face)
+{
+    // Shared blocks are not copied when nothing changes.
+    if ( !contains(face) )
+        return false;
+
+    Data *data = d.data();
+    ContainerMap::iterator found = data->containers.find(face >> 16);
+    Container &container = found->second;
+    unsigned int low = face & 0xffff;
+
+    if ( container.isBitmap() )
+        container.bitmap[low >> 6] &= ~bitOf(low);
+    else
+        container.array.erase(std::lower_bound(container.array.begin(), container.array.end(), (unsigned short)low));
+
+    --container.cardinality;
+    --data->size;
+
+    // Bitmaps go back to arrays well below the limit, so a face added and
+    // removed at the limit does not convert the block every time.
+    if ( container.cardinality == 0 )
+        data->containers.erase(found);
+    else if ( container.cardinality < ARRAY_MAX / 2 )
+        shrink(container);
+
+    return true;
+}
+
+void FaceSelection::insert(const std::vector<unsigned int> &faces)
+{
+    if ( faces.empty() )
+        return;
+
+    Data *data = d.data();
+    unsigned int i = 0;
+    while ( i < faces.size() )
+    {
+        // Run of faces of the same block.
+        unsigned int key = faces[i] >> 16;
+        unsigned int first = i;
+        while ( i < faces.size() && (faces[i] >> 16) == key )
+            ++i;
+
+        Container &container = data->containers[key];
+        data->size -= container.cardinality;
+
+        if ( !container.isBitmap() && container.array.size() + (i - first) > ARRAY_MAX )
+            toBitmap(container);
+
+        if ( container.isBitmap() )
+        {
+            for ( unsigned int j = first; j < i; ++j )
+                container.bitmap[(faces[j] & 0xffff) >> 6] |= bitOf(faces[j]);
+            count(container);
+            shrink(container);
+        }
+        else
+        {
+            std::vector<unsigned short> added(i - first);
+            for ( unsigned int j = first; j < i; ++j )
+                added[j - first] = faces[j] & 0xffff;
+            std::sort(added.begin(), added.end());
+            added.erase(std::unique(added.begin(), added.end()), added.end());
+
+            std::vector<unsigned short> merged(container.array.size() + added.size());
+            merged.erase(std::set_union(container.array.begin(), container.array.end(),
+                                        added.begin(), added.end(), merged.begin()), merged.end());
+            container.array.swap(merged);
+            count(container);
+        }
+
+        data->size += container.cardinality;
+    }
+}
+
+void FaceSelection::remove(const std::vector<unsigned int> &faces)
+{
+    if ( faces.empty() || isEmpty() )
+        return;
+
+    Data *data = d.data();
+    unsigned int i = 0;
+    while ( i < faces.size() )
+    {
+        // Run of faces of the same block.
+        unsigned int key = faces[i] >> 16;
+        unsigned int first = i;
+        while ( i < faces.size() && (faces[i] >> 16) == key )
+            ++i;
+
+        ContainerMap::iterator found = data->containers.find(key);
+        if ( found == data->containers.end() )
+            continue;
+
+        Container &container = found->second;
+        data->size -= container.cardinality;
+
+        if ( container.isBitmap() )
+        {
+            for ( unsigned int j = first; j < i; ++j )
+                container.bitmap[(faces[j] & 0xffff) >> 6] &= ~bitOf(faces[j]);
+            count(container);
+            shrink(container);
+        }
+        else
+        {
+            std::vector<unsigned short> removed(i - first);
+            for ( unsigned int j = first; j < i; ++j )
+                removed[j - first] = faces[j] & 0xffff;
+            std::sort(removed.begin(), removed.end());
+
+            std::vector<unsigned short> kept(container.array.size());
+            kept.erase(std::set_difference(container.array.begin(), container.array.end(),
+                                           removed.begin(), removed.end(), kept.begin()), kept.end());
+            container.array.swap(kept);
+            count(container);
+        }
+
+        data->size += container.cardinality;
+        if ( container.cardinality == 0 )
+            data->containers.erase(found);
+    }
+}
+
+void FaceSelection::uniteContainer(Container &target, const Container &source)
+{
+    if ( source.isBitmap() )
+    {
+        std::vector<unsigned long long> bitmap(source.bitmap);
+        if ( target.isBitmap() )
+            for ( unsigned int word = 0; word < BITMAP_WORDS; ++word )
+                bitmap[word] |= target.bitmap[word];
+        else
+            for ( unsigned int k = 0; k < target.array.size(); ++k )
+                bitmap[target.array[k] >> 6] |= bitOf(target.array[k]);
+
+        target.bitmap.swap(bitmap);
+        std::vector<unsigned short>().swap(target.array);
+    }
+    else if ( target.isBitmap() )
+    {
+        for ( unsigned int k = 0; k < source.array.size(); ++k )
+            target.bitmap[source.array[k] >> 6] |= bitOf(source.array[k]);
+    }
+    else
+    {
+        std::vector<unsigned short> merged(target.array.size() + source.array.size());
+        merged.erase(std::set_union(target.array.begin(), target.array.end(),
+                                    source.array.begin(), source.array.end(), merged.begin()), merged.end());
+        target.array.swap(merged);
+        if ( target.array.size() > ARRAY_MAX )
+            toBitmap(target);
+    }
+
+    count(target);
+}
+
+void FaceSelection::intersectContainer(Container &target, const Container &source)
+{
+    if ( target.isBitmap() && source.isBitmap() )
+    {
+        for ( unsigned int word = 0; word < BITMAP_WORDS; ++word )
+            target.bitmap[word] &= source.bitmap[word];
+        count(target);
+        shrink(target);
+        return;
+    }
+
+    // At least one array: the result is an array.
+    std::vector<unsigned short> kept;
+    if ( target.isBitmap() )
+    {
+        for ( unsigned int k = 0; k < source.array.size(); ++k )
+            if ( target.bitmap[source.array[k] >> 6] & bitOf(source.array[k]) )
+                kept.push_back(source.array[k]);
+        std::vector<unsigned long long>().swap(target.bitmap);
+    }
+    else if ( source.isBitmap() )
+    {
+        for ( unsigned int k = 0; k < target.array.size(); ++k )
+            if ( source.bitmap[target.array[k] >> 6] & bitOf(target.array[k]) )
+                kept.push_back(target.array[k]);
+    }
+    else
+    {
+        kept.resize(std::min(target.array.size(), source.array.size()));
+        kept.erase(std::set_intersection(target.array.begin(), target.array.end(),
+                                         source.array.begin(), source.array.end(), kept.begin()), kept.end());
+    }
+
+    target.array.swap(kept);
+    count(target);
+}
+
+void FaceSelection::subtractContainer(Container &target, const Container &source)
+{
+    if ( target.isBitmap() )
+    {
+        if ( source.isBitmap() )
+            for ( unsigned int word = 0; word < BITMAP_WORDS; ++word )
+                target.bitmap[word] &= ~source.bitmap[word];
+        else
+            for ( unsigned int k = 0; k < source.array.size(); ++k )
+                target.bitmap[source.array[k] >> 6] &= ~bitOf(source.array[k]);
+        count(target);
+        shrink(target);
+        return;
+    }
+
+    std::vector<unsigned short> kept;
+    if ( source.isBitmap() )
+    {
+        for ( unsigned int k = 0; k < target.array.size(); ++k )
+            if ( (source.bitmap[target.array[k] >> 6] & bitOf(target.array[k])) == 0 )
+                kept.push_back(target.array[k]);
+    }
+    else
+    {
+        kept.resize(target.array.size());
+        kept.erase(std::set_difference(target.array.begin(), target.array.end(),
+                                       source.array.begin(), source.array.end(), kept.begin()), kept.end());
+    }
+
+    target.array.swap(kept);
+    count(target);
+}
+
+void FaceSelection::toggleContainer(Container &target, const Container &source)
+{
+    if ( target.isBitmap() || source.isBitmap() )
+    {
+        toBitmap(target);
+        if ( source.isBitmap() )
+            for ( unsigned int word = 0; word < BITMAP_WORDS; ++word )
+                target.bitmap[word] ^= source.bitmap[word];
+        else
+            for ( unsigned int k = 0; k < source.array.size(); ++k )
+                target.bitmap[source.array[k] >> 6] ^= bitOf(source.array[k]);
+        count(target);
+        shrink(target);
+        return;
+    }
+
+    std::vector<unsigned short> merged(target.array.size() + source.array.size());
+    merged.erase(std::set_symmetric_difference(target.array.begin(), target.array.end(),
+                                               source.array.begin(), source.array.end(), merged.begin()), merged.end());
+    target.array.swap(merged);
+    if ( target.array.size() > ARRAY_MAX )
+        toBitmap(target);
+
+    count(target);
+}
+
+FaceSelection& FaceSelection::unite(const FaceSelection &other)
+{
+    if ( d == other.d || other.isEmpty() )
+        return *this;
+
+    if ( isEmpty() )
+    {
+        d = other.d;
+        return *this;
+    }
+
+    Data *data = d.data();
+    ContainerMap::const_iterator it = other.d->containers.begin();
+    for ( ; it != other.d->containers.end(); ++it )
+    {
+        Container &container = data->containers[it->first];
+        data->size -= container.cardinality;
+        if ( container.cardinality == 0 )
+            container = it->second;
+        else
+            uniteContainer(container, it->second);
+        data->size += container.cardinality;
+    }
+
+    return *this;
+}
+
+FaceSelection& FaceSelection::intersect(const FaceSelection &other)
+{
+    if ( d == other.d || isEmpty() )
+        return *this;
+
+    if ( other.isEmpty() )
+    {
+        clear();
+        return *this;
+    }
+
+    Data *data = d.data();
+    ContainerMap::iterator it = data->containers.begin();
+    while ( it != data->containers.end() )
+    {
+        data->size -= it->second.cardinality;
+
+        ContainerMap::const_iterator found = other.d->containers.find(it->first);
+        if ( found != other.d->containers.end() )
+        {
+            intersectContainer(it->second, found->second);
+            data->size += it->second.cardinality;
+        }
+        else
+            it->second.cardinality = 0;
+
+        if ( it->second.cardinality == 0 )
+            data->containers.erase(it++);
+        else
+            ++it;
+    }
+
+    return *this;
+}
+
+FaceSelection& FaceSelection::subtract(const FaceSelection &other)
+{
+    if ( d == other.d )
+    {
+        clear();
+        return *this;
+    }
+
+    if ( isEmpty() || other.isEmpty() )
+        return *this;
+
+    Data *data = d.data();
+    ContainerMap::iterator it = data->containers.begin();
+    while ( it != data->containers.end() )
+    {
+        ContainerMap::const_iterator found = other.d->containers.find(it->first);
+        if ( found != other.d->containers.end() )
+        {
+            data->size -= it->second.cardinality;
+            subtractContainer(it->second, found->second);
+            data->size += it->second.cardinality;
+        }
+
+        if ( it->second.cardinality == 0 )
+            data->containers.erase(it++);
+        else
+            ++it;
+    }
+
+    return *this;
+}
+
+FaceSelection& FaceSelection::symmetricDifference(const FaceSelection &other)
+{
+    if ( d == other.d )
+    {
+        clear();
+        return *this;
+    }
+
+    if ( other.isEmpty() )
+        return *this;
+
+    if ( isEmpty() )
+    {
+        d = other.d;
+        return *this;
+    }
+
+    Data *data = d.data();
+    ContainerMap::const_iterator it = other.d->containers.begin();
+    for ( ; it != other.d->containers.end(); ++it )
+    {
+        Container &container = data->containers[it->first];
+        data->size -= container.cardinality;
+        if ( container.cardinality == 0 )
+            container = it->second;
+        else
+            toggleContainer(container, it->second);
+        data->size += container.cardinality;
+
+        if ( container.cardinality == 0 )
+            data->containers.erase(it->first);
+    }
+
+    return *this;
+}
+
+void FaceSelection::toVector(std::vector<unsigned int> *faces) const
+{
+    faces->clear();
+    faces->reserve(d->size);
+
+    ContainerMap::const_iterator it = d->containers.begin();
+    for ( ; it != d->containers.end(); ++it )
+    {
+        unsigned int high = (unsigned int)it->first << 16;
+        const Container &container = it->second;
+        if ( container.isBitmap() )
+        {
+            for ( unsigned int word = 0; word < BITMAP_WORDS; ++word )
+            {
+                unsigned long long bits = container.bitmap[word];
+                for ( ; bits != 0; bits &= bits - 1 )
+                    faces->push_back(high | ((word << 6) + lowestBit(bits)));
+            }
+        }
+        else
+        {
+            for ( unsigned int k = 0; k < container.array.size(); ++k )
+                faces->push_back(high | container.array[k]);
+        }
+    }
+}
+
+unsigned int FaceSelection::serializedSize() const
+{
+    unsigned int bytes = 4;
+    ContainerMap::const_iterator it = d->containers.begin();
+    for ( ; it != d->containers.end(); ++it )
+        bytes += 8 + (it->second.isBitmap() ? BITMAP_WORDS * 8 : it->second.cardinality * 2);
+
+    return bytes;
+}
+
+void FaceSelection::serialize(char *data) const
+{
+    unsigned int blocks = d->containers.size();
+    memcpy(data, &blocks, 4);
+    data += 4;
+
+    ContainerMap::const_iterator it = d->containers.begin();
+    for ( ; it != d->containers.end(); ++it )
+    {
+        const Container &container = it->second;
+        unsigned short header[2] = { it->first, container.isBitmap() };
+        memcpy(data, header, 4);
+        memcpy(data + 4, &container.cardinality, 4);
+        data += 8;
+
+        if ( container.isBitmap() )
+        {
+            memcpy(data, &container.bitmap[0], BITMAP_WORDS * 8);
+            data += BITMAP_WORDS * 8;
+        }
+        else
+        {
+            memcpy(data, &container.array[0], container.cardinality * 2);
+            data += container.cardinality * 2;
+        }
+    }
+}
+
+bool FaceSelection::deserialize(const char *data, unsigned int size)
+{
+    clear();
+    if ( size < 4 )
+        return false;
+
+    unsigned int blocks;
+    memcpy(&blocks, data, 4);
+    unsigned int position = 4;
+
+    Data *result = new Data();
+    d = result;
+    bool valid = true;
+    for ( unsigned int b = 0; b < blocks && valid; ++b )
+    {
+        unsigned short header[2];
+        unsigned int cardinality;
+        valid = position + 8 <= size;
+        if ( !valid )
+            break;
+        memcpy(header, data + position, 4);
+        memcpy(&cardinality, data + position + 4, 4);
+        position += 8;
+
+        // Blocks are sorted and non empty. Removing faces leaves bitmaps down to ARRAY_MAX / 2 faces.
+        bool bitmap = header[1] != 0;
+        unsigned int bytes = bitmap ? BITMAP_WORDS * 8 : cardinality * 2;
+        valid = (result->containers.empty() || header[0] > result->containers.rbegin()->first)
+                && cardinality > 0 && (bitmap || cardinality <= ARRAY_MAX) && position + bytes <= size;
+        if ( !valid )
+            break;
+
+        Container &container = result->containers[header[0]];
+        if ( bitmap )
+        {
+            container.bitmap.resize(BITMAP_WORDS);
+            memcpy(&container.bitmap[0], data + position, bytes);
+            count(container);
+            valid = container.cardinality == cardinality;
+        }
+        else
+        {
+            container.array.resize(cardinality);
+            memcpy(&container.array[0], data + position, bytes);
+            container.cardinality = cardinality;
+            for ( unsigned int k = 1; k < cardinality && valid; ++k )
+                valid = container.array[k - 1] < container.array[k];
+        }
+        position += bytes;
+        result->size += cardinality;
+    }
+
+    if ( !valid || position != size )
+    {
+        d = new Data();
+        return false;
+    }
+
+    return true;
+}
+
+unsigned int FaceSelection::memoryUsage() const
+{
+    // Map node overhead is estimated. Shared blocks are counted by each copy.
+    unsigned int bytes = sizeof(Data);
+    ContainerMap::const_iterator it = d->containers.begin();
+    for ( ; it != d->containers.end(); ++it )
+        bytes += sizeof(Container) + 4 * sizeof(void*)
+               + it->second.array.capacity() * sizeof(unsigned short)
+               + it->second.bitmap.capacity() * sizeof(unsigned long long);
+
+    return bytes;
+}
+
+FaceSelection::const_iterator FaceSelection::begin() const
+{
+    const_iterator it;
+    it._container = d->containers.begin();
+    it._end = d->containers.end();
+    it._position = 0;
+    it.settle();
+    return it;
+}
+
+FaceSelection::const_iterator FaceSelection::end() const
+{
+    const_iterator it;
+    it._container = d->containers.end();
+    it._end = d->containers.end();
+    it._position = 0;
+    return it;
+}
+
+bool FaceSelection::operator==(const FaceSelection &other) const
+{
+    if ( d == other.d )
+        return true;
+    if ( d->size != other.d->size )
+        return false;
+
+    // Equal sets can have different containers, compare the faces.
+    const_iterator a = begin(), b = other.begin();
+    for ( ; a != end(); ++a, ++b )
+        if ( *a != *b )
+            return false;
+
+    return true;
+}
+
+bool FaceSelection::operator!=(const FaceSelection &other) const
+{
+    return !(*this == other);
+}
+
+void FaceSelection::const_iterator::settle()
+{
+    while ( _container != _end )
+    {
+        const Container &container = _container->second;
+        if ( container.isBitmap() )
+        {
+            // Next bit set at or after the position.
+            unsigned int word = _position >> 6;
+            if ( word < BITMAP_WORDS )
+            {
+                unsigned long long bits = container.bitmap[word] & (~0ULL << (_position & 63));
+                while ( true )
+                {
+                    if ( bits != 0 )
+                    {
+                        _position = (word << 6) + lowestBit(bits);
+                        return;
+                    }
+                    if ( ++word == BITMAP_WORDS )
+                        break;
+                    bits = container.bitmap[word];
+                }
+            }
+        }
+        else if ( _position < container.array.size() )
+            return;
+
+        ++_container;
+        _position = 0;
+    }
+}
+
+unsigned int FaceSelection::const_iterator::operator*() const
+{
+    const Container &container = _container->second;
+    unsigned int high = (unsigned int)_container->first << 16;
+    return high | (container.isBitmap() ? _position : container.array[_position]);
+}
+
+FaceSelection::const_iterator& FaceSelection::const_iterator::operator++()
+{
+    ++_position;
+    settle();
+    return *this;
+}
+
+FaceSelection::const_iterator FaceSelection::const_iterator::operator++(int)
+{
+    const_iterator previous = *this;
+    ++(*this);
+    return previous;
+}
+
+bool FaceSelection::const_iterator::operator==(const const_iterator &other) const
+{
+    return _container == other._container && _position == other._position;
+}
+
+bool FaceSelection::const_iterator::operator!=(const const_iterator &other) const
+{
+    return !(*this == other);
+}
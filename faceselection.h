@@ -0,0 +1,279 @@
+#ifndef FACESELECTION_H
+#define FACESELECTION_H
+
+#include <map>
+#include <vector>
+#include <QSharedData>
+#include <QSharedDataPointer>
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The FaceSelection class is a set of face indices stored as a compressed
+ * bitmap. Faces are split in blocks of 65536 by their high 16 bits. Each
+ * block keeps its low 16 bits in a sorted array while it has at most
+ * ARRAY_MAX faces (2 bytes per face), and in a 65536 bit bitmap above
+ * that (8 KB per block). Faces are iterated in increasing order, like a
+ * std::set, and set operations work block by block, on 64 bit words
+ * when both blocks are bitmaps.
+ *
+ * Selections can be serialized as their blocks, in host byte order: the
+ * number of blocks (32 bits), then for each block its high bits (16
+ * bits), 1 if it is a bitmap or 0 (16 bits), its number of faces (32
+ * bits) and its sorted low bits (16 bits each) or its bitmap words.
+ *
+ * Selections are implicitly shared: copies, by value arguments and signal
+ * arguments only share the blocks, which are copied the first time a
+ * shared selection is modified. Iterators of a selection are not valid
+ * after it is modified.
+ */
+class FaceSelection
+{
+private:
+
+    /**
+     * @brief Faces of one block.
+     */
+    struct Container
+    {
+        unsigned int cardinality;                 /**< Number of faces. */
+        std::vector<unsigned short> array;        /**< Sorted low bits, when the block is not a bitmap. */
+        std::vector<unsigned long long> bitmap;   /**< BITMAP_WORDS words, empty for arrays. */
+
+        Container() : cardinality(0) { }
+        bool isBitmap() const { return !bitmap.empty(); }
+    };
+
+    typedef std::map<unsigned short, Container> ContainerMap;
+
+    /**
+     * @brief Blocks shared by copies of a selection.
+     */
+    struct Data : public QSharedData
+    {
+        ContainerMap containers;    /**< Non empty blocks by high bits. */
+        unsigned int size;          /**< Number of faces. */
+
+        Data() : size(0) { }
+    };
+
+    QSharedDataPointer<Data> d;     /**< Shared blocks, copied on write. */
+
+    /**
+     * @brief Turn an array container in a bitmap.
+     * @param container Container to convert.
+     */
+    static void toBitmap(Container &container);
+
+    /**
+     * @brief Turn a bitmap container in an array if it has ARRAY_MAX faces or less.
+     * @param container Container to convert.
+     */
+    static void shrink(Container &container);
+
+    /**
+     * @brief Recount the faces of a bitmap container.
+     * @param container Container to count.
+     */
+    static void count(Container &container);
+
+    /**
+     * @brief Add the faces of a container to another one of the same block.
+     * @param target Container to modify.
+     * @param source Faces to add.
+     */
+    static void uniteContainer(Container &target, const Container &source);
+
+    /**
+     * @brief Keep the faces of a container also in another one of the same block.
+     * @param target Container to modify.
+     * @param source Faces to keep.
+     */
+    static void intersectContainer(Container &target, const Container &source);
+
+    /**
+     * @brief Remove the faces of a container from another one of the same block.
+     * @param target Container to modify.
+     * @param source Faces to remove.
+     */
+    static void subtractContainer(Container &target, const Container &source);
+
+    /**
+     * @brief Keep the faces in only one of two containers of the same block.
+     * @param target Container to modify.
+     * @param source Faces to toggle.
+     */
+    static void toggleContainer(Container &target, const Container &source);
+
+public:
+
+    static const unsigned int ARRAY_MAX = 4096;       /**< Faces of an array container, bitmap above. */
+    static const unsigned int BITMAP_WORDS = 1024;    /**< 64 bit words of a bitmap container. */
+
+    /**
+     * @brief Forward iterator over the faces, in increasing order.
+     */
+    class const_iterator
+    {
+    private:
+
+        ContainerMap::const_iterator _container;  /**< Current block. */
+        ContainerMap::const_iterator _end;        /**< Block after the last one. */
+        unsigned int _position;                   /**< Array index or bit index in the block. */
+
+        /**
+         * @brief Move to the first face at or after the current position.
+         */
+        void settle();
+
+        friend class FaceSelection;
+
+    public:
+
+        const_iterator() : _position(0) { }
+        unsigned int operator*() const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        bool operator==(const const_iterator &other) const;
+        bool operator!=(const const_iterator &other) const;
+    };
+
+    /**
+     * @brief Default constructor. Empty selection.
+     */
+    FaceSelection();
+
+    /**
+     * @brief Return number of faces.
+     * @return Number of faces.
+     */
+    unsigned int size() const;
+
+    /**
+     * @brief Get if the selection is empty.
+     * @return True if there are no faces, false otherwise.
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief Remove all faces.
+     */
+    void clear();
+
+    /**
+     * @brief Get if a face is selected.
+     * @param face Face index.
+     * @return True if selected, false otherwise.
+     */
+    bool contains(unsigned int face) const;
+
+    /**
+     * @brief Add a face.
+     * @param face Face index.
+     * @return True if the face was not selected, false otherwise.
+     */
+    bool insert(unsigned int face);
+
+    /**
+     * @brief Remove a face.
+     * @param face Face index.
+     * @return True if the face was selected, false otherwise.
+     */
+    bool remove(unsigned int face);
+
+    /**
+     * @brief Add a list of faces. Faster with sorted lists.
+     * @param faces Face indices.
+     */
+    void insert(const std::vector<unsigned int> &faces);
+
+    /**
+     * @brief Remove a list of faces. Faster with sorted lists.
+     * @param faces Face indices.
+     */
+    void remove(const std::vector<unsigned int> &faces);
+
+    /**
+     * @brief Add the faces of another selection.
+     * @param other Selection to add.
+     * @return This selection.
+     */
+    FaceSelection& unite(const FaceSelection &other);
+
+    /**
+     * @brief Keep only the faces also in another selection.
+     * @param other Selection to intersect with.
+     * @return This selection.
+     */
+    FaceSelection& intersect(const FaceSelection &other);
+
+    /**
+     * @brief Remove the faces of another selection.
+     * @param other Selection to remove.
+     * @return This selection.
+     */
+    FaceSelection& subtract(const FaceSelection &other);
+
+    /**
+     * @brief Keep the faces in only one of both selections.
+     * @param other Selection to toggle.
+     * @return This selection.
+     */
+    FaceSelection& symmetricDifference(const FaceSelection &other);
+
+    /**
+     * @brief Copy the faces, in increasing order, to a list.
+     * @param faces Result list, replaced.
+     */
+    void toVector(std::vector<unsigned int> *faces) const;
+
+    /**
+     * @brief Return the size of the serialized selection.
+     * @return Size in bytes.
+     */
+    unsigned int serializedSize() const;
+
+    /**
+     * @brief Write the blocks of the selection.
+     * @param data Buffer of serializedSize() bytes, no alignment needed.
+     */
+    void serialize(char *data) const;
+
+    /**
+     * @brief Read the blocks of a serialized selection. Malformed data is rejected.
+     * @param data Serialized selection, no alignment needed.
+     * @param size Size of the data in bytes.
+     * @return True if read, false otherwise (the selection is left empty).
+     */
+    bool deserialize(const char *data, unsigned int size);
+
+    /**
+     * @brief Return the memory used by the faces.
+     * @return Size in bytes.
+     */
+    unsigned int memoryUsage() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    bool operator==(const FaceSelection &other) const;
+    bool operator!=(const FaceSelection &other) const;
+
+};
+
+#endif // FACESELECTION_H
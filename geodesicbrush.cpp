@@ -0,0 +1,94 @@
+#include "geodesicbrush.h"
+
+#include <cmath>
+
+GeodesicBrush::GeodesicBrush()
+{
+    _adjacency = 0;
+    _radius = 0.0;
+}
+
+void GeodesicBrush::clear()
+{
+    _adjacency = 0;
+    std::vector<float>().swap(_distance);
+    std::vector<unsigned char>().swap(_reached);
+    std::vector<unsigned int>().swap(_touched);
+}
+
+bool GeodesicBrush::isActive() const
+{
+    return _adjacency != 0;
+}
+
+void GeodesicBrush::begin(const FaceAdjacency *adjacency, float radius)
+{
+    _radius = radius;
+
+    // Arrays are kept between strokes of the same model, only touched faces are reset.
+    if ( adjacency != _adjacency || _distance.size() != adjacency->numFaces() )
+    {
+        clear();
+        _adjacency = adjacency;
+        _distance.assign(adjacency->numFaces(), HUGE_VAL);
+        _reached.assign(adjacency->numFaces(), 0);
+        return;
+    }
+
+    for ( unsigned int i = 0; i < _touched.size(); ++i )
+    {
+        _distance[_touched[i]] = HUGE_VAL;
+        _reached[_touched[i]] = 0;
+    }
+    _touched.clear();
+}
+
+void GeodesicBrush::add(unsigned int seed, std::vector<unsigned int> *faces)
+{
+    if ( !_adjacency || seed >= _distance.size() || _distance[seed] == 0.0f )
+        return;
+
+    if ( _distance[seed] == (float)HUGE_VAL )
+        _touched.push_back(seed);
+    _distance[seed] = 0.0;
+
+    Front front;
+    front.distance = 0.0;
+    front.face = seed;
+    _front.push(front);
+
+    // Faces not brought closer by this sample keep their distance and are not visited.
+    while ( !_front.empty() )
+    {
+        Front top = _front.top();
+        _front.pop();
+        if ( top.distance > _distance[top.face] )
+            continue;
+
+        if ( !_reached[top.face] )
+        {
+            _reached[top.face] = 1;
+            faces->push_back(top.face);
+        }
+
+        const float *center = _adjacency->getCenter(top.face);
+        for ( unsigned int i = _adjacency->first(top.face); i < _adjacency->last(top.face); ++i )
+        {
+            unsigned int neighbor = _adjacency->getNeighbor(i);
+            const float *next = _adjacency->getCenter(neighbor);
+            float dx = next[0] - center[0], dy = next[1] - center[1], dz = next[2] - center[2];
+            float distance = top.distance + sqrt(dx*dx + dy*dy + dz*dz);
+
+            if ( distance > _radius || distance >= _distance[neighbor] )
+                continue;
+
+            if ( _distance[neighbor] == (float)HUGE_VAL )
+                _touched.push_back(neighbor);
+            _distance[neighbor] = distance;
+
+            front.distance = distance;
+            front.face = neighbor;
+            _front.push(front);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef GEODESICBRUSH_H
+#define GEODESICBRUSH_H
+
+#include <queue>
+#include <vector>
+#include "faceadjacency.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The GeodesicBrush class finds the faces within a distance of the brush
+ * face measured along the surface, so the brush does not jump to close
+ * but disconnected parts of the model. Distances run between adjacent
+ * face centroids with a bounded Dijkstra search. The distances of a
+ * stroke are kept: each brush sample adds a source, and only the faces
+ * it brings closer are visited again, which is exact because the radius
+ * is the same for the whole stroke. Only the faces touched by a stroke
+ * are reset when the next one starts.
+ */
+class GeodesicBrush
+{
+private:
+
+    /**
+     * @brief A face of the front and its distance.
+     */
+    struct Front
+    {
+        float distance;
+        unsigned int face;
+
+        bool operator<(const Front &other) const
+        {
+            return distance > other.distance;     // Nearest face on top.
+        }
+    };
+
+    const FaceAdjacency *_adjacency;      /**< Adjacency of the model. */
+    float _radius;                        /**< Surface distance from the samples (model units). */
+    std::vector<float> _distance;         /**< Distance to the nearest sample of the stroke. */
+    std::vector<unsigned char> _reached;  /**< 1 for faces already returned in the stroke. */
+    std::vector<unsigned int> _touched;   /**< Faces with a finite distance. */
+    std::priority_queue<Front> _front;    /**< Faces to visit, empty between samples. */
+
+public:
+
+    /**
+     * @brief Default constructor.
+     */
+    GeodesicBrush();
+
+    /**
+     * @brief Start a new stroke.
+     * @param adjacency Adjacency of the model. Must outlive the stroke.
+     * @param radius Surface distance from the samples (model units).
+     */
+    void begin(const FaceAdjacency *adjacency, float radius);
+
+    /**
+     * @brief Get if a stroke was started.
+     * @return True if samples can be added, false otherwise.
+     */
+    bool isActive() const;
+
+    /**
+     * @brief Release the memory of the brush.
+     */
+    void clear();
+
+    /**
+     * @brief Add a brush sample to the stroke.
+     * @param seed Face under the brush.
+     * @param faces Faces reached for the first time in the stroke are appended to this list.
+     */
+    void add(unsigned int seed, std::vector<unsigned int> *faces);
+
+};
+
+#endif // GEODESICBRUSH_H
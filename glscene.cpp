@@ -0,0 +1,111 @@
+#include "glscene.h"
+
+void GLScene::initialize()
+{
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);    // Define clear color
+    glClearDepth(1.0f);
+    glEnable(GL_DEPTH_TEST);
+
+    // Enable lights
+    glEnable(GL_LIGHTING);
+
+
+    // Create light components
+    float ambientLight[] = { 0.08f, 0.08f, 0.08f, 1.0f };
+    float diffuseLight[] = { 0.4f, 0.4f, 0.4, 1.0f };
+    float specularLight[] = { 0.5f, 0.5f, 0.5f, 1.0f };
+    float position[] = { 0.0f, 0.0f, -100.0f,  1.0f };
+    float position2[] = { 0.0f, -100.0f, 0.0f, 1.0f };
+    float position3[] = { -100.0f, 0.0f, 0.0f, 1.0f };
+
+    glLightfv(GL_LIGHT1, GL_AMBIENT, ambientLight);
+    glLightfv(GL_LIGHT1, GL_DIFFUSE, diffuseLight);
+    glLightfv(GL_LIGHT1, GL_SPECULAR, specularLight);
+    glLightfv(GL_LIGHT1, GL_POSITION, position);
+
+    glLightfv(GL_LIGHT2, GL_AMBIENT, ambientLight);
+    glLightfv(GL_LIGHT2, GL_DIFFUSE, diffuseLight);
+    glLightfv(GL_LIGHT2, GL_SPECULAR, specularLight);
+    glLightfv(GL_LIGHT2, GL_POSITION, position2);
+
+    glLightfv(GL_LIGHT3, GL_AMBIENT, ambientLight);
+    glLightfv(GL_LIGHT3, GL_DIFFUSE, diffuseLight);
+    glLightfv(GL_LIGHT3, GL_SPECULAR, specularLight);
+    glLightfv(GL_LIGHT3, GL_POSITION, position3);
+
+    glEnable(GL_LIGHT1);
+    glEnable(GL_LIGHT2);
+    glEnable(GL_LIGHT3);
+
+    // Material
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+}
+
+void GLScene::loadCamera(const Camera &camera)
+{
+    GLint viewport[4];
+    camera.getViewport(viewport);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    GLfloat projMatrix[16];
+    camera.getProjectionMatrix(projMatrix);
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(projMatrix);
+    glMatrixMode(GL_MODELVIEW);
+
+    loadModelView(camera);
+}
+
+void GLScene::loadModelView(const Camera &camera)
+{
+    GLfloat modelViewMatrix[16];
+    camera.getModelViewMatrix(modelViewMatrix);
+    glLoadMatrixf(modelViewMatrix);
+}
+
+void GLScene::setRenderMode(RenderMode mode)
+{
+    switch (mode) {
+        case POINTS:
+            glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
+            break;
+        case WIRED:
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            break;
+        default:
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            break;
+    }
+}
+
+void GLScene::drawPoly(Model *model, Poly *poly, bool wired)
+{
+    int mode = GL_LINE_LOOP;           // Use to select draw mode (TRIANGLES, QUADS & POLYGONS)
+
+    if ( !wired )
+    {
+        switch (poly->size()) {
+            case 3:
+                mode = GL_TRIANGLES;
+                break;
+            case 4:
+                mode = GL_QUADS;
+                break;
+            default:
+                mode = GL_POLYGON;
+                break;
+        }
+    }
+
+    std::vector<unsigned int>* list = poly->getList();
+    std::vector<unsigned int>::const_iterator it = list->begin(), end = list->end();
+    glBegin(mode);
+    for ( ; it != end; ++it )
+    {
+        Vertex *vertex = model->getVertexAt(*it);
+        glNormal3f(vertex->getNormalX(), vertex->getNormalY(), vertex->getNormalZ());
+        glVertex3f(vertex->getX(), vertex->getY(), vertex->getZ());
+    }
+    glEnd();
+}
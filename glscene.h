@@ -0,0 +1,82 @@
+#ifndef GLSCENE_H
+#define GLSCENE_H
+
+#include <QGLWidget>
+#include "model.h"
+#include "camera.h"
+
+/**
+ * @brief The RenderMode enum represents a diferents mode to render the scene:
+ * SOLID: Solid mode. (default)
+ * WIRE: Wire mode.
+ * SOLID_WIRE: Solid + wire mode.
+ */
+enum RenderMode {
+    POINTS,
+    WIRED,
+    SOLID,
+    SOLID_WIRE
+};
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The GLScene class groups the OpenGL state and drawing shared by the
+ * viewer and the offscreen renderer: lights, materials, camera matrices
+ * and polygon drawing. All functions act on the current GL context.
+ */
+class GLScene
+{
+public:
+
+    /**
+     * @brief Configure clear color, depth test, lights and material.
+     * Must be called with an identity modelview matrix.
+     */
+    static void initialize();
+
+    /**
+     * @brief Load viewport, projection and modelview matrices of a camera.
+     * @param camera Camera to load.
+     */
+    static void loadCamera(const Camera &camera);
+
+    /**
+     * @brief Load the modelview matrix of a camera.
+     * @param camera Camera to load.
+     */
+    static void loadModelView(const Camera &camera);
+
+    /**
+     * @brief Set how polygons are rasterized for a render mode.
+     * @param mode Render mode.
+     */
+    static void setRenderMode(RenderMode mode);
+
+    /**
+     * @brief Draw a polygon solid or wired.
+     * @param model Model owning the polygon.
+     * @param poly Polygon to draw.
+     * @param wired True for wired mode, false for solid mode.
+     */
+    static void drawPoly(Model *model, Poly *poly, bool wired);
+
+};
+
+#endif // GLSCENE_H
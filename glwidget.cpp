@@ -1,164 +1,231 @@
 #include "glwidget.h"
 
+#include <algorithm>
+
 GLWidget::GLWidget(QWidget *parent) :
     QGLWidget(QGLFormat(QGL::SampleBuffers), parent)
 {
-    _model = new Model();
+    _previewSize = 0.0;
+    _showStats = false;
+    _showAllBookmarks = false;
+    _visibleOnly = false;
+    _selectionTool = BRUSH_TOOL;
+    _regionCriterion = DIHEDRAL_ANGLE;
+    _regionThreshold = 15.0 * M_PI / 180.0;
+    _regionCount = 0;
+    _lassoClosed = false;
+    _geodesicNewStroke = false;
+    _showOutline = false;
+    _showAllOutlines = false;
+    _hoverMode = false;
+    _hoverPending = false;
+    _redrawPending = false;
+    _hoverFace = -1;
+
+    _frameTimer.setSingleShot(true);
+    connect(&_frameTimer, SIGNAL(timeout()), this, SLOT(processFrame()));
+    _frameClock.start();
+
+    _stillTimer.setSingleShot(true);
+    _stillTimer.setInterval(LOD_RESTORE_DELAY);
+    connect(&_stillTimer, SIGNAL(timeout()), this, SLOT(cameraStill()));
+
+    // The GL context belongs to the render thread from now on.
+    setAutoBufferSwap(false);
+    doneCurrent();
+    _renderThread = new RenderThread(this);
+#if QT_VERSION >= 0x050000
+    context()->moveToThread(_renderThread);
+#endif
+    connect(_renderThread, SIGNAL(depthReady()), this, SLOT(depthReady()));
+    connect(_renderThread, SIGNAL(sceneCompiled()), this, SLOT(sceneCompiled()));
+
     clear();
+    _renderThread->start();
+}
+
+GLWidget::~GLWidget()
+{
+    _renderThread->stop();
+    _renderThread->wait();
 }
 
-void GLWidget::setModel(Model* model)
+void GLWidget::setModel(Model* model, MeshClusters *clusters, RayPicker *rayPicker, LodMesh *lod,
+                        MeshEdges *edges, FaceAdjacency *adjacency)
 {
+    // Keep the loading preview, and the camera set on it, until display lists are ready.
+    QVector<float> preview = _previewPoints;
+    Camera camera = _camera;
     clear();
-    _model = model;
-    createDisplayLists();
+    _previewPoints = preview;
+
+    QSharedPointer<RenderScene> scene(new RenderScene());
+    scene->model = QSharedPointer<Model>(model);
+
+    if ( clusters )
+        scene->clusters.swap(*clusters);
+    else
+    {
+        ScopedProbe probe(Profiler::LOAD_CLUSTERS);
+        scene->clusters.build(model);
+    }
+
+    if ( rayPicker )
+        _rayPicker.swap(*rayPicker);
+    else
+    {
+        ScopedProbe probe(Profiler::LOAD_PICKER);
+        _rayPicker.build(model);
+    }
+
+    if ( lod )
+        scene->lod.swap(*lod);
+    else
+    {
+        ScopedProbe probe(Profiler::LOAD_LOD);
+        scene->lod.build(model);
+    }
+
+    if ( edges )
+        scene->edges.swap(*edges);
+    else
+    {
+        ScopedProbe probe(Profiler::LOAD_EDGES);
+        scene->edges.build(model, scene->clusters);
+    }
+
+    if ( adjacency )
+        _adjacency.swap(*adjacency);
+    else
+    {
+        ScopedProbe probe(Profiler::LOAD_ADJACENCY);
+        _adjacency.build(model, scene->edges);
+    }
+
+    _scene = scene;
 
     // Set distance's camera and increment step.
-    float size = _model->getSize();
-    _cameraDistance = size;
+    float size = model->getSize();
+    if ( _previewPoints.isEmpty() )
+        _camera.setDistance(size);
+    else
+        _camera = camera;
     _cameraIncrement = size / 10.0;
-    setCamera();
 
-    updateGL();
+    publishState();
+}
+
+Model* GLWidget::getModel()
+{
+    return _scene->model.data();
+}
+
+void GLWidget::setPreview(QVector<float> points, float size)
+{
+    // Follow the growing bounds until the user zooms.
+    if ( _previewPoints.isEmpty() || _camera.getDistance() == _previewSize )
+    {
+        _camera.setDistance(size);
+        _cameraIncrement = size / 10.0;
+    }
+
+    _previewPoints = points;
+    _previewSize = size;
+    publishState();
 }
 
 void GLWidget::clear()
 {
     _currentSelection.clear();
-
-    _cameraDistance = 1.0;
-    _cameraHAngle   = 0.0;
-    _cameraVAngle   = 0.0;
+    _currentOutline.clear();
+    _outlineValid = true;
+    _bookmarkOutlines.clear();
+    resetHistory();
+
+    _camera.setDistance(1.0);
+    _camera.setHAngle(0.0);
+    _camera.setVAngle(0.0);
     _cameraIncrement = 1.0;
 
+    _pendingHAngle = 0.0;
+    _pendingVAngle = 0.0;
+    _pendingDistance = 0.0;
+    _brushSamples.clear();
+    _lasso.clear();
+    _lassoClosed = false;
+    _frameTimer.stop();
+
     _pickSize = 10;
+    _brushShape = SQUARE_BRUSH;
 
     _mode = ROTATION;
     _selectionMode = ADD;
     _renderMode = SOLID;
     _isPicking = false;
     _hitMode = false;
-
-    glDeleteLists(_modelDisplayListIndex, 1);
-    _modelDisplayListIndex = 0;
-
-    updateGL();
+    _hoverFace = -1;
+
+    // The render thread releases the previous scene when it draws this one.
+    _scene = QSharedPointer<RenderScene>(new RenderScene());
+    _scene->model = QSharedPointer<Model>(new Model());
+    _previewPoints.clear();
+    _cameraMoving = false;
+    _stillTimer.stop();
+    _visibleClusters.clear();
+    _rayPicker.clear();
+    _adjacency.clear();
+    _geodesic.clear();
+    _faceGrid.clear();
+
+    publishState();
 }
 
-void GLWidget::drawPoly(Poly *poly, bool wired = false)
+void GLWidget::updateGL()
 {
-    int mode = GL_LINE_LOOP;           // Use to select draw mode (TRIANGLES, QUADS & POLYGONS)
-
-    if ( !wired )
-    {
-        switch (poly->size()) {
-            case 3:
-                mode = GL_TRIANGLES;
-                break;
-            case 4:
-                mode = GL_QUADS;
-                break;
-            default:
-                mode = GL_POLYGON;
-                break;
-        }
-    }
-
-    std::vector<unsigned int>* list = poly->getList();
-    std::vector<unsigned int>::const_iterator it = list->begin(), end = list->end();
-    glBegin(mode);
-    for ( ; it != end; ++it )
-    {
-        Vertex *vertex = _model->getVertexAt(*it);
-        glNormal3f(vertex->getNormalX(), vertex->getNormalY(), vertex->getNormalZ());
-        glVertex3f(vertex->getX(), vertex->getY(), vertex->getZ());
-    }
-    glEnd();
+    publishState();
 }
 
-void GLWidget::initializeGL()
+void GLWidget::glDraw()
 {
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);    // Define clear color
-    glClearDepth(1.0f);
-    glEnable(GL_DEPTH_TEST);
-
-    // Enable lights
-    glEnable(GL_LIGHTING);
-
-
-    // Create light components
-    float ambientLight[] = { 0.08f, 0.08f, 0.08f, 1.0f };
-    float diffuseLight[] = { 0.4f, 0.4f, 0.4, 1.0f };
-    float specularLight[] = { 0.5f, 0.5f, 0.5f, 1.0f };
-    float position[] = { 0.0f, 0.0f, -100.0f,  1.0f };
-    float position2[] = { 0.0f, -100.0f, 0.0f, 1.0f };
-    float position3[] = { -100.0f, 0.0f, 0.0f, 1.0f };
-
-    glLightfv(GL_LIGHT1, GL_AMBIENT, ambientLight);
-    glLightfv(GL_LIGHT1, GL_DIFFUSE, diffuseLight);
-    glLightfv(GL_LIGHT1, GL_SPECULAR, specularLight);
-    glLightfv(GL_LIGHT1, GL_POSITION, position);
-
-    glLightfv(GL_LIGHT2, GL_AMBIENT, ambientLight);
-    glLightfv(GL_LIGHT2, GL_DIFFUSE, diffuseLight);
-    glLightfv(GL_LIGHT2, GL_SPECULAR, specularLight);
-    glLightfv(GL_LIGHT2, GL_POSITION, position2);
-
-    glLightfv(GL_LIGHT3, GL_AMBIENT, ambientLight);
-    glLightfv(GL_LIGHT3, GL_DIFFUSE, diffuseLight);
-    glLightfv(GL_LIGHT3, GL_SPECULAR, specularLight);
-    glLightfv(GL_LIGHT3, GL_POSITION, position3);
-
-    glEnable(GL_LIGHT1);
-    glEnable(GL_LIGHT2);
-    glEnable(GL_LIGHT3);
-
-    // Material
-    glEnable(GL_COLOR_MATERIAL);
-    glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+    publishState();
 }
 
-void GLWidget::paintGL()
+void GLWidget::paintEvent(QPaintEvent *)
 {
-    // Clear buffers.
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    if ( _model->isLoaded() )
-    {
-        // Draw current selection.
-        if ( !_hitMode )
-        {
-            glColor3f(0.5, 1.0, 0.5);
-
-            std::set<unsigned int>::const_iterator it = _currentSelection.begin();
-            for (;it != _currentSelection.end(); ++it)
-                drawPoly( _model->getPolyAt(*it), false );
-        }
-
-        // Draw complete model.
-        if (_renderMode == SOLID_WIRE)
-            glCallList(_modelDisplayListIndex+1);
-        else
-            glCallList(_modelDisplayListIndex);
-    }
+    publishState();
 }
 
-void GLWidget::resizeGL(int width, int height)
+void GLWidget::resizeEvent(QResizeEvent *event)
 {
-    float max, position = 0.0;
-    if (width > height)
-    {
-        max = width;
-        position = (max - height)/2;
-    }
-    else
-        max = height;
+    _camera.setViewportSize(event->size().width(), event->size().height());
+    _faceGrid.clear();
+    publishState();
+}
 
-    glViewport(0, -position, max, max);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(60.0, 1.0, 0.01, 10000.0);
-    glMatrixMode(GL_MODELVIEW);
+void GLWidget::publishState()
+{
+    RenderState *state = new RenderState();
+    state->scene = _scene;
+    state->camera = _camera;
+    state->renderMode = _renderMode;
+    state->cameraMoving = _cameraMoving;
+    state->showSelection = !_hitMode;
+    state->selection = _currentSelection;     // Shared, copied when the viewer changes it.
+    state->preview = _previewPoints;
+    state->showStats = _showStats;
+    state->showAllBookmarks = _showAllBookmarks;
+    state->labels = _bookmarkLabels;
+    state->lasso = _lasso;
+    state->showOutline = _showOutline;
+    state->outline = _currentOutline;
+    state->showAllOutlines = _showAllOutlines;
+    state->outlines = _bookmarkOutlines;
+
+    // Depth is needed to pick. Skip it while rotating, unless a stroke waits for it.
+    state->captureDepth = _isPicking && (!_cameraMoving || !_brushSamples.isEmpty() || _lassoClosed);
+    state->captureIds = _isPicking && _visibleOnly;
+
+    _renderThread->publish(state);
 }
 
 void GLWidget::mousePressEvent(QMouseEvent *pressEvent)
@@ -177,142 +244,399 @@ void GLWidget::mousePressEvent(QMouseEvent *pressEvent)
 
     if ( _hitMode )
     {
-        unsigned int backupPickSize = _pickSize;
-        _pickSize = 1;
+        applyCameraChanges();
+
+        // Front-most face under the cursor, computed on the CPU.
+        ScopedProbe probe(Profiler::PICK_LATENCY);
         _currentSelection.clear();
-        picking(pressEvent->pos().x(), pressEvent->pos().y());
-        _pickSize = backupPickSize;
+        _outlineValid = false;
+        int face = _rayPicker.pick(_camera, pressEvent->pos().x(), pressEvent->pos().y());
+        if ( face >= 0 )
+            _currentSelection.insert(face);
         emit pickResult(_currentSelection);
     }
+    else if ( _mode == PICK && _selectionTool == REGION_TOOL )
+    {
+        applyCameraChanges();
+
+        // The clicked face seeds a new region, the previous one is kept.
+        finishRegion();
+        int face = _rayPicker.pick(_camera, pressEvent->pos().x(), pressEvent->pos().y());
+        if ( face >= 0 )
+            startRegion(face);
+    }
+    else if ( _mode == PICK && _selectionTool == GEODESIC_TOOL )
+    {
+        // The stroke radius is set by its first sample, a click already selects.
+        _geodesicNewStroke = true;
+        _brushSamples.append(pressEvent->pos());
+        scheduleFrame();
+    }
+    else if ( _mode == PICK && _selectionTool == LASSO_TOOL && !_lassoClosed )
+    {
+        _lasso.clear();
+        _lasso.append(pressEvent->pos());
+        publishState();
+    }
+    else if ( _mode == PICK && _selectionTool == POLYGON_TOOL && !_lassoClosed )
+    {
+        // Each click adds a corner, double click closes the polygon.
+        _lasso.append(pressEvent->pos());
+        publishState();
+    }
+}
+
+void GLWidget::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    if ( _isPicking && _selectionTool == POLYGON_TOOL && event->button() == Qt::LeftButton && !_lassoClosed )
+    {
+        if ( _lasso.isEmpty() || _lasso.last() != event->pos() )
+            _lasso.append(event->pos());
+        closeLasso();
+    }
+    else
+        mousePressEvent(event);
+}
+
+void GLWidget::mouseReleaseEvent(QMouseEvent *)
+{
+    if ( _mode == PICK && _selectionTool == LASSO_TOOL && !_lassoClosed )
+        closeLasso();
 
+    if ( _mode != PICK || (_selectionTool != BRUSH_TOOL && _selectionTool != GEODESIC_TOOL) )
+        return;
 
+    // The stroke ends once its last samples are applied.
+    _strokeEnded = true;
+    if ( _brushSamples.isEmpty() )
+        commitStroke();
+}
+
+void GLWidget::commitStroke()
+{
+    _strokeEnded = false;
+    _history.commit();
+    emit historyChanged(_history.canUndo(), _history.canRedo());
 }
 
 void GLWidget::mouseMoveEvent(QMouseEvent *moveEvent)
 {
+    // Moves without buttons only come in hover mode.
+    if ( moveEvent->buttons() == Qt::NoButton )
+    {
+        _hoverPos = moveEvent->pos();
+        _hoverPending = true;
+        scheduleFrame(false);
+        return;
+    }
+
+    // Only accumulate changes here, work is done once per frame.
     switch (_mode) {
         case ROTATION:
-            _cameraVAngle += moveEvent->pos().x() - _lastPos.x();
-            _cameraHAngle += moveEvent->pos().y() - _lastPos.y();
-            setCamera();
+            _pendingVAngle += moveEvent->pos().x() - _lastPos.x();
+            _pendingHAngle += moveEvent->pos().y() - _lastPos.y();
             break;
         case PICK:
-            picking(moveEvent->pos().x(), moveEvent->pos().y());
+            if ( _selectionTool == BRUSH_TOOL || _selectionTool == GEODESIC_TOOL )
+                addBrushSamples(moveEvent->pos());
+            else if ( _selectionTool == LASSO_TOOL && !_lassoClosed && !_lasso.isEmpty() &&
+                      (moveEvent->pos() - _lasso.last()).manhattanLength() >= LASSO_STEP )
+                _lasso.append(moveEvent->pos());
             break;
         default:
             break;
     }
 
     _lastPos = moveEvent->pos();
-    updateGL();
+    scheduleFrame();
 }
 
 void GLWidget::wheelEvent(QWheelEvent *event)
 {
     if ( event->orientation() == Qt::Vertical )
     {
-        _cameraDistance += (double)(event->delta()) * _cameraIncrement / 100;
-        setCamera();
-        updateGL();
+        _pendingDistance += (double)(event->delta()) * _cameraIncrement / 100;
+        scheduleFrame();
     }
 }
 
-void GLWidget::createDisplayLists()
+void GLWidget::addBrushSamples(QPoint position)
+{
+    // Step of half the brush so a fast stroke does not skip faces.
+    QPoint delta = position - _lastPos;
+    float length = sqrt((float)(delta.x()*delta.x() + delta.y()*delta.y()));
+    float step = qMax(1.0f, _pickSize / 2.0f);
+    int steps = qMax(1, (int)ceil(length / step));
+
+    if ( _brushSamples.isEmpty() )
+        _brushSamples.append(_lastPos);
+
+    for ( int i = 1; i <= steps; ++i )
+        _brushSamples.append(_lastPos + delta * ((float)i / steps));
+}
+
+bool GLWidget::applyCameraChanges()
+{
+    if ( _pendingHAngle == 0.0 && _pendingVAngle == 0.0 && _pendingDistance == 0.0 )
+        return false;
+
+    _camera.setHAngle(_camera.getHAngle() + _pendingHAngle);
+    _camera.setVAngle(_camera.getVAngle() + _pendingVAngle);
+    _camera.setDistance(_camera.getDistance() + _pendingDistance);
+    _pendingHAngle = _pendingVAngle = _pendingDistance = 0.0;
+
+    return true;
+}
+
+void GLWidget::scheduleFrame(bool redraw)
 {
-    _modelDisplayListIndex = glGenLists(2);
+    _redrawPending = _redrawPending || redraw;
+    if ( _frameTimer.isActive() )
+        return;
+
+    int wait = FRAME_INTERVAL - _frameClock.elapsed();
+    _frameTimer.start(qMax(0, wait));
+}
+
+void GLWidget::processFrame()
+{
+    // Hover-only frames just pick, the model is drawn again only if it changed.
+    bool redraw = _redrawPending;
+    _redrawPending = false;
+
+    // Draw a reduced model while the camera moves.
+    if ( applyCameraChanges() )
+    {
+        redraw = true;
+        _cameraMoving = true;
+        _stillTimer.start();
+    }
 
-    // Solid
-    glNewList(_modelDisplayListIndex, GL_COMPILE);
-        glColor3f(0.44, 0.6, 0.95);   // Set model color.
-        for ( unsigned int i = 0; i < _model->numPoly(); ++i )
+    // Samples wait for the depth of this camera if it is not captured yet.
+    if ( !_brushSamples.isEmpty() && picking(_brushSamples) )
+    {
+        redraw = true;
+        _brushSamples.clear();
+        if ( _strokeEnded )
+            commitStroke();
+    }
+
+    // A closed lasso also waits for the depth of this camera.
+    if ( _lassoClosed && pickingLasso() )
+    {
+        redraw = true;
+        _lasso.clear();
+        _lassoClosed = false;
+        commitStroke();
+    }
+
+    // Face under the mouse, with the camera of this frame.
+    if ( _hoverPending && _hoverMode )
+    {
+        _hoverPending = false;
+        int face = _rayPicker.pick(_camera, _hoverPos.x(), _hoverPos.y());
+        if ( face != _hoverFace )
         {
-            glLoadName(i);
-            drawPoly( _model->getPolyAt(i), false );
+            _hoverFace = face;
+            emit faceHovered(face, _hoverPos);
         }
-    glEndList();
+    }
 
-    // Solid + wire
-    glNewList(_modelDisplayListIndex+1, GL_COMPILE);
-        glCallList(_modelDisplayListIndex);
-        glColor3f(1.0, 1.0, 1.0);   // Set wire color.
-        for ( unsigned int i = 0; i < _model->numPoly(); ++i )
-            drawPoly( _model->getPolyAt(i), true );
-    glEndList();
+    _frameClock.restart();
+    if ( redraw )
+        publishState();
 }
 
-void GLWidget::setCamera()
+void GLWidget::cameraStill()
 {
-    glLoadIdentity();
-    gluLookAt(0, 1, _cameraDistance, 0, 0, 0, 0, 1, 0);
-    glRotatef(_cameraHAngle, 1.0, 0.0, 0.0);
-    glRotatef(_cameraVAngle, 0.0, 1.0, 0.0);
+    _cameraMoving = false;
+    publishState();
 }
 
-void GLWidget::picking(int x, int y)
+void GLWidget::depthReady()
 {
-    glEnable(GL_CULL_FACE);     // Enable culling to improve pick.
+    DepthFrame *frame = _renderThread->takeDepthFrame();
+    if ( !frame )
+        return;
 
-    GLuint nameBuffer[10000];     // Buffer names
-    GLint hits;                 // Hits
-    GLint viewport[4];          // Viewport
-    GLfloat projMatrix[16];     // Projection matrix
-
-    glSelectBuffer( 10000, nameBuffer );  // select a buffer for the hit results.
-    glRenderMode(GL_SELECT);          // must change to select mode _before_ you touch the name stack.
+    // A capture of an older camera or brush setting is of no use.
+    if ( frame->camera == _camera && frame->captureIds == _visibleOnly && _scene->model->isLoaded() )
+    {
+        ScopedProbe probe(Profiler::FACE_GRID);
+        _scene->clusters.cull(_camera, true, &_visibleClusters);
+        _faceGrid.build(_scene->model.data(), _camera, &_scene->clusters, &_visibleClusters);
+        _faceGrid.setDepthBuffer(frame->depth);
+        _faceGrid.setIdBuffer(frame->ids);
+
+        if ( !_brushSamples.isEmpty() || _lassoClosed )
+            scheduleFrame();
+    }
 
-    glInitNames();                      // initialise the name stack.
-    glPushName( 0xffffffff );           // put a dummy on the stack so we can call glLoadName without error.
+    delete frame;
+}
 
-    glGetFloatv( GL_PROJECTION_MATRIX, projMatrix );
+void GLWidget::sceneCompiled()
+{
+    _previewPoints.clear();
+    _faceGrid.clear();      // Depth was captured while clusters were missing.
+    publishState();
+}
 
-    glMatrixMode( GL_PROJECTION );
-    glPushMatrix();
-    glLoadIdentity();
+bool GLWidget::picking(const QVector<QPoint> &samples)
+{
+    if ( _selectionTool == GEODESIC_TOOL )
+        return pickingGeodesic(samples);
 
-    glGetIntegerv( GL_VIEWPORT, viewport );
+    // Faces are projected once per camera, so a stroke does not re-render the model.
+    if ( !_faceGrid.isValid(_camera) )
+        return false;
 
-    gluPickMatrix( (GLdouble)x, (GLdouble)( this->size().height() - y  ), _pickSize, _pickSize, viewport );
+    ScopedProbe probe(Profiler::PICK_LATENCY);
 
-    glMultMatrixf( projMatrix );
-    glMatrixMode( GL_MODELVIEW );
+    std::vector<unsigned int> faces;
+    QVector<QPoint>::const_iterator sample = samples.begin();
+    for ( ; sample != samples.end(); ++sample )
+    {
+        if ( _brushShape == CIRCLE_BRUSH )
+            _faceGrid.queryCircle(sample->x(), sample->y(), _pickSize / 2.0, &faces);
+        else
+            _faceGrid.queryRect(sample->x(), sample->y(), _pickSize, _pickSize, &faces);
+    }
 
-    // Set camera
-    setCamera();
+    // Samples overlap, apply each face once.
+    std::sort(faces.begin(), faces.end());
+    faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
 
-    // Clear buffers.
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    applyFaces(faces);
+    return true;
+}
 
-    // Draw model
-    glCallList(_modelDisplayListIndex);
+bool GLWidget::pickingGeodesic(const QVector<QPoint> &samples)
+{
+    if ( _adjacency.numFaces() == 0 )
+        return true;
 
-    glMatrixMode( GL_PROJECTION );
-    glPopMatrix();
-    glMatrixMode( GL_MODELVIEW );
+    ScopedProbe probe(Profiler::PICK_LATENCY);
 
-    hits = glRenderMode(GL_RENDER);
-    if( hits > 0 )
+    // Samples of a stroke share their distances, each face is returned once.
+    std::vector<unsigned int> faces;
+    QVector<QPoint>::const_iterator sample = samples.begin();
+    for ( ; sample != samples.end(); ++sample )
     {
-        GLuint names;
-        GLuint* pPtr = nameBuffer;
+        int face = _rayPicker.pick(_camera, sample->x(), sample->y());
+        if ( face < 0 )
+            continue;
 
-        for( GLint i = 0; i < hits; ++i )
+        if ( _geodesicNewStroke || !_geodesic.isActive() )
         {
-            names = *pPtr;
-            ++pPtr;
-            ++pPtr;
-            ++pPtr;
-
-            for( GLuint j = 0; j < names; ++j, ++pPtr )
-            {
-                if ( _selectionMode == ADD )
-                    _currentSelection.insert(*pPtr);
-                if ( _selectionMode == DEL )
-                    _currentSelection.erase(*pPtr);
-            }
+            _geodesic.begin(&_adjacency, geodesicRadius(face));
+            _geodesicNewStroke = false;
         }
+        _geodesic.add(face, &faces);
     }
 
-    glDisable(GL_CULL_FACE);
+    std::sort(faces.begin(), faces.end());
+    applyFaces(faces);
+    return true;
+}
+
+float GLWidget::geodesicRadius(unsigned int face) const
+{
+    // Size of a pixel at the distance of the face.
+    float eye[3];
+    _camera.getEye(eye);
+    const float *center = _adjacency.getCenter(face);
+    float dx = center[0] - eye[0], dy = center[1] - eye[1], dz = center[2] - eye[2];
+    float distance = sqrt(dx*dx + dy*dy + dz*dz);
+
+    int viewport[4];
+    _camera.getViewport(viewport);
+    float pixel = 2.0 * distance * tan(Camera::FOVY * M_PI / 360.0) / qMax(1, viewport[3]);
+
+    return _pickSize / 2.0f * pixel;
+}
+
+bool GLWidget::pickingLasso()
+{
+    if ( !_faceGrid.isValid(_camera) )
+        return false;
+
+    ScopedProbe probe(Profiler::PICK_LATENCY);
+
+    std::vector<float> points(2 * _lasso.size());
+    for ( int i = 0; i < _lasso.size(); ++i )
+    {
+        points[2*i] = _lasso[i].x() + 0.5f;
+        points[2*i + 1] = _lasso[i].y() + 0.5f;
+    }
+
+    std::vector<unsigned int> faces;
+    _faceGrid.queryPolygon(points, &faces);
+    applyFaces(faces);
+    return true;
+}
+
+void GLWidget::closeLasso()
+{
+    // A lasso needs an area.
+    if ( _lasso.size() < 3 )
+    {
+        _lasso.clear();
+        publishState();
+        return;
+    }
+
+    _lassoClosed = true;
+    scheduleFrame();
+}
+
+void GLWidget::applyFaces(const std::vector<unsigned int> &faces)
+{
+    // Only faces that change are recorded for undo.
+    std::vector<unsigned int> changed;
+    changed.reserve(faces.size());
+    for ( unsigned int i = 0; i < faces.size(); ++i )
+        if ( _currentSelection.contains(faces[i]) == (_selectionMode == DEL) )
+            changed.push_back(faces[i]);
+
+    if ( changed.empty() )
+        return;
+
+    FaceSelection stroke;
+    stroke.insert(changed);
+    if ( _selectionMode == ADD )
+    {
+        _currentSelection.unite(stroke);
+        _history.added(stroke);
+    }
+    if ( _selectionMode == DEL )
+    {
+        _currentSelection.subtract(stroke);
+        _history.removed(stroke);
+    }
+    updateOutline(stroke);
+}
+
+void GLWidget::updateOutline(const FaceSelection &changed)
+{
+    if ( !_showOutline )
+    {
+        _outlineValid = false;
+        return;
+    }
+
+    // Past the selection size a full pass tests fewer edges.
+    if ( _outlineValid && changed.size() < _currentSelection.size() )
+        _scene->edges.updateBoundary(_currentSelection, changed, &_currentOutline);
+    else
+        _scene->edges.boundary(_currentSelection, &_currentOutline);
+    _outlineValid = true;
+}
+
+void GLWidget::updateOutlineFrom(const FaceSelection &before)
+{
+    FaceSelection changed = before;
+    updateOutline(changed.symmetricDifference(_currentSelection));
 }
 
 void GLWidget::setViewerMode(Mode mode)
@@ -322,60 +646,308 @@ void GLWidget::setViewerMode(Mode mode)
     else
         _isPicking = false;
 
-    updateGL();
+    publishState();
 }
 
 void GLWidget::setSelectionMode(SelectionMode mode)
 {
+    finishRegion();
     _selectionMode = mode;
 }
 
 void GLWidget::clearSelection()
 {
     _currentSelection.clear();
-    updateGL();
+    _currentOutline.clear();
+    _outlineValid = true;
+    resetHistory();
+    publishState();
 }
 
-void GLWidget::setCurrentSelection(std::set<unsigned int>* selection)
+void GLWidget::setCurrentSelection(const FaceSelection &selection, const FaceSelection *outline)
 {
-    _currentSelection.clear();
-    _currentSelection.insert( selection->begin(), selection->end());
-
-    updateGL();
+    _currentSelection = selection;
+    if ( outline )
+    {
+        _currentOutline = *outline;
+        _outlineValid = true;
+    }
+    else
+    {
+        _outlineValid = false;
+        updateOutline(selection);
+    }
+    resetHistory();
+    publishState();
 }
 
 void GLWidget::setRenderMode(RenderMode mode)
 {
     _renderMode = mode;
+    publishState();
+}
 
-    switch (_renderMode) {
-        case POINTS:
-            glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
-            break;
-        case WIRED:
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            break;
-        default:
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            break;
+void GLWidget::setPickSize(unsigned int size)
+{
+    _pickSize =  size;
+}
+
+void GLWidget::showStats(bool enabled)
+{
+    _showStats = enabled;
+    publishState();
+}
+
+void GLWidget::showAllBookmarks(bool enabled)
+{
+    _showAllBookmarks = enabled;
+    publishState();
+}
+
+void GLWidget::setBookmarkLabels(QSharedPointer<const FaceLabels> labels)
+{
+    _bookmarkLabels = labels;
+    publishState();
+}
+
+void GLWidget::showOutline(bool enabled)
+{
+    _showOutline = enabled;
+    if ( _showOutline && !_outlineValid )
+        updateOutline(_currentSelection);
+    publishState();
+}
+
+void GLWidget::showAllOutlines(bool enabled)
+{
+    _showAllOutlines = enabled;
+    publishState();
+}
+
+void GLWidget::setBookmarkOutlines(const QVector<FaceSelection> &outlines)
+{
+    _bookmarkOutlines = outlines;
+    publishState();
+}
+
+FaceSelection GLWidget::outlineOf(const FaceSelection &faces) const
+{
+    FaceSelection edges;
+    _scene->edges.boundary(faces, &edges);
+    return edges;
+}
+
+FaceSelection GLWidget::getCurrentOutline()
+{
+    if ( !_outlineValid )
+    {
+        _scene->edges.boundary(_currentSelection, &_currentOutline);
+        _outlineValid = true;
     }
+    return _currentOutline;
+}
 
-    updateGL();
+void GLWidget::setBrushShape(BrushShape shape)
+{
+    _brushShape = shape;
 }
 
-void GLWidget::setPickSize(unsigned int size)
+void GLWidget::setVisibleOnly(bool enabled)
 {
-    _pickSize =  size;
+    if ( _visibleOnly == enabled )
+        return;
+
+    // Strokes wait for a capture with the new setting.
+    _visibleOnly = enabled;
+    _faceGrid.clear();
+    publishState();
+}
+
+void GLWidget::enableHoverMode(bool enabled)
+{
+    _hoverMode = enabled;
+    _hoverPending = false;
+    _hoverFace = -1;
+    setMouseTracking(enabled);
 }
 
 void GLWidget::enableHitMode(bool enabled)
 {
     _hitMode = enabled;
     _currentSelection.clear();
-    updateGL();
+    _currentOutline.clear();
+    _outlineValid = true;
+    resetHistory();
+    publishState();
 }
 
-std::set<unsigned int> GLWidget::getCurrentSelection()
+FaceSelection GLWidget::getCurrentSelection() const
 {
     return _currentSelection;
 }
+
+void GLWidget::resetHistory()
+{
+    _history.clear();
+    _strokeEnded = false;
+    _region.clear();
+    _regionBase.clear();
+    _regionFaces.clear();
+    _regionCount = 0;
+    _lasso.clear();
+    _lassoClosed = false;
+    emit historyChanged(false, false);
+}
+
+void GLWidget::combineSelection(const FaceSelection &faces, SelectionOperation operation)
+{
+    finishRegion();
+
+    ScopedProbe probe(Profiler::PICK_LATENCY);
+    FaceSelection before = _currentSelection;
+    switch (operation) {
+        case UNITE_SELECTION:
+            _currentSelection.unite(faces);
+            break;
+        case INTERSECT_SELECTION:
+            _currentSelection.intersect(faces);
+            break;
+        case SUBTRACT_SELECTION:
+            _currentSelection.subtract(faces);
+            break;
+        case TOGGLE_SELECTION:
+            _currentSelection.symmetricDifference(faces);
+            break;
+    }
+
+    _history.changed(before, _currentSelection);
+    updateOutlineFrom(before);
+    commitStroke();
+    publishState();
+}
+
+void GLWidget::undoSelection()
+{
+    // Pending samples belong to the stroke being undone. Without depth to pick
+    // them they are dropped, and only the faces the stroke already changed are
+    // undone, never an earlier step.
+    bool undo = true;
+    if ( !_brushSamples.isEmpty() )
+    {
+        if ( !picking(_brushSamples) )
+            undo = _history.commit();
+        _brushSamples.clear();
+    }
+    _strokeEnded = false;
+    finishRegion();
+
+    FaceSelection before = _currentSelection;
+    if ( undo && _history.undo(&_currentSelection) )
+    {
+        updateOutlineFrom(before);
+        publishState();
+    }
+    emit historyChanged(_history.canUndo(), _history.canRedo());
+}
+
+void GLWidget::redoSelection()
+{
+    FaceSelection before = _currentSelection;
+    if ( _history.redo(&_currentSelection) )
+    {
+        updateOutlineFrom(before);
+        publishState();
+    }
+    emit historyChanged(_history.canUndo(), _history.canRedo());
+}
+
+bool GLWidget::canUndoSelection() const
+{
+    return _history.canUndo();
+}
+
+bool GLWidget::canRedoSelection() const
+{
+    return _history.canRedo();
+}
+
+void GLWidget::setSelectionTool(SelectionTool tool)
+{
+    finishRegion();
+    _selectionTool = tool;
+
+    // A polygon being drawn is dropped, a closed lasso is still applied.
+    if ( !_lassoClosed && !_lasso.isEmpty() )
+    {
+        _lasso.clear();
+        publishState();
+    }
+}
+
+void GLWidget::setRegionCriterion(GrowCriterion criterion)
+{
+    if ( _regionCriterion == criterion )
+        return;
+
+    _regionCriterion = criterion;
+    if ( _region.isActive() )
+    {
+        // Levels depend on the criterion, flood again.
+        unsigned int seed = _region.getSeed();
+        _region.start(&_adjacency, seed, _regionCriterion);
+        applyRegion();
+    }
+}
+
+void GLWidget::setRegionThreshold(float degrees)
+{
+    _regionThreshold = degrees * M_PI / 180.0;
+    if ( _region.isActive() )
+        applyRegion();
+}
+
+void GLWidget::startRegion(unsigned int seed)
+{
+    _regionBase = _currentSelection;
+    _regionFaces.clear();
+    _regionCount = 0;
+    _region.start(&_adjacency, seed, _regionCriterion);
+    applyRegion();
+}
+
+void GLWidget::applyRegion()
+{
+    ScopedProbe probe(Profiler::PICK_LATENCY);
+
+    // Only the faces between the previous and the new threshold change.
+    unsigned int count = _region.grow(_regionThreshold);
+    if ( count > _regionCount )
+        _region.insert(_regionCount, count, &_regionFaces);
+    else
+        _region.remove(count, _regionCount, &_regionFaces);
+    _regionCount = count;
+
+    FaceSelection before = _currentSelection;
+    _currentSelection = _regionBase;
+    if ( _selectionMode == ADD )
+        _currentSelection.unite(_regionFaces);
+    if ( _selectionMode == DEL )
+        _currentSelection.subtract(_regionFaces);
+
+    _history.changed(before, _currentSelection);
+    updateOutlineFrom(before);
+    emit historyChanged(_history.canUndo(), _history.canRedo());
+    publishState();
+}
+
+void GLWidget::finishRegion()
+{
+    if ( !_region.isActive() )
+        return;
+
+    _region.clear();
+    _regionBase.clear();
+    _regionFaces.clear();
+    _regionCount = 0;
+    commitStroke();
+}
@@ -2,12 +2,28 @@
 #define GLWIDGET_H
 
 #include <glu.h>
-#include <set>
 #include <QGLWidget>
 #include <QMouseEvent>
 #include <QDateTime>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
 #include "plyimporter.h"
 #include "bookmarklist.h"
+#include "faceselection.h"
+#include "selectionhistory.h"
+#include "camera.h"
+#include "glscene.h"
+#include "raypicker.h"
+#include "projectedfacegrid.h"
+#include "meshclusters.h"
+#include "lodmesh.h"
+#include "meshedges.h"
+#include "faceadjacency.h"
+#include "regiongrow.h"
+#include "geodesicbrush.h"
+#include "renderthread.h"
+#include "profiler.h"
 
 /**
  * @brief The Mode enum represents how mouse click affects to the view:
@@ -33,16 +49,44 @@ enum SelectionMode {
 };
 
 /**
- * @brief The RenderMode enum represents a diferents mode to render the scene:
- * SOLID: Solid mode. (default)
- * WIRE: Wire mode.
- * SOLID_WIRE: Solid + wire mode.
+ * @brief The BrushShape enum represents the shape of the pick window:
+ * SQUARE_BRUSH: Square of pick size side. (default)
+ * CIRCLE_BRUSH: Circle of pick size diameter.
  */
-enum RenderMode {
-    POINTS,
-    WIRED,
-    SOLID,
-    SOLID_WIRE
+enum BrushShape {
+    SQUARE_BRUSH,
+    CIRCLE_BRUSH
+};
+
+/**
+ * @brief The SelectionOperation enum represents how a face set is combined
+ * with the current selection:
+ * UNITE_SELECTION: Faces in either set.
+ * INTERSECT_SELECTION: Faces in both sets.
+ * SUBTRACT_SELECTION: Faces of the selection not in the set.
+ * TOGGLE_SELECTION: Faces in only one of the sets (symmetric difference).
+ */
+enum SelectionOperation {
+    UNITE_SELECTION,
+    INTERSECT_SELECTION,
+    SUBTRACT_SELECTION,
+    TOGGLE_SELECTION
+};
+
+/**
+ * @brief The SelectionTool enum represents how faces are picked in PICK mode:
+ * BRUSH_TOOL: Faces under the brush along the stroke. (default)
+ * REGION_TOOL: Faces flooded from the clicked face under an angle threshold.
+ * LASSO_TOOL: Faces inside a freehand outline, applied on release.
+ * POLYGON_TOOL: Faces inside a polygon clicked corner by corner, applied on double click.
+ * GEODESIC_TOOL: Faces within the brush radius along the surface from the face under the brush.
+ */
+enum SelectionTool {
+    BRUSH_TOOL,
+    REGION_TOOL,
+    LASSO_TOOL,
+    POLYGON_TOOL,
+    GEODESIC_TOOL
 };
 
 /**
@@ -64,7 +108,9 @@ enum RenderMode {
  *
  * @section DESCRIPTION
  *
- * The GLWidget class represents a 3D model viewer.
+ * The GLWidget class represents a 3D model viewer. It handles user
+ * input, selection and picking in the GUI thread; GL work is done by a
+ * RenderThread fed with snapshots of the viewer state.
  */
 class GLWidget : public QGLWidget
 {
@@ -75,46 +121,166 @@ private:
     Mode _mode;                      /**< Current viewer mode. */
     SelectionMode _selectionMode;    /**< Current selection mode. */
     RenderMode _renderMode;          /**< Current render mode. */
-    Model* _model;                   /**< 3D Model. */
     QPoint _lastPos;                 /**< Last mouse position. */
+    QTimer _frameTimer;              /**< Fires once per frame when there is pending work. */
+    QElapsedTimer _frameClock;       /**< Time since last frame. */
+    float _pendingHAngle;            /**< Horizontal rotation accumulated since last frame. */
+    float _pendingVAngle;            /**< Vertical rotation accumulated since last frame. */
+    float _pendingDistance;          /**< Zoom accumulated since last frame. */
+    QVector<QPoint> _brushSamples;   /**< Brush positions not applied yet. */
     bool _isPicking;                 /**< True when picking (selecting polygons). */
     bool _hitMode;                   /**< True when hit mode is enabled. */
-
-    GLuint _modelDisplayListIndex;   /**< Index of displayList */
-    GLubyte _displayLists[2];        /**< References to displayList */
-
-    float _cameraDistance;           /**< Camera distance from origin. */
-    float _cameraHAngle;             /**< Camera horizontal angle. */
-    float _cameraVAngle;             /**< camera vertical angle. */
+    bool _hoverMode;                 /**< True to report the face under the mouse. */
+    bool _hoverPending;              /**< True when the mouse moved since the last hover pick. */
+    bool _redrawPending;             /**< True if the next frame changes what is drawn. */
+    QPoint _hoverPos;                /**< Last mouse position without buttons. */
+    int _hoverFace;                  /**< Face under the mouse last reported, -1 for none. */
+
+    RenderThread* _renderThread;     /**< Thread doing the GL work. */
+    QSharedPointer<RenderScene> _scene;  /**< Model, clusters and reduced models. */
+    QVector<float> _previewPoints;   /**< Points shown while the model loads. */
+    float _previewSize;              /**< Model size of the last preview. */
+    bool _cameraMoving;              /**< True until the camera is still for LOD_RESTORE_DELAY ms. */
+    QTimer _stillTimer;              /**< Fires when the camera stops moving. */
+    std::vector<unsigned char> _visibleClusters;  /**< Clusters visible with the current camera. */
+
+    Camera _camera;                  /**< Viewer camera. */
     float _cameraIncrement;          /**< Camera steps (depends of model size). */
+    RayPicker _rayPicker;            /**< CPU picker used in hit mode and to seed regions. */
+    FaceAdjacency _adjacency;        /**< Faces sharing an edge, for surface tools. */
 
     unsigned int _pickSize;           /**< Pick window size. */
+    BrushShape _brushShape;           /**< Pick window shape. */
+    bool _visibleOnly;                /**< True to pick only the faces seen at the brush pixels. */
+    SelectionTool _selectionTool;     /**< Current selection tool. */
+    RegionGrow _region;               /**< Region being grown, while its threshold can change. */
+    GrowCriterion _regionCriterion;   /**< Angle limiting regions. */
+    float _regionThreshold;           /**< Maximum angle of regions (radians). */
+    FaceSelection _regionBase;        /**< Current selection before the region. */
+    FaceSelection _regionFaces;       /**< Faces of the region applied. */
+    unsigned int _regionCount;        /**< Number of faces of the region applied. */
+    QVector<QPoint> _lasso;           /**< Lasso or polygon outline being drawn. */
+    bool _lassoClosed;                /**< True when the outline waits to be applied. */
+    GeodesicBrush _geodesic;          /**< Surface distances of the geodesic stroke. */
+    bool _geodesicNewStroke;          /**< True until the first sample of a geodesic stroke sets its radius. */
+    ProjectedFaceGrid _faceGrid;      /**< Faces projected with the current camera. */
+    bool _showStats;                  /**< True to draw the performance overlay. */
+    bool _showAllBookmarks;           /**< True to color faces by bookmark. */
+    QSharedPointer<const FaceLabels> _bookmarkLabels;  /**< Bookmark label of each face. */
+
+    FaceSelection _currentSelection;  /**< Faces selected by user, shared with the render thread. */
+    SelectionHistory _history;        /**< Undo/redo steps of the current selection. */
+    bool _strokeEnded;                /**< True when the mouse was released with brush samples pending. */
+    bool _showOutline;                /**< True to draw the selection outline instead of its faces. */
+    FaceSelection _currentOutline;    /**< Boundary edges of the current selection. */
+    bool _outlineValid;               /**< True when the outline matches the current selection. */
+    bool _showAllOutlines;            /**< True to draw the outline of every bookmark. */
+    QVector<FaceSelection> _bookmarkOutlines;  /**< Boundary edges of each bookmark, from bookmark 1. */
+
+    /**
+     * @brief Select polygons under the brush, for a batch of brush positions.
+     * @param samples Brush positions.
+     * @return False if the face grid of the current camera is not ready yet.
+     */
+    bool picking(const QVector<QPoint> &samples);
+
+    /**
+     * @brief Select polygons within the geodesic brush radius, for a batch of brush positions.
+     * @param samples Brush positions.
+     * @return Always true, the ray picker does not wait for the render thread.
+     */
+    bool pickingGeodesic(const QVector<QPoint> &samples);
+
+    /**
+     * @brief Return the brush radius in model units at the depth of a face.
+     * @param face Face under the brush.
+     * @return Radius (model units).
+     */
+    float geodesicRadius(unsigned int face) const;
+
+    /**
+     * @brief Select polygons inside the closed lasso or polygon outline.
+     * @return False if the face grid of the current camera is not ready yet.
+     */
+    bool pickingLasso();
+
+    /**
+     * @brief Close the outline being drawn. It is applied on the next frame
+     * with a face grid.
+     */
+    void closeLasso();
+
+    /**
+     * @brief Add or remove faces, as set by the selection mode, and record
+     * the faces that change in the stroke undo step.
+     * @param faces Faces to apply, sorted and each face once.
+     */
+    void applyFaces(const std::vector<unsigned int> &faces);
 
-    std::set<unsigned int> _currentSelection;  /**< Faces selected by user. */
+    /**
+     * @brief Add brush positions from the last position to a new one,
+     * spaced so that consecutive brush windows overlap.
+     * @param position New brush position.
+     */
+    void addBrushSamples(QPoint position);
+
+    /**
+     * @brief Update the outline after some faces of the current selection changed.
+     * Small changes only test the edges of the changed faces. Nothing is done
+     * while the outline is hidden, it is computed again when shown.
+     * @param changed Faces added to or removed from the selection.
+     */
+    void updateOutline(const FaceSelection &changed);
+
+    /**
+     * @brief Update the outline after the current selection changed.
+     * @param before Selection before the change.
+     */
+    void updateOutlineFrom(const FaceSelection &before);
 
     /**
-     * @brief Draw a polygon solid or wired.
-     * @param poly Polygon to draw.
-     * @param wired True for wired mode, false for solid mode.
+     * @brief Close the undo step of the current stroke.
      */
-    void drawPoly(Poly *poly, bool wired);
+    void commitStroke();
 
     /**
-     * @brief Special render to select polygons.
-     * @param x Horizontal mouse position.
-     * @param y Vertical mouse position.
+     * @brief Drop the undo steps and the region or outline in progress, the selection is replaced.
      */
-    void picking(int x, int y);
+    void resetHistory();
 
     /**
-     * @brief Configure camera on scene.
+     * @brief Grow a new region from a face over the current selection.
+     * @param seed Seed face.
      */
-    void setCamera();
+    void startRegion(unsigned int seed);
 
     /**
-     * @brief Initialize the display lists.
+     * @brief Apply the region of the current threshold to the current selection.
      */
-    void createDisplayLists();
+    void applyRegion();
+
+    /**
+     * @brief Stop growing the region in progress and close its undo step.
+     */
+    void finishRegion();
+
+    /**
+     * @brief Apply camera changes accumulated since last frame.
+     * @return True if camera changed, false otherwise.
+     */
+    bool applyCameraChanges();
+
+    /**
+     * @brief Request a frame. Several requests before the next display
+     * refresh produce a single frame.
+     * @param redraw False if the frame only picks the face under the mouse.
+     */
+    void scheduleFrame(bool redraw = true);
+
+    /**
+     * @brief Send a snapshot of the viewer state to the render thread.
+     */
+    void publishState();
 
 protected:
     /**
@@ -129,42 +295,78 @@ protected:
      */
     void mouseMoveEvent(QMouseEvent *moveEvent);
 
+    /**
+     * @brief Represents a user interaction: Mouse release. Ends a stroke.
+     * @param releaseEvent Mouse event.
+     */
+    void mouseReleaseEvent(QMouseEvent *releaseEvent);
+
+    /**
+     * @brief Represents a user interaction: Double click. Closes a polygon.
+     * @param event Mouse event.
+     */
+    void mouseDoubleClickEvent(QMouseEvent *event);
+
     /**
      * @brief Represents a user interaction: Mouse wheel move.
      * @param event Mouse event.
      */
     void wheelEvent(QWheelEvent *event);
 
+    /**
+     * @brief Ask the render thread to redraw. No GL work in the GUI thread.
+     * @param event Paint event.
+     */
+    void paintEvent(QPaintEvent *event);
+
+    /**
+     * @brief Update the viewport size of the camera. No GL work in the GUI thread.
+     * @param event Resize event.
+     */
+    void resizeEvent(QResizeEvent *event);
+
+    /**
+     * @brief Redirect QGLWidget redraws to the render thread.
+     */
+    void glDraw();
+
 public:
 
     /**
-     * @brief Default constructor.
+     * @brief Default constructor. Starts the render thread.
      * @param parent Parent of widget.
      */
     GLWidget(QWidget *parent = 0);
 
     /**
-     * @brief Configure OpenGL environment.
+     * @brief Destructor. Stops the render thread.
      */
-    void initializeGL();
+    ~GLWidget();
 
     /**
-     * @brief Main OpenGL draw function.
+     * @brief Ask the render thread to redraw.
      */
-    void paintGL();
+    void updateGL();
 
     /**
-     * @brief Main resize OpenGL function.
-     * @param width New viewer width.
-     * @param height New viewer height.
+     * @brief Set a new model to draw. The viewer takes ownership of the model.
+     * Display lists are compiled over the next frames by the render thread,
+     * the loading preview is drawn until they are ready.
+     * @param model Model to draw.
+     * @param clusters If not null, clusters already built for the model (swapped in).
+     * @param rayPicker If not null, ray picker already built for the model (swapped in).
+     * @param lod If not null, reduced models already built for the model (swapped in).
+     * @param edges If not null, unique edges already built for the model (swapped in).
+     * @param adjacency If not null, face adjacency already built for the model (swapped in).
      */
-    void resizeGL(int width, int height);
+    void setModel(Model* model, MeshClusters *clusters = 0, RayPicker *rayPicker = 0, LodMesh *lod = 0,
+                  MeshEdges *edges = 0, FaceAdjacency *adjacency = 0);
 
     /**
-     * @brief Set a new model to draw.
-     * @param model Model to draw.
+     * @brief Return the model drawn.
+     * @return Current model, empty if none was set. Owned by the viewer.
      */
-    void setModel(Model* model);
+    Model* getModel();
 
     /**
      * @brief Change viewer mode.
@@ -179,7 +381,7 @@ public:
     void setSelectionMode(SelectionMode mode);
 
     /**
-     * @brief Clear viewer.
+     * @brief Clear viewer. The model is replaced by an empty one.
      */
     void clear();
 
@@ -190,9 +392,10 @@ public:
 
     /**
      * @brief Set the current selection.
-     * @param selection Current selection to display.
+     * @param selection Current selection to display. Shared, not copied.
+     * @param outline If not null, boundary edges of the selection, cached by the caller.
      */
-    void setCurrentSelection(std::set<unsigned int> *selection);
+    void setCurrentSelection(const FaceSelection &selection, const FaceSelection *outline = 0);
 
     /**
      * @brief Set the current render mode.
@@ -206,6 +409,93 @@ public:
      */
     void setPickSize(unsigned int size);
 
+    /**
+     * @brief Show or hide the performance overlay.
+     * @param enabled True to show the overlay.
+     */
+    void showStats(bool enabled);
+
+    /**
+     * @brief Color every face by its bookmark instead of the model color.
+     * @param enabled True to show all bookmarks.
+     */
+    void showAllBookmarks(bool enabled);
+
+    /**
+     * @brief Set the bookmark labels used to show all bookmarks.
+     * @param labels Latest labels version.
+     */
+    void setBookmarkLabels(QSharedPointer<const FaceLabels> labels);
+
+    /**
+     * @brief Draw the current selection as a thick outline along its boundary edges.
+     * @param enabled True to show the outline instead of the faces.
+     */
+    void showOutline(bool enabled);
+
+    /**
+     * @brief Draw the outline of every bookmark.
+     * @param enabled True to show all outlines.
+     */
+    void showAllOutlines(bool enabled);
+
+    /**
+     * @brief Set the bookmark outlines used to show all outlines.
+     * @param outlines Boundary edges of each bookmark, from bookmark 1. Shared, not copied.
+     */
+    void setBookmarkOutlines(const QVector<FaceSelection> &outlines);
+
+    /**
+     * @brief Compute the boundary edges of a face set of the current model.
+     * @param faces Face set.
+     * @return Edges with a single face in the set.
+     */
+    FaceSelection outlineOf(const FaceSelection &faces) const;
+
+    /**
+     * @brief Return the boundary edges of the current selection, computed if not up to date.
+     * @return Current outline. Shared, not copied.
+     */
+    FaceSelection getCurrentOutline();
+
+    /**
+     * @brief Set the current pick shape.
+     * @param shape New pick shape.
+     */
+    void setBrushShape(BrushShape shape);
+
+    /**
+     * @brief Pick only the faces seen at the brush pixels, using a face id
+     * buffer captured once per camera. Otherwise faces in the brush are
+     * tested against the depth buffer.
+     * @param enabled True to pick visible faces only.
+     */
+    void setVisibleOnly(bool enabled);
+
+    /**
+     * @brief Set the current selection tool. A region in progress is finished.
+     * @param tool New selection tool.
+     */
+    void setSelectionTool(SelectionTool tool);
+
+    /**
+     * @brief Set the angle limiting regions. A region in progress grows from its seed again.
+     * @param criterion New criterion.
+     */
+    void setRegionCriterion(GrowCriterion criterion);
+
+    /**
+     * @brief Set the maximum angle of regions. A region in progress follows it.
+     * @param degrees New maximum angle (degrees).
+     */
+    void setRegionThreshold(float degrees);
+
+    /**
+     * @brief Report the face under the mouse while no button is pressed, at most once per frame.
+     * @param enabled Enable hover mode.
+     */
+    void enableHoverMode(bool enabled);
+
     /**
      * @brief Enable or disable hit mode.
      * @param Enable hit mode.
@@ -214,12 +504,78 @@ public:
 
     /**
      * @brief Return current selection.
-     * @return Current selection.
+     * @return Current selection. Shared, not copied.
+     */
+    FaceSelection getCurrentSelection() const;
+
+    /**
+     * @brief Combine a face set with the current selection, as a single undo step.
+     * @param faces Face set, such as the faces of a bookmark.
+     * @param operation How the set is combined.
+     */
+    void combineSelection(const FaceSelection &faces, SelectionOperation operation);
+
+    /**
+     * @brief Revert the last stroke on the current selection.
+     */
+    void undoSelection();
+
+    /**
+     * @brief Apply again the last stroke reverted.
+     */
+    void redoSelection();
+
+    /**
+     * @brief Get if there is a stroke to undo.
+     * @return True if undo is possible, false otherwise.
      */
-    std::set<unsigned int> getCurrentSelection();
+    bool canUndoSelection() const;
+
+    /**
+     * @brief Get if there is a stroke to redo.
+     * @return True if redo is possible, false otherwise.
+     */
+    bool canRedoSelection() const;
+
+    static const int FRAME_INTERVAL = 16;       /**< Minimum time between frames (ms). */
+    static const int LOD_RESTORE_DELAY = 300;   /**< Still time before drawing the full model again (ms). */
+    static const int LASSO_STEP = 4;            /**< Minimum distance between lasso points (pixels). */
 
 signals:
-    void pickResult(std::set<unsigned int> hit);
+    void pickResult(FaceSelection hit);
+    void historyChanged(bool canUndo, bool canRedo);
+    void faceHovered(int face, QPoint position);
+
+public slots:
+
+    /**
+     * @brief Show a coarse preview of a model being loaded.
+     * @param points Vertex positions (x, y, z).
+     * @param size Model size.
+     */
+    void setPreview(QVector<float> points, float size);
+
+private slots:
+
+    /**
+     * @brief Apply the accumulated camera and brush changes and redraw.
+     */
+    void processFrame();
+
+    /**
+     * @brief Draw the full model again when the camera stops moving.
+     */
+    void cameraStill();
+
+    /**
+     * @brief Build the face grid from the depth captured by the render thread.
+     */
+    void depthReady();
+
+    /**
+     * @brief Drop the loading preview once the model display lists are ready.
+     */
+    void sceneCompiled();
 
 };
 
@@ -0,0 +1,193 @@
+#include "labelmesh.h"
+
+#include <algorithm>
+
+LabelMesh::LabelMesh() :
+    _geometry(QGLBuffer::VertexBuffer), _colors(QGLBuffer::VertexBuffer)
+{
+    _model = 0;
+    _numVertices = 0;
+}
+
+Model* LabelMesh::getModel() const
+{
+    return _model;
+}
+
+void LabelMesh::clear()
+{
+    _geometry.destroy();
+    _colors.destroy();
+    _model = 0;
+    _numVertices = 0;
+    _faceFirst.clear();
+    _labels.clear();
+    _applied.clear();
+}
+
+void LabelMesh::build(Model *model)
+{
+    clear();
+
+    // Triangle fan of each face, three vertices per triangle.
+    unsigned int numFaces = model->numPoly();
+    _faceFirst.resize(numFaces + 1);
+    _faceFirst[0] = 0;
+    for ( unsigned int f = 0; f < numFaces; ++f )
+    {
+        int size = model->getPolyAt(f)->size();
+        _faceFirst[f + 1] = _faceFirst[f] + (size >= 3 ? 3 * (size - 2) : 0);
+    }
+    _numVertices = _faceFirst[numFaces];
+
+    std::vector<float> geometry(_numVertices * 6);
+    for ( unsigned int f = 0; f < numFaces; ++f )
+    {
+        Poly *poly = model->getPolyAt(f);
+        float *out = &geometry[0] + _faceFirst[f] * 6;
+        for ( int j = 1; j + 1 < poly->size(); ++j )
+        {
+            unsigned int corners[3] = { poly->getAt(0), poly->getAt(j), poly->getAt(j + 1) };
+            for ( int k = 0; k < 3; ++k )
+            {
+                Vertex *vertex = model->getVertexAt(corners[k]);
+                *out++ = vertex->getX();
+                *out++ = vertex->getY();
+                *out++ = vertex->getZ();
+                *out++ = vertex->getNormalX();
+                *out++ = vertex->getNormalY();
+                *out++ = vertex->getNormalZ();
+            }
+        }
+    }
+
+    _geometry.create();
+    _geometry.setUsagePattern(QGLBuffer::StaticDraw);
+    _geometry.bind();
+    _geometry.allocate(geometry.empty() ? 0 : &geometry[0], geometry.size() * sizeof(float));
+    _geometry.release();
+
+    _colors.create();
+    _colors.setUsagePattern(QGLBuffer::DynamicDraw);
+    _colors.bind();
+    _colors.allocate(_numVertices * 3);
+    _colors.release();
+
+    _model = model;
+    _labels.assign(numFaces, 0);
+    writeColors(0, numFaces);
+}
+
+void LabelMesh::writeColors(unsigned int first, unsigned int last)
+{
+    if ( first >= last || _faceFirst[last] == _faceFirst[first] )
+        return;
+
+    std::vector<unsigned char> colors((_faceFirst[last] - _faceFirst[first]) * 3);
+    unsigned char *out = &colors[0];
+    for ( unsigned int f = first; f < last; ++f )
+    {
+        unsigned char rgb[3];
+        BookmarkLabels::labelColor(_labels[f], rgb);
+        for ( unsigned int v = _faceFirst[f]; v < _faceFirst[f + 1]; ++v )
+        {
+            *out++ = rgb[0];
+            *out++ = rgb[1];
+            *out++ = rgb[2];
+        }
+    }
+
+    _colors.bind();
+    _colors.write(_faceFirst[first] * 3, &colors[0], colors.size());
+    _colors.release();
+}
+
+void LabelMesh::update(const QSharedPointer<const FaceLabels> &labels)
+{
+    if ( !_model || !labels || labels == _applied )
+        return;
+
+    // Versions after the applied one, newest first. Stop at a full version.
+    std::vector<const FaceLabels*> chain;
+    const FaceLabels *node = labels.data();
+    while ( node && !(_applied && node->version == _applied->version) )
+    {
+        chain.push_back(node);
+        if ( node->previous.isNull() )
+            break;
+        node = node->previous.data();
+    }
+
+    std::vector<unsigned int> changed;
+    bool rewrite = false;
+    std::vector<const FaceLabels*>::reverse_iterator it = chain.rbegin();
+    for ( ; it != chain.rend(); ++it )
+    {
+        const FaceLabels *version = *it;
+        if ( version->previous.isNull() )
+        {
+            // Full version: rewrite every color.
+            unsigned int count = std::min(version->labels.size(), _labels.size());
+            std::copy(version->labels.begin(), version->labels.begin() + count, _labels.begin());
+            changed.clear();
+            rewrite = true;
+            continue;
+        }
+
+        for ( unsigned int i = 0; i < version->faces.size(); ++i )
+        {
+            if ( version->faces[i] >= _labels.size() )
+                continue;
+            _labels[version->faces[i]] = version->faceLabels[i];
+            changed.push_back(version->faces[i]);
+        }
+    }
+    _applied = labels;
+
+    if ( rewrite )
+    {
+        writeColors(0, _labels.size());
+        return;
+    }
+
+    if ( changed.empty() )
+        return;
+
+    // Write runs of nearby changed faces.
+    std::sort(changed.begin(), changed.end());
+    unsigned int first = changed[0];
+    unsigned int last = changed[0] + 1;
+    for ( unsigned int i = 1; i < changed.size(); ++i )
+    {
+        if ( changed[i] > last + RUN_GAP )
+        {
+            writeColors(first, last);
+            first = changed[i];
+        }
+        last = std::max(last, changed[i] + 1);
+    }
+    writeColors(first, last);
+}
+
+void LabelMesh::draw()
+{
+    if ( !_model || _numVertices == 0 )
+        return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    _geometry.bind();
+    glVertexPointer(3, GL_FLOAT, 6 * sizeof(float), 0);
+    glNormalPointer(GL_FLOAT, 6 * sizeof(float), (const GLvoid*)(3 * sizeof(float)));
+    _colors.bind();
+    glColorPointer(3, GL_UNSIGNED_BYTE, 0, 0);
+
+    glDrawArrays(GL_TRIANGLES, 0, _numVertices);
+
+    _colors.release();
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
@@ -0,0 +1,94 @@
+#ifndef LABELMESH_H
+#define LABELMESH_H
+
+#include <vector>
+#include <QGLBuffer>
+#include <QSharedPointer>
+#include "model.h"
+#include "bookmarklabels.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The LabelMesh class draws the whole model colored by face labels in a
+ * single draw call. Faces are split in triangles with their own vertices
+ * in a vertex buffer, so each face can have its own color in a second
+ * buffer. When labels change, only the colors of the changed faces are
+ * written. All functions need the GL context current.
+ */
+class LabelMesh
+{
+private:
+
+    Model *_model;                             /**< Model of the buffers, null if not built. */
+    QGLBuffer _geometry;                       /**< Interleaved position and normal per split vertex. */
+    QGLBuffer _colors;                         /**< RGB color per split vertex. */
+    unsigned int _numVertices;                 /**< Split vertices. */
+    std::vector<unsigned int> _faceFirst;      /**< First split vertex of each face, one extra at end. */
+    std::vector<unsigned short> _labels;       /**< Label of each face in the color buffer. */
+    QSharedPointer<const FaceLabels> _applied; /**< Version in the color buffer. */
+
+    /**
+     * @brief Write the colors of a range of faces.
+     * @param first First face.
+     * @param last Face after the last one.
+     */
+    void writeColors(unsigned int first, unsigned int last);
+
+public:
+
+    static const unsigned int RUN_GAP = 256;   /**< Changed faces closer than this are written together. */
+
+    /**
+     * @brief Default constructor.
+     */
+    LabelMesh();
+
+    /**
+     * @brief Build the buffers of a model, every face with label 0.
+     * @param model Model to draw.
+     */
+    void build(Model *model);
+
+    /**
+     * @brief Release the buffers. Must be called before the context is destroyed.
+     */
+    void clear();
+
+    /**
+     * @brief Return the model of the buffers.
+     * @return Model, null if not built.
+     */
+    Model* getModel() const;
+
+    /**
+     * @brief Bring the color buffer to a labels version, writing only
+     * the faces changed since the version applied.
+     * @param labels Labels version.
+     */
+    void update(const QSharedPointer<const FaceLabels> &labels);
+
+    /**
+     * @brief Draw the model.
+     */
+    void draw();
+
+};
+
+#endif // LABELMESH_H
@@ -0,0 +1,290 @@
+#include "lodmesh.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <QGLWidget>
+
+/**
+ * @brief Read access to the model as a mesh source.
+ */
+struct ModelSource
+{
+    Model *model;
+
+    unsigned int numVertices() const { return model->numVertex(); }
+    unsigned int numFaces() const { return model->numPoly(); }
+    int faceSize(unsigned int face) const { return model->getPolyAt(face)->size(); }
+    unsigned int faceVertex(unsigned int face, int j) const { return model->getPolyAt(face)->getAt(j); }
+
+    void position(unsigned int i, float p[3]) const
+    {
+        Vertex *vertex = model->getVertexAt(i);
+        p[0] = vertex->getX();
+        p[1] = vertex->getY();
+        p[2] = vertex->getZ();
+    }
+
+    void normal(unsigned int i, float n[3]) const
+    {
+        Vertex *vertex = model->getVertexAt(i);
+        n[0] = vertex->getNormalX();
+        n[1] = vertex->getNormalY();
+        n[2] = vertex->getNormalZ();
+    }
+};
+
+/**
+ * @brief Read access to a previous level as a mesh source.
+ */
+template <typename Level>
+struct LevelSource
+{
+    const Level *level;
+
+    unsigned int numVertices() const { return level->vertices.size() / 3; }
+    unsigned int numFaces() const { return level->triangles.size() / 3; }
+    int faceSize(unsigned int) const { return 3; }
+    unsigned int faceVertex(unsigned int face, int j) const { return level->triangles[face * 3 + j]; }
+
+    void position(unsigned int i, float p[3]) const
+    {
+        for ( int k = 0; k < 3; ++k )
+            p[k] = level->vertices[i * 3 + k];
+    }
+
+    void normal(unsigned int i, float n[3]) const
+    {
+        for ( int k = 0; k < 3; ++k )
+            n[k] = level->normals[i * 3 + k];
+    }
+};
+
+/**
+ * @brief Triangle with its smallest index first, winding kept.
+ */
+struct Triangle
+{
+    unsigned int v[3];
+
+    Triangle(unsigned int a, unsigned int b, unsigned int c)
+    {
+        if ( a < b && a < c )
+            { v[0] = a; v[1] = b; v[2] = c; }
+        else if ( b < c )
+            { v[0] = b; v[1] = c; v[2] = a; }
+        else
+            { v[0] = c; v[1] = a; v[2] = b; }
+    }
+
+    bool operator<(const Triangle &other) const
+    {
+        if ( v[0] != other.v[0] ) return v[0] < other.v[0];
+        if ( v[1] != other.v[1] ) return v[1] < other.v[1];
+        return v[2] < other.v[2];
+    }
+
+    bool operator==(const Triangle &other) const
+    {
+        return v[0] == other.v[0] && v[1] == other.v[1] && v[2] == other.v[2];
+    }
+};
+
+/**
+ * @brief Merge the vertices of a source mesh by grid cell.
+ */
+template <typename Source, typename Level>
+static void clusterVertices(const Source &source, const float min[3], float cellSize, int resolution, Level *level)
+{
+    unsigned int numVertices = source.numVertices();
+
+    // Sort vertices by cell to give each occupied cell a compact index.
+    std::vector<unsigned long long> keys(numVertices);
+    for ( unsigned int i = 0; i < numVertices; ++i )
+    {
+        float p[3];
+        source.position(i, p);
+
+        unsigned long long cell = 0;
+        for ( int k = 2; k >= 0; --k )
+        {
+            int c = std::max(0, std::min(resolution - 1, (int)((p[k] - min[k]) / cellSize)));
+            cell = cell * resolution + c;
+        }
+        keys[i] = (cell << 32) | i;
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<unsigned int> remap(numVertices);
+    level->vertices.clear();
+    level->normals.clear();
+    std::vector<unsigned int> counts;
+
+    for ( unsigned int i = 0; i < numVertices; ++i )
+    {
+        if ( i == 0 || (keys[i] >> 32) != (keys[i - 1] >> 32) )
+        {
+            level->vertices.resize(level->vertices.size() + 3, 0.0f);
+            level->normals.resize(level->normals.size() + 3, 0.0f);
+            counts.push_back(0);
+        }
+
+        unsigned int id = counts.size() - 1;
+        unsigned int vertex = (unsigned int)(keys[i] & 0xffffffff);
+        remap[vertex] = id;
+
+        float p[3], n[3];
+        source.position(vertex, p);
+        source.normal(vertex, n);
+        for ( int k = 0; k < 3; ++k )
+        {
+            level->vertices[id * 3 + k] += p[k];
+            level->normals[id * 3 + k] += n[k];
+        }
+        ++counts[id];
+    }
+
+    // Cell vertex: mean position and normal.
+    for ( unsigned int id = 0; id < counts.size(); ++id )
+    {
+        float *n = &level->normals[id * 3];
+        float length = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        for ( int k = 0; k < 3; ++k )
+        {
+            level->vertices[id * 3 + k] /= counts[id];
+            if ( length > 0.0f )
+                n[k] /= length;
+        }
+    }
+
+    // Keep the triangles whose vertices are in three different cells, once.
+    std::vector<Triangle> triangles;
+    unsigned int numFaces = source.numFaces();
+    for ( unsigned int f = 0; f < numFaces; ++f )
+    {
+        int size = source.faceSize(f);
+        if ( size < 3 )
+            continue;
+
+        unsigned int a = remap[source.faceVertex(f, 0)];
+        for ( int j = 1; j + 1 < size; ++j )
+        {
+            unsigned int b = remap[source.faceVertex(f, j)];
+            unsigned int c = remap[source.faceVertex(f, j + 1)];
+            if ( a != b && b != c && a != c )
+                triangles.push_back(Triangle(a, b, c));
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+    level->triangles.resize(triangles.size() * 3);
+    for ( unsigned int t = 0; t < triangles.size(); ++t )
+        for ( int k = 0; k < 3; ++k )
+            level->triangles[t * 3 + k] = triangles[t].v[k];
+}
+
+LodMesh::LodMesh()
+{
+    clear();
+}
+
+void LodMesh::clear()
+{
+    _levels.clear();
+}
+
+void LodMesh::swap(LodMesh &other)
+{
+    _levels.swap(other._levels);
+}
+
+unsigned int LodMesh::size() const
+{
+    return _levels.size();
+}
+
+unsigned int LodMesh::numFaces(unsigned int level) const
+{
+    return _levels[level].triangles.size() / 3;
+}
+
+void LodMesh::build(Model *model)
+{
+    clear();
+
+    if ( model->numVertex() == 0 || model->numPoly() < MIN_FACES )
+        return;
+
+    // Model bounds.
+    float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for ( unsigned int i = 0; i < model->numVertex(); ++i )
+    {
+        Vertex *vertex = model->getVertexAt(i);
+        float p[3] = { vertex->getX(), vertex->getY(), vertex->getZ() };
+        for ( int k = 0; k < 3; ++k )
+        {
+            min[k] = std::min(min[k], p[k]);
+            max[k] = std::max(max[k], p[k]);
+        }
+    }
+
+    float side = std::max(max[0] - min[0], std::max(max[1] - min[1], max[2] - min[2]));
+    if ( side <= 0.0f )
+        return;
+
+    ModelSource modelSource;
+    modelSource.model = model;
+    unsigned int previousFaces = model->numPoly();
+
+    for ( int resolution = FIRST_RESOLUTION; resolution >= 2; resolution /= 2 )
+    {
+        Level level;
+        float cellSize = side / resolution * (1.0f + FLT_EPSILON);
+
+        if ( _levels.empty() )
+            clusterVertices(modelSource, min, cellSize, resolution, &level);
+        else
+        {
+            LevelSource<Level> levelSource;
+            levelSource.level = &_levels.back();
+            clusterVertices(levelSource, min, cellSize, resolution, &level);
+        }
+
+        // A level that hardly reduces the previous one is not worth keeping.
+        unsigned int faces = level.triangles.size() / 3;
+        if ( faces == 0 || faces * 4 > previousFaces * 3 )
+        {
+            if ( faces < MIN_FACES )
+                break;
+            continue;
+        }
+
+        _levels.push_back(Level());
+        _levels.back().vertices.swap(level.vertices);
+        _levels.back().normals.swap(level.normals);
+        _levels.back().triangles.swap(level.triangles);
+        previousFaces = faces;
+
+        if ( faces < MIN_FACES )
+            break;
+    }
+}
+
+void LodMesh::draw(unsigned int level) const
+{
+    const Level &mesh = _levels[level];
+    if ( mesh.triangles.empty() )
+        return;
+
+    glColor3f(0.44, 0.6, 0.95);   // Set model color.
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, &mesh.vertices[0]);
+    glNormalPointer(GL_FLOAT, 0, &mesh.normals[0]);
+    glDrawElements(GL_TRIANGLES, mesh.triangles.size(), GL_UNSIGNED_INT, &mesh.triangles[0]);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
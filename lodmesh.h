@@ -0,0 +1,98 @@
+#ifndef LODMESH_H
+#define LODMESH_H
+
+#include <vector>
+#include "model.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The LodMesh class keeps reduced versions of a model, drawn while the
+ * camera moves. Levels are built by vertex clustering: vertices falling
+ * in the same cell of a regular grid are merged and triangles that
+ * collapse are dropped. The first level uses a grid of FIRST_RESOLUTION
+ * cells along the longest model side and each next level halves it,
+ * starting from the previous level, until a level has less than
+ * MIN_FACES triangles. Level 0 is the finest.
+ */
+class LodMesh
+{
+private:
+
+    /**
+     * @brief Reduced mesh.
+     */
+    struct Level
+    {
+        std::vector<float> vertices;         /**< Vertex positions (x, y, z). */
+        std::vector<float> normals;          /**< Vertex normals (x, y, z). */
+        std::vector<unsigned int> triangles; /**< Triangle vertex indices. */
+    };
+
+    std::vector<Level> _levels;   /**< Levels, finest first. */
+
+public:
+
+    static const int FIRST_RESOLUTION = 256;    /**< Grid cells along the longest side in level 0. */
+    static const unsigned int MIN_FACES = 2000; /**< Last level has less triangles than this. */
+
+    /**
+     * @brief Default constructor.
+     */
+    LodMesh();
+
+    /**
+     * @brief Build the levels of a model.
+     * @param model Model to reduce.
+     */
+    void build(Model *model);
+
+    /**
+     * @brief Clear the levels.
+     */
+    void clear();
+
+    /**
+     * @brief Exchange the levels with another instance.
+     * @param other Levels to exchange with.
+     */
+    void swap(LodMesh &other);
+
+    /**
+     * @brief Return number of levels.
+     * @return Number of levels.
+     */
+    unsigned int size() const;
+
+    /**
+     * @brief Return number of triangles of a level.
+     * @param level Level index.
+     * @return Number of triangles.
+     */
+    unsigned int numFaces(unsigned int level) const;
+
+    /**
+     * @brief Draw a level with vertex arrays. Needs a current GL context.
+     * @param level Level index.
+     */
+    void draw(unsigned int level) const;
+
+};
+
+#endif // LODMESH_H
@@ -1,8 +1,61 @@
 #include "mainwindow.h"
+#include "thumbnailrenderer.h"
 #include <QApplication>
+#include <iostream>
+
+/**
+ * @brief Batch mode: render one image per bookmark without a window.
+ * Usage: 3DMarker --thumbnails model.ply bookmarks.xml outputDir [size] [threads]
+ */
+int renderThumbnails(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    // Size and threads must be positive numbers.
+    bool sizeValid = true;
+    bool threadsValid = true;
+    int size = argc > 5 ? QString(argv[5]).toInt(&sizeValid) : 1;
+    int threads = argc > 6 ? QString(argv[6]).toInt(&threadsValid) : 1;
+
+    if ( argc < 5 || !sizeValid || size <= 0 || !threadsValid || threads <= 0 )
+    {
+        std::cerr << "Usage: " << argv[0] << " --thumbnails model.ply bookmarks.xml outputDir [size] [threads]" << std::endl;
+        std::cerr << "size (at most " << ThumbnailRenderer::MAX_SIZE << ") and threads must be positive numbers." << std::endl;
+        return 1;
+    }
+
+    Model model;
+    PlyImporter importer;
+    if ( !importer.import(&model, argv[2]) )
+        return 1;
+
+    BookmarkList bookmarkList;
+    int errors = 0;
+    if ( !bookmarkList.open(argv[3], model.numPoly() - 1, &errors) )
+    {
+        std::cerr << "Error: Error reading bookmarks file." << std::endl;
+        return 1;
+    }
+
+    ThumbnailRenderer renderer(&model, &bookmarkList);
+    if ( argc > 5 )
+        renderer.setSize(size);
+    if ( argc > 6 )
+        renderer.setThreads(threads);
+
+    int written = renderer.render(argv[4]);
+    if ( written < 0 )
+        return 1;
+
+    std::cout << written << " images written." << std::endl;
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    if ( argc > 1 && QString(argv[1]) == "--thumbnails" )
+        return renderThumbnails(argc, argv);
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -20,11 +20,31 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     markMenu->addAction("&Save file", this, SLOT(saveBookmarksFile()));
     markMenu->addAction("&Save file as...", this, SLOT(saveAsBookmarksFile()));
 
+    QMenu* editMenu = menuBar()->addMenu("&Edit");
+    _undoAction = editMenu->addAction("&Undo stroke", this, SLOT(undoSelection()), QKeySequence::Undo);
+    _redoAction = editMenu->addAction("&Redo stroke", this, SLOT(redoSelection()), QKeySequence::Redo);
+    _undoAction->setEnabled(false);
+    _redoAction->setEnabled(false);
+
     QMenu* viewMenu = menuBar()->addMenu("&View");
     viewMenu->addAction("&View as points",    this,       SLOT(viewAsPoints()) );
     viewMenu->addAction("&View as wired",    this,       SLOT(viewAsWired()) );
     viewMenu->addAction("&View as solid",  this,        SLOT(viewAsSolid()) );
     viewMenu->addAction("&View as solid + wired",this,   SLOT(viewAsSolidWire()) );
+    viewMenu->addSeparator();
+    _allBookmarksAction = viewMenu->addAction("&Show all bookmarks", this, SLOT(showAllBookmarks(bool)) );
+    _allBookmarksAction->setCheckable(true);
+    QAction* outlineAction = viewMenu->addAction("&Show selection as outline", this, SLOT(showSelectionOutline(bool)) );
+    outlineAction->setCheckable(true);
+    _allOutlinesAction = viewMenu->addAction("&Show all outlines", this, SLOT(showAllOutlines(bool)) );
+    _allOutlinesAction->setCheckable(true);
+    viewMenu->addSeparator();
+    _hoverAction = viewMenu->addAction("&Show bookmarks under the mouse", this, SLOT(showHoveredBookmarks(bool)) );
+    _hoverAction->setCheckable(true);
+    viewMenu->addSeparator();
+    QAction* statsAction = viewMenu->addAction("&Show performance overlay", this, SLOT(showPerformanceOverlay(bool)) );
+    statsAction->setCheckable(true);
+    viewMenu->addAction("&Save performance report...", this, SLOT(savePerformanceReport()) );
 
     QMenu* modeMenu = menuBar()->addMenu("&Mode");
     modeMenu->addAction("&Viewer",    this,             SLOT(viewerMode()) );
@@ -46,24 +66,42 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     QObject::connect(ui->saveButton, SIGNAL(clicked()), this, SLOT(saveBookmark()));
     QObject::connect(ui->discardButton, SIGNAL(clicked()), this, SLOT(discardBookmark()));
     QObject::connect(ui->brushSizeSlider, SIGNAL(valueChanged(int)), this, SLOT(setBrushSize(int)));
+    QObject::connect(ui->circleBrushCheckBox, SIGNAL(toggled(bool)), this, SLOT(setCircleBrush(bool)));
+    QObject::connect(ui->visibleOnlyCheckBox, SIGNAL(toggled(bool)), this, SLOT(setVisibleOnly(bool)));
+    QObject::connect(ui->toolComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(setSelectionTool(int)));
+    QObject::connect(ui->regionAngleSlider, SIGNAL(valueChanged(int)), this, SLOT(setRegionAngle(int)));
+    QObject::connect(ui->uniteButton, SIGNAL(clicked()), this, SLOT(uniteBookmark()));
+    QObject::connect(ui->intersectButton, SIGNAL(clicked()), this, SLOT(intersectBookmark()));
+    QObject::connect(ui->subtractButton, SIGNAL(clicked()), this, SLOT(subtractBookmark()));
+    QObject::connect(ui->toggleButton, SIGNAL(clicked()), this, SLOT(toggleBookmark()));
+    QObject::connect(ui->undoButton, SIGNAL(clicked()), this, SLOT(undoSelection()));
+    QObject::connect(ui->redoButton, SIGNAL(clicked()), this, SLOT(redoSelection()));
+    QObject::connect(ui->glwidget, SIGNAL(historyChanged(bool,bool)), this, SLOT(selectionHistoryChanged(bool,bool)));
 
     // Information panel buttons
     QObject::connect(ui->backButton, SIGNAL(clicked()), this, SLOT(showListPanel()));
 
     // Test panel buttons
     QObject::connect(ui->nextQuestionButton, SIGNAL(clicked()), this, SLOT(nextQuestion()));
-    QObject::connect(ui->glwidget, SIGNAL(pickResult(std::set<unsigned int>)), this, SLOT(checkResponse(std::set<unsigned int>)));
+    QObject::connect(ui->glwidget, SIGNAL(pickResult(FaceSelection)), this, SLOT(checkResponse(FaceSelection)));
+    QObject::connect(ui->glwidget, SIGNAL(faceHovered(int,QPoint)), this, SLOT(faceHovered(int,QPoint)));
 
 
     // Set window title.
     setWindowTitle("untitled.txt");
 
     // Initialize variables.
+    _model = ui->glwidget->getModel();
+    _bookmarkLabels = new BookmarkLabels();
     _bookmarkList = new BookmarkList();
     clearBookmarkList();
-    _model = new Model();
     _indexTest = 0;
 
+    // Model loader.
+    _modelLoader = new ModelLoader(this);
+    QObject::connect(_modelLoader, SIGNAL(preview(QVector<float>,float)), ui->glwidget, SLOT(setPreview(QVector<float>,float)));
+    QObject::connect(_modelLoader, SIGNAL(finished(bool)), this, SLOT(modelLoaded(bool)));
+
     // Set viewer mode.
     viewerMode();
 
@@ -86,24 +124,62 @@ void MainWindow::openModel()
 
     if( !path.isNull() )
     {
-        ModelImporter *importer = new PlyImporter();
-
-        if ( importer->import(_model, path) )
+        // The viewer shows previews while the model loads in background.
+        if ( _modelLoader->load(path) )
         {
-            ui->glwidget->setModel( _model );
-            statusBar()->showMessage("Model loaded.");     // Show information message.
+            ui->glwidget->clear();
+            _model = ui->glwidget->getModel();
+            statusBar()->showMessage("Loading model...");     // Show information message.
         }
         else
-            statusBar()->showMessage("Error reading file. Please see console for more details");     // Show information message.
+            statusBar()->showMessage("A model is already loading.");     // Show information message.
     }
 
 }
 
+void MainWindow::modelLoaded(bool loaded)
+{
+    if ( loaded )
+    {
+        // The viewer owns the model, the render thread may still draw the previous one.
+        ui->glwidget->setModel( _modelLoader->takeModel(), _modelLoader->getClusters(),
+                                _modelLoader->getRayPicker(), _modelLoader->getLod(), _modelLoader->getEdges(),
+                                _modelLoader->getAdjacency() );
+        _model = ui->glwidget->getModel();
+        _modelPath = _modelLoader->getPath();
+
+        // Edits of an untitled list are journaled once there is a model to check them.
+        if ( !_bookmarkList->getJournal().isEmpty() )
+            _bookmarkList->setJournal(_bookmarkList->getJournal(), _modelPath, _model->numPoly(), true);
+        else if ( windowTitle() == "untitled.txt" )
+        {
+            recoverUntitledJournal();
+            reloadListWidget();
+        }
+        resetBookmarkLabels();
+
+        // Edge indices belong to the previous model.
+        for ( int i = 0; i < _bookmarkList->size(); ++i )
+            _bookmarkList->getAt(i)->clearOutline();
+        resetBookmarkOutlines();
+
+        statusBar()->showMessage("Model loaded.");     // Show information message.
+    }
+    else
+    {
+        ui->glwidget->clear();
+        _model = ui->glwidget->getModel();
+        statusBar()->showMessage("Error reading file. Please see console for more details");     // Show information message.
+    }
+}
+
 void MainWindow::closeModel()
 {
     closeBookmarksFile();
-    _model->clear();
     ui->glwidget->clear();
+    _model = ui->glwidget->getModel();
+    resetBookmarkLabels();
+    resetBookmarkOutlines();
 }
 
 /*
@@ -114,14 +190,22 @@ void MainWindow::openBookmarksFile()
 {
     if ( _model->isLoaded() )
     {
-        QString filename = QFileDialog::getOpenFileName(this, tr("Open"), QDir::homePath(), tr(".XML files (*.xml *.XML)"), 0);
+        QString filename = QFileDialog::getOpenFileName(this, tr("Open"), QDir::homePath(), tr("Bookmark files (*.xml *.XML *.3dmb)"), 0);
 
         if ( !filename.isNull() )
         {
             int errors = 0;
             int maxIndex = _model->numPoly() - 1;
 
-            _bookmarkList->open(filename, maxIndex, &errors);
+            if ( !_bookmarkList->open(filename, maxIndex, &errors) )
+            {
+                // Its journal is left for the next successful open.
+                QMessageBox msgBox;
+                msgBox.setText("Error reading bookmarks file.");
+                msgBox.exec();
+                clearBookmarkList();
+                return;
+            }
 
             // Alert if errors.
             if ( errors > 0 )
@@ -131,15 +215,13 @@ void MainWindow::openBookmarksFile()
                 msgBox.exec();
             }
 
-            // Reload list widget.
-            ui->listWidget->clear();
-
-            std::vector<Bookmark*>::const_iterator it = _bookmarkList->getList()->begin();
-            for ( ; it != _bookmarkList->getList()->end(); ++it )
-                ui->listWidget->addItem(new QListWidgetItem((*it)->getName()));
-
-            ui->listWidget->setCurrentRow(0);
+            recoverJournal(BookmarkList::journalPath(filename), BookmarkList::journalPath(filename));
+            reloadListWidget();
             setWindowTitle(filename);
+            resetBookmarkLabels();
+            resetBookmarkOutlines();
+            if ( _hoverAction->isChecked() )
+                showHoveredBookmarks(true);
         }
     }
     else
@@ -188,23 +270,48 @@ void MainWindow::saveBookmarksFile()
     }
     else
     {
-        _bookmarkList->save(this->windowTitle());    // Save
-        statusBar()->showMessage("File saved.");    // Show information message.
+        QStringList kept;
+        if ( _bookmarkList->save(this->windowTitle(), &kept) )  // Save
+            statusBar()->showMessage("File saved.");             // Show information message.
+        else
+            alertSaveError(kept);
     }
 }
 
 void MainWindow::saveAsBookmarksFile()
 {
-    QString filename = QFileDialog::getSaveFileName( this, tr("Save File As"), QDir::homePath(), tr(".XML files (*.xml)"), 0 );
+    QString binaryFilter = tr("Binary bookmark files (*.3dmb)");
+    QString filter;
+    QString filename = QFileDialog::getSaveFileName( this, tr("Save File As"), QDir::homePath(),
+                                                     tr(".XML files (*.xml)") + ";;" + binaryFilter, &filter );
 
     if( !filename.isNull() )
     {
-        _bookmarkList->save(filename);               // Save.
-        statusBar()->showMessage("File saved.");    // Show information message.
-        setWindowTitle(filename);                   // Set window title.
+        // The list saves binary files by suffix.
+        if ( filter == binaryFilter && QFileInfo(filename).suffix().compare(BookmarkList::BINARY_SUFFIX, Qt::CaseInsensitive) != 0 )
+            filename.append(".").append(BookmarkList::BINARY_SUFFIX);
+
+        QStringList kept;
+        if ( _bookmarkList->save(filename, &kept) )     // Save.
+        {
+            statusBar()->showMessage("File saved.");    // Show information message.
+            setWindowTitle(filename);                   // Set window title.
+        }
+        else
+            alertSaveError(kept);
     }
 }
 
+void MainWindow::alertSaveError(const QStringList &kept)
+{
+    QMessageBox msgBox;
+    if ( kept.isEmpty() )
+        msgBox.setText("Error writing bookmarks file. The previous file, if any, was kept.");
+    else
+        msgBox.setText("Error replacing bookmarks file. The new and previous versions were kept in " + kept.join(" and ") + ".");
+    msgBox.exec();
+}
+
 void MainWindow::viewAsPoints()
 {
     ui->glwidget->setRenderMode( POINTS );
@@ -225,6 +332,102 @@ void MainWindow::viewAsSolidWire()
     ui->glwidget->setRenderMode( SOLID_WIRE );
 }
 
+void MainWindow::showAllBookmarks(bool enabled)
+{
+    ui->glwidget->showAllBookmarks(enabled);
+    resetBookmarkLabels();
+}
+
+void MainWindow::resetBookmarkLabels()
+{
+    _bookmarkLabels->clear();
+    if ( _allBookmarksAction->isChecked() )
+        _bookmarkLabels->build(_bookmarkList, _model->numPoly());
+
+    ui->glwidget->setBookmarkLabels(_bookmarkLabels->getLabels());
+}
+
+void MainWindow::showSelectionOutline(bool enabled)
+{
+    ui->glwidget->showOutline(enabled);
+}
+
+void MainWindow::showAllOutlines(bool enabled)
+{
+    ui->glwidget->showAllOutlines(enabled);
+    resetBookmarkOutlines();
+}
+
+void MainWindow::resetBookmarkOutlines()
+{
+    // Bookmark 0 is the new bookmark entry.
+    QVector<FaceSelection> outlines;
+    if ( _allOutlinesAction->isChecked() )
+    {
+        for ( int i = 1; i < _bookmarkList->size(); ++i )
+        {
+            Bookmark *bookmark = _bookmarkList->getAt(i);
+            if ( !bookmark->hasOutline() )
+                bookmark->setOutline(ui->glwidget->outlineOf(*bookmark->getFaces()));
+            outlines.append(*bookmark->getOutline());
+        }
+    }
+
+    ui->glwidget->setBookmarkOutlines(outlines);
+}
+
+void MainWindow::showHoveredBookmarks(bool enabled)
+{
+    // Indexing decodes the bookmarks left in a binary file, done once here and not on the first hover.
+    if ( enabled && !_bookmarkList->isIndexed() )
+    {
+        statusBar()->showMessage("Indexing bookmarks...");
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        _bookmarkList->buildIndex();
+        QApplication::restoreOverrideCursor();
+        statusBar()->showMessage("Bookmarks indexed.");
+    }
+
+    ui->glwidget->enableHoverMode(enabled);
+    if ( !enabled )
+        QToolTip::hideText();
+}
+
+void MainWindow::faceHovered(int face, QPoint position)
+{
+    std::vector<Bookmark*> bookmarks;
+    if ( face >= 0 )
+        _bookmarkList->bookmarksAt(face, &bookmarks);
+
+    // The 'None' bookmark has no faces, it is never found.
+    QStringList names;
+    for ( unsigned int i = 0; i < bookmarks.size(); ++i )
+        names.append(bookmarks[i]->getName());
+
+    if ( names.isEmpty() )
+        QToolTip::hideText();
+    else
+        QToolTip::showText(ui->glwidget->mapToGlobal(position), names.join("\n"), ui->glwidget);
+}
+
+void MainWindow::showPerformanceOverlay(bool enabled)
+{
+    ui->glwidget->showStats(enabled);
+}
+
+void MainWindow::savePerformanceReport()
+{
+    QString filename = QFileDialog::getSaveFileName( this, tr("Save Performance Report"), QDir::homePath(), tr(".TXT files (*.txt)"), 0 );
+
+    if( !filename.isNull() )
+    {
+        if ( Profiler::instance()->save(filename) )
+            statusBar()->showMessage("Performance report saved.");     // Show information message.
+        else
+            statusBar()->showMessage("Error writing performance report.");
+    }
+}
+
 /*
  *  Section list panel methods.
  */
@@ -251,6 +454,7 @@ void MainWindow::showAddSectionPanel()
         // Configure panel
         ui->nameLineEdit->clear();
         ui->informationTextEdit->clear();
+        resetOperandList();
         ui->rightPanel->setCurrentIndex(1);
 
         // Configure cursor.
@@ -278,6 +482,7 @@ void MainWindow::showEditSectionPanel()
         Bookmark *current = _bookmarkList->getAt( ui->listWidget->currentRow() );
         ui->nameLineEdit->setText(current->getName());
         ui->informationTextEdit->setText(current->getComments());
+        resetOperandList();
         ui->rightPanel->setCurrentIndex(1);
     }
     else
@@ -344,7 +549,7 @@ void MainWindow::setRemoveSelectionMode()
 
 void MainWindow::saveBookmark()
 {
-    std::set<unsigned int> currentSelection = ui->glwidget->getCurrentSelection();
+    FaceSelection currentSelection = ui->glwidget->getCurrentSelection();
     QString name = ui->nameLineEdit->text();
     QString comments = ui->informationTextEdit->toPlainText();
 
@@ -394,24 +599,37 @@ void MainWindow::discardBookmark()
     }
 }
 
-void MainWindow::addBookmark(QString name, QString comments, std::set<unsigned int> selection)
+void MainWindow::addBookmark(QString name, QString comments, const FaceSelection &selection)
 {
     Bookmark *bookmark = new Bookmark(name, comments, selection);
+    bookmark->setOutline(ui->glwidget->getCurrentOutline());
 
     _bookmarkList->add(bookmark);
+    checkJournal();
     ui->listWidget->addItem(new QListWidgetItem(bookmark->getName()));
     ui->listWidget->setCurrentRow(_bookmarkList->size() - 1);
 
+    // Only the faces of the new bookmark change label.
+    _bookmarkLabels->updateBookmark(_bookmarkList, _bookmarkList->size() - 1, FaceSelection());
+    ui->glwidget->setBookmarkLabels(_bookmarkLabels->getLabels());
+    resetBookmarkOutlines();
+
     statusBar()->showMessage("Bookmark saved.");         // Show information message.
 }
 
-void MainWindow::updateBookmark(QString name, QString comments, std::set<unsigned int> selection)
+void MainWindow::updateBookmark(QString name, QString comments, const FaceSelection &selection)
 {
     // Update bookmark
     Bookmark *bookmark = _bookmarkList->getAt( ui->listWidget->currentRow() );
-    bookmark->setName(name);
-    bookmark->setComments(comments);
-    bookmark->setFaces(selection);
+    FaceSelection oldFaces = *bookmark->getFaces();
+    _bookmarkList->update(ui->listWidget->currentRow(), name, comments, selection);
+    checkJournal();
+    bookmark->setOutline(ui->glwidget->getCurrentOutline());
+
+    // Only the faces added or removed change label.
+    _bookmarkLabels->updateBookmark(_bookmarkList, ui->listWidget->currentRow(), oldFaces);
+    ui->glwidget->setBookmarkLabels(_bookmarkLabels->getLabels());
+    resetBookmarkOutlines();
 
     ui->listWidget->currentItem()->setText(name);       // Update widget.
     statusBar()->showMessage("Bookmark updated.");      // Show information message.
@@ -420,7 +638,10 @@ void MainWindow::updateBookmark(QString name, QString comments, std::set<unsigne
 void MainWindow::deleteCurrentBookmark()
 {
     _bookmarkList->deleteAt(ui->listWidget->currentRow());
+    checkJournal();
     qDeleteAll(ui->listWidget->selectedItems());
+    resetBookmarkLabels();      // Later bookmarks change index.
+    resetBookmarkOutlines();
 }
 
 void MainWindow::listWidgetItemClicked(QListWidgetItem *)
@@ -428,7 +649,10 @@ void MainWindow::listWidgetItemClicked(QListWidgetItem *)
     if ( ui->listWidget->currentRow() >= 0 )
     {
         Bookmark *bookmark = _bookmarkList->getAt( ui->listWidget->currentRow() );
-        ui->glwidget->setCurrentSelection(bookmark->getFaces());
+        if ( bookmark->hasOutline() )
+            ui->glwidget->setCurrentSelection(*bookmark->getFaces(), bookmark->getOutline());
+        else
+            ui->glwidget->setCurrentSelection(*bookmark->getFaces());
     }
 }
 
@@ -437,18 +661,258 @@ void MainWindow::clearBookmarkList()
     setWindowTitle("untitled.txt");
 
     _bookmarkList->clear();
+    if ( _model->isLoaded() )
+        _bookmarkList->setJournal(untitledJournal(), _modelPath, _model->numPoly());
+
+    reloadListWidget();
 
+    resetBookmarkLabels();
+    resetBookmarkOutlines();
+}
+
+void MainWindow::reloadListWidget()
+{
     ui->listWidget->clear();
-    ui->listWidget->addItem(new QListWidgetItem(_bookmarkList->getAt(0)->getName()));
+
+    std::vector<Bookmark*>::const_iterator it = _bookmarkList->getList()->begin();
+    for ( ; it != _bookmarkList->getList()->end(); ++it )
+        ui->listWidget->addItem(new QListWidgetItem((*it)->getName()));
+
     ui->listWidget->setCurrentRow(0);
 }
 
+void MainWindow::recoverJournal(QString path, QString target)
+{
+    unsigned int numFaces = _model->numPoly();
+    QString model;
+    unsigned int faces = 0;
+
+    if ( BookmarkJournal::isInUse(path) )
+    {
+        QMessageBox msgBox;
+        msgBox.setText("These bookmarks are open in another window. Their changes are journaled there.");
+        msgBox.exec();
+        return;
+    }
+
+    if ( BookmarkJournal::hasRecords(path, &model, &faces) )
+    {
+        if ( faces != numFaces )
+        {
+            // Face indices of another model are meaningless.
+            QString reason = QString("Unsaved bookmark changes made on another model (%1) were found. They were not recovered.").arg(model);
+            if ( !keepJournal(path, reason) && path == target )
+                return;
+        }
+        else
+        {
+            QMessageBox msgBox;
+            msgBox.setText("Unsaved bookmark changes of a previous session were found.");
+            if ( model != _modelPath )
+                msgBox.setInformativeText(QString("They were made on %1, with the same number of faces. Recover them?").arg(model));
+            else
+                msgBox.setInformativeText("Recover them?");
+            msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+            msgBox.setDefaultButton(QMessageBox::Yes);
+
+            if ( msgBox.exec() == QMessageBox::Yes )
+            {
+                int errors = 0;
+                bool complete = true;
+                int applied = _bookmarkList->recover(path, numFaces - 1, &errors, &complete);
+
+                // Alert if errors.
+                if ( errors > 0 )
+                {
+                    QMessageBox errorBox;
+                    errorBox.setText("Some recovered faces are not in this model. They will be omitted.");
+                    errorBox.exec();
+                }
+
+                // Edits after one that could not be applied are kept in the journal.
+                if ( !complete && !keepJournal(path, "Some bookmark changes could not be recovered.") && path == target )
+                    return;
+
+                // The recovered list is journaled as a whole, the file is not saved yet.
+                _bookmarkList->setJournal(target, _modelPath, numFaces, applied > 0);
+                if ( complete && path != target )
+                    QFile::remove(path);
+
+                statusBar()->showMessage("Bookmark changes recovered.");     // Show information message.
+                return;
+            }
+        }
+    }
+
+    // Changes not recovered are discarded.
+    if ( path != target )
+        QFile::remove(path);
+    _bookmarkList->setJournal(target, _modelPath, numFaces);
+}
+
+void MainWindow::recoverUntitledJournal()
+{
+    // Journals of other sessions that are not in use were left by a crash.
+    QDir home = QDir::home();
+    QStringList names = home.entryList(QStringList(".3dmarker-untitled-*.journal"), QDir::Files | QDir::Hidden);
+    for ( int i = 0; i < names.size(); ++i )
+    {
+        QString path = home.filePath(names[i]);
+        QString model;
+        unsigned int faces = 0;
+        if ( path == untitledJournal() || BookmarkJournal::isInUse(path) )
+            continue;
+
+        // Journals of other models wait for them.
+        if ( !BookmarkJournal::hasRecords(path, &model, &faces) )
+            QFile::remove(path);
+        else if ( faces == _model->numPoly() )
+        {
+            recoverJournal(path, untitledJournal());
+            return;
+        }
+    }
+
+    _bookmarkList->setJournal(untitledJournal(), _modelPath, _model->numPoly());
+}
+
+void MainWindow::checkJournal()
+{
+    if ( _bookmarkList->takeJournalError() )
+    {
+        QMessageBox msgBox;
+        msgBox.setText("Error writing the journal of bookmark changes. Later changes will be lost after a crash until the file is saved.");
+        msgBox.exec();
+    }
+}
+
+bool MainWindow::keepJournal(QString path, QString reason)
+{
+    QString aside = BookmarkJournal::setAside(path);
+
+    QMessageBox msgBox;
+    msgBox.setText(reason);
+    if ( aside.isEmpty() )
+        msgBox.setInformativeText("They were left in " + path + ".");
+    else
+        msgBox.setInformativeText("They were kept in " + aside + ".");
+    msgBox.exec();
+
+    return !aside.isEmpty();
+}
+
+QString MainWindow::untitledJournal()
+{
+    // One journal per session, other instances do not replace it.
+    static const QString path = QDir::homePath() + QString("/.3dmarker-untitled-%1-%2.journal")
+            .arg(QCoreApplication::applicationPid()).arg(QDateTime::currentMSecsSinceEpoch());
+    return path;
+}
+
 void MainWindow::setBrushSize(int size)
 {
     ui->glwidget->setPickSize(size);
     ui->brushSizeLabel->setText( QString().setNum(size) );
 }
 
+void MainWindow::setCircleBrush(bool enabled)
+{
+    ui->glwidget->setBrushShape( enabled ? CIRCLE_BRUSH : SQUARE_BRUSH );
+}
+
+void MainWindow::setVisibleOnly(bool enabled)
+{
+    ui->glwidget->setVisibleOnly(enabled);
+}
+
+void MainWindow::setSelectionTool(int index)
+{
+    // Tool combo items: brush, region by dihedral angle, region by seed normal, lasso, polygon, geodesic brush.
+    switch (index) {
+        case 1:
+        case 2:
+            ui->glwidget->setSelectionTool(REGION_TOOL);
+            ui->glwidget->setRegionCriterion(index == 1 ? DIHEDRAL_ANGLE : SEED_NORMAL);
+            break;
+        case 3:
+            ui->glwidget->setSelectionTool(LASSO_TOOL);
+            break;
+        case 4:
+            ui->glwidget->setSelectionTool(POLYGON_TOOL);
+            break;
+        case 5:
+            ui->glwidget->setSelectionTool(GEODESIC_TOOL);
+            break;
+        default:
+            ui->glwidget->setSelectionTool(BRUSH_TOOL);
+            break;
+    }
+}
+
+void MainWindow::setRegionAngle(int degrees)
+{
+    ui->glwidget->setRegionThreshold(degrees);
+    ui->regionAngleLabel->setText( QString().setNum(degrees) );
+}
+
+void MainWindow::resetOperandList()
+{
+    // Bookmark i of the list is item i - 1, 'None' is not listed.
+    ui->operandComboBox->clear();
+    for ( int i = 1; i < _bookmarkList->size(); ++i )
+        ui->operandComboBox->addItem(_bookmarkList->getAt(i)->getName());
+}
+
+void MainWindow::combineBookmark(SelectionOperation operation)
+{
+    int index = ui->operandComboBox->currentIndex() + 1;
+    if ( index < 1 || index >= _bookmarkList->size() )
+        return;
+
+    ui->glwidget->combineSelection(*_bookmarkList->getAt(index)->getFaces(), operation);
+}
+
+void MainWindow::uniteBookmark()
+{
+    combineBookmark(UNITE_SELECTION);
+}
+
+void MainWindow::intersectBookmark()
+{
+    combineBookmark(INTERSECT_SELECTION);
+}
+
+void MainWindow::subtractBookmark()
+{
+    combineBookmark(SUBTRACT_SELECTION);
+}
+
+void MainWindow::toggleBookmark()
+{
+    combineBookmark(TOGGLE_SELECTION);
+}
+
+void MainWindow::undoSelection()
+{
+    // Only strokes of the add/edit panels are undone.
+    if ( ui->rightPanel->currentIndex() == 1 )
+        ui->glwidget->undoSelection();
+}
+
+void MainWindow::redoSelection()
+{
+    if ( ui->rightPanel->currentIndex() == 1 )
+        ui->glwidget->redoSelection();
+}
+
+void MainWindow::selectionHistoryChanged(bool canUndo, bool canRedo)
+{
+    ui->undoButton->setEnabled(canUndo);
+    ui->redoButton->setEnabled(canRedo);
+    _undoAction->setEnabled(canUndo);
+    _redoAction->setEnabled(canRedo);
+}
+
 void MainWindow::viewerMode()
 {
     ui->glwidget->enableHitMode(false);
@@ -505,13 +969,13 @@ void MainWindow::nextQuestion()
     ui->errorLabel->setVisible(false);
 }
 
-void MainWindow::checkResponse(std::set<unsigned int> hits)
+void MainWindow::checkResponse(const FaceSelection &hits)
 {
-    std::set<unsigned int>* faces = _bookmarkList->getAt(_indexTest)->getFaces();
-    std::set<unsigned int>::const_iterator it;
+    Bookmark* bookmark = _bookmarkList->getAt(_indexTest);
+    FaceSelection::const_iterator it;
     for (it = hits.begin(); it != hits.end(); ++it)
     {
-        if (faces->find(*it) != faces->end())
+        if (_bookmarkList->contains(*it, bookmark))
         {
             ui->errorLabel->setVisible(false);
             ui->successLabel->setVisible(true);
@@ -4,13 +4,20 @@
 #include <algorithm>
 
 #include <QMainWindow>
+#include <QApplication>
 #include <QFileDialog>
+#include <QDateTime>
+#include <QDir>
 #include <QMessageBox>
 #include <QStatusBar>
 #include <QListWidgetItem>
 #include <QTime>
+#include <QToolTip>
+#include <QStringList>
 #include "glwidget.h"
 #include "bookmarklist.h"
+#include "modelloader.h"
+#include "bookmarklabels.h"
 
 namespace Ui {
 class MainWindow;
@@ -44,7 +51,15 @@ class MainWindow : public QMainWindow
 private:
     Ui::MainWindow *ui;             /**< User interface. */
     BookmarkList* _bookmarkList;     /**< Bookmark list. */
-    Model* _model;                   /**< 3D model. */
+    Model* _model;                   /**< 3D model, owned by the viewer. */
+    ModelLoader* _modelLoader;       /**< Loads models in a worker thread. */
+    QString _modelPath;              /**< File of the model loaded. */
+    BookmarkLabels* _bookmarkLabels; /**< Bookmark of each face, for the all bookmarks view. */
+    QAction* _allBookmarksAction;    /**< Menu action: Show all bookmarks. */
+    QAction* _allOutlinesAction;     /**< Menu action: Show all outlines. */
+    QAction* _hoverAction;           /**< Menu action: Show bookmarks under the mouse. */
+    QAction* _undoAction;            /**< Menu action: Undo stroke. */
+    QAction* _redoAction;            /**< Menu action: Redo stroke. */
     unsigned int _indexTest;        /**< Index of current question. */
 
     // Bookmarks management
@@ -55,7 +70,7 @@ private:
      * @param comments Comments of bookmark.
      * @param selection Face list of bookmark.
      */
-    void addBookmark(QString name, QString comments, std::set<unsigned int> selection);
+    void addBookmark(QString name, QString comments, const FaceSelection &selection);
 
     /**
      * @brief Update bookmark.
@@ -63,7 +78,7 @@ private:
      * @param comments Comments of bookmark.
      * @param selection Face list of bookmark.
      */
-    void updateBookmark(QString name, QString comments, std::set<unsigned int> selection);
+    void updateBookmark(QString name, QString comments, const FaceSelection &selection);
 
     /**
      * @brief Delete selected bookmark.
@@ -75,6 +90,74 @@ private:
      */
     void clearBookmarkList();
 
+    /**
+     * @brief Tell the user a bookmarks file could not be saved.
+     * @param kept Files holding the new and previous lists if neither is at the file path.
+     */
+    void alertSaveError(const QStringList &kept);
+
+    /**
+     * @brief Fill the list widget with the bookmark list.
+     */
+    void reloadListWidget();
+
+    /**
+     * @brief Offer to recover the edits of a journal left by a previous
+     * session, then journal the bookmark list. Journals of another model
+     * or that could not be replayed are renamed aside, never replaced.
+     * @param path Journal file to recover.
+     * @param target Journal file of the bookmark list, may be path.
+     */
+    void recoverJournal(QString path, QString target);
+
+    /**
+     * @brief Offer to recover the journal of an untitled list left by a
+     * crashed session on the same model, then journal the bookmark list.
+     */
+    void recoverUntitledJournal();
+
+    /**
+     * @brief Tell the user if the journal of the bookmark list stopped after a write error.
+     */
+    void checkJournal();
+
+    /**
+     * @brief Rename aside a journal that is not recovered and tell the user.
+     * @param path Journal file.
+     * @param reason Why the journal is not recovered.
+     * @return True if renamed, false if it is left in place.
+     */
+    bool keepJournal(QString path, QString reason);
+
+    /**
+     * @brief Return the journal file of untitled bookmark lists of this session.
+     * @return Journal file in the home directory.
+     */
+    static QString untitledJournal();
+
+    /**
+     * @brief Relabel all faces after the bookmark list or the model changed.
+     * Labels are only built while all bookmarks are shown.
+     */
+    void resetBookmarkLabels();
+
+    /**
+     * @brief Send the bookmark outlines to the viewer, computing the ones not cached.
+     * Outlines are only sent while all outlines are shown.
+     */
+    void resetBookmarkOutlines();
+
+    /**
+     * @brief Fill the bookmarks that can be combined with the selection.
+     */
+    void resetOperandList();
+
+    /**
+     * @brief Combine the bookmark chosen in the operand list with the selection.
+     * @param operation How the bookmark is combined.
+     */
+    void combineBookmark(SelectionOperation operation);
+
 public:
 
     /**
@@ -92,6 +175,7 @@ public slots:
 
     void openModel();   /**< Menu action: Open model. */
     void closeModel();  /**< Menu action: Close model. */
+    void modelLoaded(bool loaded);  /**< Model loader: load finished. */
 
     void openBookmarksFile();   /**< Menu action: Open bookmarks file. */
     void closeBookmarksFile();  /**< Menu action: Close bookmarks file. */
@@ -102,6 +186,12 @@ public slots:
     void viewAsWired();         /**< Menu action: View as wired. */
     void viewAsSolid();         /**< Menu action: View as solid. */
     void viewAsSolidWire();     /**< Menu action: View as solid + wired. */
+    void showAllBookmarks(bool enabled);      /**< Menu action: Color faces by bookmark. */
+    void showSelectionOutline(bool enabled);  /**< Menu action: Draw the selection as an outline. */
+    void showAllOutlines(bool enabled);       /**< Menu action: Draw the outline of every bookmark. */
+    void showHoveredBookmarks(bool enabled);  /**< Menu action: Show the bookmarks of the face under the mouse. */
+    void showPerformanceOverlay(bool enabled); /**< Menu action: Show performance overlay. */
+    void savePerformanceReport();   /**< Menu action: Save performance report. */
 
     void viewerMode();           /**< Menu action: Set viewer mode. */
     void editorMode();           /**< Menu action: Set editor mode. */
@@ -112,6 +202,18 @@ public slots:
     void saveBookmark();            /**< Button action: Save current bookmark. */
     void discardBookmark();         /**< Button action: Discard current bookmark. */
     void setBrushSize(int size);    /**< Slider action: Set brush size. */
+    void setCircleBrush(bool enabled); /**< Check action: Set round or square brush. */
+    void setVisibleOnly(bool enabled); /**< Check action: Pick only visible faces. */
+    void setSelectionTool(int index);  /**< Combo action: Set selection tool. */
+    void setRegionAngle(int degrees);  /**< Slider action: Set maximum angle of regions. */
+    void uniteBookmark();           /**< Button action: Add the faces of a bookmark. */
+    void intersectBookmark();       /**< Button action: Keep only the faces of a bookmark. */
+    void subtractBookmark();        /**< Button action: Remove the faces of a bookmark. */
+    void toggleBookmark();          /**< Button action: Toggle the faces of a bookmark. */
+    void undoSelection();           /**< Button action: Undo last stroke. */
+    void redoSelection();           /**< Button action: Redo last stroke undone. */
+    void selectionHistoryChanged(bool canUndo, bool canRedo); /**< Viewer: Undo steps changed. */
+    void faceHovered(int face, QPoint position);    /**< Viewer: Face under the mouse changed. */
 
     void showListPanel();           /**< Button action: Show bookmark list panel. */
     void showAddSectionPanel();     /**< Button action: Show new bookmark panel. */
@@ -121,7 +223,7 @@ public slots:
     void deleteCurrentSection();    /**< Button action: Delete selected bookmark. */
 
     void nextQuestion();            /**< Button action: Generate a new question. */
-    void checkResponse(std::set<unsigned int> hits);   /**< Test: User response. */
+    void checkResponse(const FaceSelection &hits);   /**< Test: User response. */
 
     void listWidgetItemClicked(QListWidgetItem *);  /**< Bookmark click action. */
 
@@ -0,0 +1,357 @@
+#include "meshclusters.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include "parallel.h"
+
+/**
+ * @brief Spread the 10 lower bits of a value, two zeros between bits.
+ */
+static unsigned int expandBits(unsigned int value)
+{
+    value &= 0x3ff;
+    value = (value | (value << 16)) & 0x030000ff;
+    value = (value | (value << 8)) & 0x0300f00f;
+    value = (value | (value << 4)) & 0x030c30c3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+}
+
+/**
+ * @brief Compute a sort key per face: Morton code of centroid (high) and face index (low).
+ */
+struct MortonKernel
+{
+    Model *model;
+    float min[3];
+    float scale[3];
+    unsigned long long *keys;
+
+    void operator()(const ParallelRange &range) const
+    {
+        for ( unsigned int i = range.begin; i < range.end; ++i )
+        {
+            Poly *poly = model->getPolyAt(i);
+            float centroid[3] = { 0.0f, 0.0f, 0.0f };
+            for ( int j = 0; j < poly->size(); ++j )
+            {
+                Vertex *vertex = model->getVertexAt(poly->getAt(j));
+                centroid[0] += vertex->getX();
+                centroid[1] += vertex->getY();
+                centroid[2] += vertex->getZ();
+            }
+
+            unsigned int code = 0;
+            for ( int k = 0; k < 3; ++k )
+            {
+                float value = poly->size() > 0 ? centroid[k] / poly->size() : min[k];
+                int cell = (int)((value - min[k]) * scale[k]);
+                code |= expandBits(std::max(0, std::min(1023, cell))) << k;
+            }
+
+            keys[i] = ((unsigned long long)code << 32) | i;
+        }
+    }
+};
+
+/**
+ * @brief Compute bounding sphere and normal cone of each cluster.
+ */
+template <typename Cluster>
+struct BoundsKernel
+{
+    Model *model;
+    const unsigned int *faces;
+    unsigned int numFaces;
+    Cluster *clusters;
+
+    void operator()(const ParallelRange &range) const
+    {
+        for ( unsigned int c = range.begin; c < range.end; ++c )
+        {
+            Cluster &cluster = clusters[c];
+            unsigned int first = c * MeshClusters::CLUSTER_SIZE;
+            unsigned int last = std::min(numFaces, first + MeshClusters::CLUSTER_SIZE);
+
+            float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+            float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            float axis[3] = { 0.0f, 0.0f, 0.0f };
+
+            for ( unsigned int i = first; i < last; ++i )
+            {
+                Poly *poly = model->getPolyAt(faces[i]);
+                for ( int j = 0; j < poly->size(); ++j )
+                {
+                    Vertex *vertex = model->getVertexAt(poly->getAt(j));
+                    float p[3] = { vertex->getX(), vertex->getY(), vertex->getZ() };
+                    for ( int k = 0; k < 3; ++k )
+                    {
+                        min[k] = std::min(min[k], p[k]);
+                        max[k] = std::max(max[k], p[k]);
+                    }
+                }
+
+                float normal[3];
+                if ( faceNormal(poly, normal, false) )
+                    for ( int k = 0; k < 3; ++k )
+                        axis[k] += normal[k];
+            }
+
+            // Bounding sphere.
+            for ( int k = 0; k < 3; ++k )
+                cluster.center[k] = (min[k] + max[k]) / 2.0f;
+
+            float radius = 0.0f;
+            for ( unsigned int i = first; i < last; ++i )
+            {
+                Poly *poly = model->getPolyAt(faces[i]);
+                for ( int j = 0; j < poly->size(); ++j )
+                {
+                    Vertex *vertex = model->getVertexAt(poly->getAt(j));
+                    float dx = vertex->getX() - cluster.center[0];
+                    float dy = vertex->getY() - cluster.center[1];
+                    float dz = vertex->getZ() - cluster.center[2];
+                    radius = std::max(radius, dx*dx + dy*dy + dz*dz);
+                }
+            }
+            cluster.radius = sqrt(radius);
+
+            // Normal cone: area weighted mean normal and widest deviation from it.
+            cluster.sinAngle = 2.0f;
+            float length = sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+            if ( length <= 0.0f )
+                continue;
+
+            float minCos = 1.0f;
+            for ( int k = 0; k < 3; ++k )
+                cluster.axis[k] = axis[k] / length;
+
+            for ( unsigned int i = first; i < last && minCos > 0.0f; ++i )
+            {
+                float normal[3];
+                if ( faceNormal(model->getPolyAt(faces[i]), normal, true) )
+                    minCos = std::min(minCos, normal[0]*cluster.axis[0] + normal[1]*cluster.axis[1] + normal[2]*cluster.axis[2]);
+            }
+
+            if ( minCos > 0.0f )
+                cluster.sinAngle = sqrt(1.0f - minCos*minCos);
+        }
+    }
+
+    /**
+     * @brief Face normal (from the first three vertices, as Model::computeNormals).
+     * @return False if face is degenerate.
+     */
+    bool faceNormal(Poly *poly, float normal[3], bool normalize) const
+    {
+        if ( poly->size() < 3 )
+            return false;
+
+        Vertex *v1 = model->getVertexAt(poly->getAt(0));
+        Vertex *v2 = model->getVertexAt(poly->getAt(1));
+        Vertex *v3 = model->getVertexAt(poly->getAt(2));
+        float p[3] = { v2->getX() - v1->getX(), v2->getY() - v1->getY(), v2->getZ() - v1->getZ() };
+        float q[3] = { v3->getX() - v1->getX(), v3->getY() - v1->getY(), v3->getZ() - v1->getZ() };
+        normal[0] = p[1]*q[2] - p[2]*q[1];
+        normal[1] = p[2]*q[0] - p[0]*q[2];
+        normal[2] = p[0]*q[1] - p[1]*q[0];
+
+        float length = sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+        if ( length <= 0.0f )
+            return false;
+
+        if ( normalize )
+            for ( int k = 0; k < 3; ++k )
+                normal[k] /= length;
+
+        return true;
+    }
+};
+
+/**
+ * @brief Test clusters against the view frustum and the eye position.
+ */
+template <typename Cluster>
+struct CullKernel
+{
+    const Cluster *clusters;
+    float planes[6][4];
+    float eye[3];
+    bool cullBackFaces;
+    unsigned char *visible;
+    unsigned int *counts;
+
+    void operator()(const ParallelRange &range) const
+    {
+        unsigned int count = 0;
+        for ( unsigned int c = range.begin; c < range.end; ++c )
+        {
+            const Cluster &cluster = clusters[c];
+            bool inside = true;
+
+            for ( int p = 0; p < 6 && inside; ++p )
+            {
+                float distance = planes[p][0]*cluster.center[0] + planes[p][1]*cluster.center[1]
+                               + planes[p][2]*cluster.center[2] + planes[p][3];
+                if ( distance < -cluster.radius )
+                    inside = false;
+            }
+
+            // All faces are back-facing if every view ray into the sphere is
+            // closer than (90 - cone angle) degrees to the cone axis.
+            if ( inside && cullBackFaces && cluster.sinAngle <= 1.0f )
+            {
+                float d[3] = { cluster.center[0] - eye[0], cluster.center[1] - eye[1], cluster.center[2] - eye[2] };
+                float length = sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+                float projection = d[0]*cluster.axis[0] + d[1]*cluster.axis[1] + d[2]*cluster.axis[2];
+                if ( projection >= cluster.sinAngle * length + cluster.radius * (1.0f + cluster.sinAngle) )
+                    inside = false;
+            }
+
+            visible[c] = inside ? 1 : 0;
+            if ( inside )
+                ++count;
+        }
+
+        counts[range.index] = count;
+    }
+};
+
+MeshClusters::MeshClusters()
+{
+    clear();
+}
+
+void MeshClusters::clear()
+{
+    _faces.clear();
+    _clusters.clear();
+}
+
+void MeshClusters::swap(MeshClusters &other)
+{
+    _faces.swap(other._faces);
+    _clusters.swap(other._clusters);
+}
+
+unsigned int MeshClusters::size() const
+{
+    return _clusters.size();
+}
+
+unsigned int MeshClusters::numFaces() const
+{
+    return _faces.size();
+}
+
+unsigned int MeshClusters::getFace(unsigned int index) const
+{
+    return _faces[index];
+}
+
+unsigned int MeshClusters::clusterOf(unsigned int index) const
+{
+    return index / CLUSTER_SIZE;
+}
+
+unsigned int MeshClusters::firstFace(unsigned int cluster) const
+{
+    return cluster * CLUSTER_SIZE;
+}
+
+unsigned int MeshClusters::clusterSize(unsigned int cluster) const
+{
+    return std::min((unsigned int)CLUSTER_SIZE, (unsigned int)_faces.size() - cluster * CLUSTER_SIZE);
+}
+
+void MeshClusters::build(Model *model)
+{
+    clear();
+
+    unsigned int numFaces = model->numPoly();
+    if ( numFaces == 0 )
+        return;
+
+    // Model bounds.
+    float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for ( unsigned int i = 0; i < model->numVertex(); ++i )
+    {
+        Vertex *vertex = model->getVertexAt(i);
+        float p[3] = { vertex->getX(), vertex->getY(), vertex->getZ() };
+        for ( int k = 0; k < 3; ++k )
+        {
+            min[k] = std::min(min[k], p[k]);
+            max[k] = std::max(max[k], p[k]);
+        }
+    }
+
+    // Sort faces along the Morton curve.
+    std::vector<unsigned long long> keys(numFaces);
+    MortonKernel morton;
+    morton.model = model;
+    for ( int k = 0; k < 3; ++k )
+    {
+        morton.min[k] = min[k];
+        morton.scale[k] = (max[k] > min[k]) ? 1023.0f / (max[k] - min[k]) : 0.0f;
+    }
+    morton.keys = &keys[0];
+    parallelFor(numFaces, morton);
+
+    std::sort(keys.begin(), keys.end());
+
+    _faces.resize(numFaces);
+    for ( unsigned int i = 0; i < numFaces; ++i )
+        _faces[i] = (unsigned int)(keys[i] & 0xffffffff);
+
+    // Cluster bounds.
+    _clusters.resize((numFaces + CLUSTER_SIZE - 1) / CLUSTER_SIZE);
+    BoundsKernel<Cluster> bounds;
+    bounds.model = model;
+    bounds.faces = &_faces[0];
+    bounds.numFaces = numFaces;
+    bounds.clusters = &_clusters[0];
+    parallelFor(_clusters.size(), bounds, 64);
+}
+
+unsigned int MeshClusters::cull(const Camera &camera, bool cullBackFaces, std::vector<unsigned char> *visible) const
+{
+    visible->resize(_clusters.size());
+    if ( _clusters.empty() )
+        return 0;
+
+    CullKernel<Cluster> kernel;
+    kernel.clusters = &_clusters[0];
+    kernel.cullBackFaces = cullBackFaces;
+    kernel.visible = &(*visible)[0];
+    camera.getEye(kernel.eye);
+
+    // Frustum planes from the rows of the projection * modelview matrix.
+    float m[16];
+    camera.getModelViewProjectionMatrix(m);
+    for ( int p = 0; p < 6; ++p )
+    {
+        int row = p / 2;
+        float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+        for ( int k = 0; k < 4; ++k )
+            kernel.planes[p][k] = m[k*4 + 3] + sign * m[k*4 + row];
+
+        float length = sqrt(kernel.planes[p][0]*kernel.planes[p][0] + kernel.planes[p][1]*kernel.planes[p][1]
+                            + kernel.planes[p][2]*kernel.planes[p][2]);
+        if ( length > 0.0f )
+            for ( int k = 0; k < 4; ++k )
+                kernel.planes[p][k] /= length;
+    }
+
+    std::vector<ParallelRange> ranges = parallelRanges(_clusters.size(), 1024);
+    std::vector<unsigned int> counts(ranges.size(), 0);
+    kernel.counts = &counts[0];
+    parallelMap(ranges, kernel);
+
+    unsigned int count = 0;
+    for ( unsigned int i = 0; i < counts.size(); ++i )
+        count += counts[i];
+
+    return count;
+}
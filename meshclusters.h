@@ -0,0 +1,128 @@
+#ifndef MESHCLUSTERS_H
+#define MESHCLUSTERS_H
+
+#include <vector>
+#include "model.h"
+#include "camera.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The MeshClusters class partitions the model faces in small spatial
+ * clusters. Faces are sorted along a Morton curve of their centroids and
+ * cut in runs of CLUSTER_SIZE faces. Each cluster keeps a bounding sphere
+ * and a normal cone, so clusters outside the view frustum or completely
+ * back-facing can be skipped before drawing or picking.
+ */
+class MeshClusters
+{
+private:
+
+    /**
+     * @brief Cluster bounds.
+     */
+    struct Cluster
+    {
+        float center[3];        /**< Bounding sphere center. */
+        float radius;           /**< Bounding sphere radius. */
+        float axis[3];          /**< Normal cone axis. */
+        float sinAngle;         /**< Sine of the normal cone half angle, > 1 if cone is not valid. */
+    };
+
+    std::vector<unsigned int> _faces;    /**< Face indices sorted by cluster. */
+    std::vector<Cluster> _clusters;      /**< Cluster list. */
+
+public:
+
+    static const unsigned int CLUSTER_SIZE = 256;   /**< Faces per cluster. */
+
+    /**
+     * @brief Default constructor.
+     */
+    MeshClusters();
+
+    /**
+     * @brief Build the clusters of a model. Runs in parallel.
+     * @param model Model to partition.
+     */
+    void build(Model *model);
+
+    /**
+     * @brief Clear the clusters.
+     */
+    void clear();
+
+    /**
+     * @brief Exchange the clusters with another instance.
+     * @param other Clusters to exchange with.
+     */
+    void swap(MeshClusters &other);
+
+    /**
+     * @brief Return number of clusters.
+     * @return Number of clusters.
+     */
+    unsigned int size() const;
+
+    /**
+     * @brief Return number of faces.
+     * @return Number of faces.
+     */
+    unsigned int numFaces() const;
+
+    /**
+     * @brief Return face at position index of the cluster order.
+     * @param index Position in cluster order.
+     * @return Face index.
+     */
+    unsigned int getFace(unsigned int index) const;
+
+    /**
+     * @brief Return cluster of a position of the cluster order.
+     * @param index Position in cluster order.
+     * @return Cluster index.
+     */
+    unsigned int clusterOf(unsigned int index) const;
+
+    /**
+     * @brief Return first position of a cluster in the cluster order.
+     * @param cluster Cluster index.
+     * @return First position.
+     */
+    unsigned int firstFace(unsigned int cluster) const;
+
+    /**
+     * @brief Return number of faces of a cluster.
+     * @param cluster Cluster index.
+     * @return Number of faces.
+     */
+    unsigned int clusterSize(unsigned int cluster) const;
+
+    /**
+     * @brief Compute which clusters can be seen by a camera. Runs in parallel.
+     * @param camera Viewer camera.
+     * @param cullBackFaces True to skip clusters whose faces are all back-facing.
+     * @param visible Result, one flag per cluster.
+     * @return Number of visible clusters.
+     */
+    unsigned int cull(const Camera &camera, bool cullBackFaces, std::vector<unsigned char> *visible) const;
+
+};
+
+#endif // MESHCLUSTERS_H
@@ -0,0 +1,363 @@
+#include "meshedges.h"
+
+#include <algorithm>
+#include <QGLWidget>
+#include "parallel.h"
+
+/**
+ * @brief Face edge: vertex pair key, (min << 32) | max, and its face.
+ */
+struct FaceEdge
+{
+    unsigned long long key;
+    unsigned int face;
+
+    bool operator<(const FaceEdge &other) const
+    {
+        return key < other.key || (key == other.key && face < other.face);
+    }
+};
+
+/**
+ * @brief Emit the edges of each face.
+ */
+struct FaceEdgeKernel
+{
+    Model *model;
+    const unsigned int *faceFirst;
+    FaceEdge *edges;
+
+    void operator()(const ParallelRange &range) const
+    {
+        for ( unsigned int f = range.begin; f < range.end; ++f )
+        {
+            Poly *poly = model->getPolyAt(f);
+            FaceEdge *out = edges + faceFirst[f];
+            for ( int j = 0; j < poly->size(); ++j )
+            {
+                unsigned long long a = poly->getAt(j);
+                unsigned long long b = poly->getAt((j + 1) % poly->size());
+                out[j].key = (a < b) ? (a << 32) | b : (b << 32) | a;
+                out[j].face = f;
+            }
+        }
+    }
+};
+
+/**
+ * @brief Collect the boundary edges of a range of faces of a set.
+ */
+struct BoundaryKernel
+{
+    const MeshEdges *edges;
+    const FaceSelection *faces;
+    const unsigned int *faceList;
+    const unsigned int *faceFirst;
+    const unsigned int *faceEdges;
+    std::vector<unsigned int> *results;
+
+    void operator()(const ParallelRange &range) const
+    {
+        // Each boundary edge has a single face in the set, it is found once.
+        std::vector<unsigned int> &result = results[range.index];
+        for ( unsigned int i = range.begin; i < range.end; ++i )
+        {
+            unsigned int face = faceList[i];
+            for ( unsigned int j = faceFirst[face]; j < faceFirst[face + 1]; ++j )
+                if ( edges->isBoundary(faceEdges[j], *faces) )
+                    result.push_back(faceEdges[j]);
+        }
+    }
+};
+
+/**
+ * @brief Copy vertex positions and normals in flat arrays.
+ */
+struct EdgeVertexKernel
+{
+    Model *model;
+    float *positions;
+    float *normals;
+
+    void operator()(const ParallelRange &range) const
+    {
+        for ( unsigned int i = range.begin; i < range.end; ++i )
+        {
+            Vertex *vertex = model->getVertexAt(i);
+            positions[3*i] = vertex->getX();
+            positions[3*i + 1] = vertex->getY();
+            positions[3*i + 2] = vertex->getZ();
+            normals[3*i] = vertex->getNormalX();
+            normals[3*i + 1] = vertex->getNormalY();
+            normals[3*i + 2] = vertex->getNormalZ();
+        }
+    }
+};
+
+MeshEdges::MeshEdges()
+{
+}
+
+void MeshEdges::clear()
+{
+    _positions.clear();
+    _normals.clear();
+    _vertices.clear();
+    _faces.clear();
+    _clusterFirst.clear();
+    _faceFirst.clear();
+    _faceEdges.clear();
+}
+
+void MeshEdges::swap(MeshEdges &other)
+{
+    _positions.swap(other._positions);
+    _normals.swap(other._normals);
+    _vertices.swap(other._vertices);
+    _faces.swap(other._faces);
+    _clusterFirst.swap(other._clusterFirst);
+    _faceFirst.swap(other._faceFirst);
+    _faceEdges.swap(other._faceEdges);
+}
+
+unsigned int MeshEdges::size() const
+{
+    return _vertices.size() / 2;
+}
+
+unsigned int MeshEdges::getVertex(unsigned int edge, unsigned int end) const
+{
+    return _vertices[2*edge + end];
+}
+
+unsigned int MeshEdges::getFace(unsigned int edge, unsigned int side) const
+{
+    return _faces[2*edge + side];
+}
+
+unsigned int MeshEdges::firstEdge(unsigned int cluster) const
+{
+    return _clusterFirst[cluster];
+}
+
+unsigned int MeshEdges::clusterEdges(unsigned int cluster) const
+{
+    return _clusterFirst[cluster + 1] - _clusterFirst[cluster];
+}
+
+void MeshEdges::build(Model *model, const MeshClusters &clusters)
+{
+    clear();
+
+    unsigned int numFaces = model->numPoly();
+    unsigned int numClusters = clusters.size();
+    if ( numFaces == 0 || clusters.numFaces() != numFaces )
+        return;
+
+    // One face edge per polygon side.
+    std::vector<unsigned int> faceFirst(numFaces + 1);
+    faceFirst[0] = 0;
+    for ( unsigned int f = 0; f < numFaces; ++f )
+        faceFirst[f + 1] = faceFirst[f] + model->getPolyAt(f)->size();
+
+    std::vector<FaceEdge> faceEdges(faceFirst[numFaces]);
+    if ( faceEdges.empty() )
+        return;
+
+    FaceEdgeKernel faceKernel;
+    faceKernel.model = model;
+    faceKernel.faceFirst = &faceFirst[0];
+    faceKernel.edges = &faceEdges[0];
+    parallelFor(numFaces, faceKernel);
+
+    // Shared edges end up together, lowest face first.
+    parallelSort(faceEdges);
+
+    std::vector<unsigned int> faceCluster(numFaces);
+    for ( unsigned int i = 0; i < numFaces; ++i )
+        faceCluster[clusters.getFace(i)] = clusters.clusterOf(i);
+
+    // Unique edges, counted per cluster of their first face.
+    std::vector<unsigned int> unique;
+    _clusterFirst.assign(numClusters + 1, 0);
+    for ( unsigned int i = 0; i < faceEdges.size(); ++i )
+    {
+        unsigned long long key = faceEdges[i].key;
+        if ( (key >> 32) == (key & 0xffffffff) || (i > 0 && key == faceEdges[i - 1].key) )
+            continue;
+        unique.push_back(i);
+        _clusterFirst[faceCluster[faceEdges[i].face] + 1]++;
+    }
+
+    for ( unsigned int c = 0; c < numClusters; ++c )
+        _clusterFirst[c + 1] += _clusterFirst[c];
+
+    _vertices.resize(2 * unique.size());
+    _faces.resize(2 * unique.size());
+    std::vector<unsigned int> next(_clusterFirst.begin(), _clusterFirst.end() - 1);
+    for ( unsigned int u = 0; u < unique.size(); ++u )
+    {
+        const FaceEdge &edge = faceEdges[unique[u]];
+        unsigned int e = next[faceCluster[edge.face]]++;
+        _vertices[2*e] = (unsigned int)(edge.key >> 32);
+        _vertices[2*e + 1] = (unsigned int)(edge.key & 0xffffffff);
+
+        // Second face: first different face sharing the key.
+        _faces[2*e] = edge.face;
+        _faces[2*e + 1] = NO_FACE;
+        for ( unsigned int i = unique[u] + 1; i < faceEdges.size() && faceEdges[i].key == edge.key; ++i )
+        {
+            if ( faceEdges[i].face != edge.face )
+            {
+                _faces[2*e + 1] = faceEdges[i].face;
+                break;
+            }
+        }
+    }
+
+    // Edges of each face, for boundaries.
+    _faceFirst.assign(numFaces + 1, 0);
+    for ( unsigned int i = 0; i < _faces.size(); ++i )
+        if ( _faces[i] != NO_FACE )
+            _faceFirst[_faces[i] + 1]++;
+
+    for ( unsigned int f = 0; f < numFaces; ++f )
+        _faceFirst[f + 1] += _faceFirst[f];
+
+    _faceEdges.resize(_faceFirst[numFaces]);
+    next.assign(_faceFirst.begin(), _faceFirst.end() - 1);
+    for ( unsigned int i = 0; i < _faces.size(); ++i )
+        if ( _faces[i] != NO_FACE )
+            _faceEdges[next[_faces[i]]++] = i / 2;
+
+    // Vertex arrays drawn with the edge indices.
+    _positions.resize(3 * model->numVertex());
+    _normals.resize(3 * model->numVertex());
+    if ( !_positions.empty() )
+    {
+        EdgeVertexKernel vertices;
+        vertices.model = model;
+        vertices.positions = &_positions[0];
+        vertices.normals = &_normals[0];
+        parallelFor(model->numVertex(), vertices);
+    }
+}
+
+void MeshEdges::draw(const std::vector<unsigned char> &visible) const
+{
+    if ( _vertices.empty() )
+        return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, &_positions[0]);
+    glNormalPointer(GL_FLOAT, 0, &_normals[0]);
+
+    unsigned int numClusters = std::min(visible.size(), _clusterFirst.size() - 1);
+    unsigned int c = 0;
+    while ( c < numClusters )
+    {
+        if ( !visible[c] )
+        {
+            ++c;
+            continue;
+        }
+
+        // Run of visible clusters, their edges are contiguous.
+        unsigned int first = c;
+        while ( c < numClusters && visible[c] )
+            ++c;
+
+        unsigned int count = _clusterFirst[c] - _clusterFirst[first];
+        if ( count > 0 )
+            glDrawElements(GL_LINES, 2 * count, GL_UNSIGNED_INT, &_vertices[2 * _clusterFirst[first]]);
+    }
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+bool MeshEdges::isBoundary(unsigned int edge, const FaceSelection &faces) const
+{
+    unsigned int second = _faces[2*edge + 1];
+    bool first = faces.contains(_faces[2*edge]);
+    return first != (second != NO_FACE && faces.contains(second));
+}
+
+void MeshEdges::boundary(const FaceSelection &faces, FaceSelection *edges) const
+{
+    edges->clear();
+    if ( faces.isEmpty() || _faceFirst.empty() )
+        return;
+
+    std::vector<unsigned int> faceList;
+    faces.toVector(&faceList);
+    while ( !faceList.empty() && faceList.back() + 1 >= _faceFirst.size() )
+        faceList.pop_back();
+    if ( faceList.empty() )
+        return;
+
+    std::vector<ParallelRange> ranges = parallelRanges(faceList.size());
+    std::vector< std::vector<unsigned int> > results(ranges.size());
+
+    BoundaryKernel kernel;
+    kernel.edges = this;
+    kernel.faces = &faces;
+    kernel.faceList = &faceList[0];
+    kernel.faceFirst = &_faceFirst[0];
+    kernel.faceEdges = _faceEdges.empty() ? 0 : &_faceEdges[0];
+    kernel.results = &results[0];
+    parallelMap(ranges, kernel);
+
+    std::vector<unsigned int> found;
+    for ( unsigned int r = 0; r < results.size(); ++r )
+        found.insert(found.end(), results[r].begin(), results[r].end());
+
+    parallelSort(found);
+    edges->insert(found);
+}
+
+void MeshEdges::updateBoundary(const FaceSelection &faces, const FaceSelection &changed, FaceSelection *edges) const
+{
+    // Only edges of changed faces can change side.
+    std::vector<unsigned int> inside, outside;
+    FaceSelection::const_iterator it = changed.begin();
+    for ( ; it != changed.end() && *it + 1 < _faceFirst.size(); ++it )
+    {
+        for ( unsigned int j = _faceFirst[*it]; j < _faceFirst[*it + 1]; ++j )
+        {
+            if ( isBoundary(_faceEdges[j], faces) )
+                inside.push_back(_faceEdges[j]);
+            else
+                outside.push_back(_faceEdges[j]);
+        }
+    }
+
+    std::sort(inside.begin(), inside.end());
+    std::sort(outside.begin(), outside.end());
+    edges->remove(outside);
+    edges->insert(inside);
+}
+
+void MeshEdges::drawEdges(const FaceSelection &edges) const
+{
+    if ( _vertices.empty() || edges.isEmpty() )
+        return;
+
+    std::vector<unsigned int> indices;
+    indices.reserve(2 * edges.size());
+    FaceSelection::const_iterator it = edges.begin();
+    for ( ; it != edges.end() && *it < size(); ++it )
+    {
+        indices.push_back(_vertices[2 * *it]);
+        indices.push_back(_vertices[2 * *it + 1]);
+    }
+
+    if ( indices.empty() )
+        return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, &_positions[0]);
+    glDrawElements(GL_LINES, indices.size(), GL_UNSIGNED_INT, &indices[0]);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
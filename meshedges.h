@@ -0,0 +1,153 @@
+#ifndef MESHEDGES_H
+#define MESHEDGES_H
+
+#include <vector>
+#include "model.h"
+#include "meshclusters.h"
+#include "faceselection.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The MeshEdges class keeps the unique edges of a model, so wire modes
+ * draw each edge once instead of once per adjacent face. Face edges are
+ * keyed by their (min, max) vertex pair, sorted in parallel and merged.
+ * Edges are grouped by the cluster of their first face, so culled
+ * clusters skip their edges too, and each edge keeps its two faces.
+ *
+ * The boundary of a face set is the set of edges with exactly one face
+ * in it. Edge sets are stored in a FaceSelection, used as a compressed
+ * set of edge indices.
+ */
+class MeshEdges
+{
+private:
+
+    std::vector<float> _positions;           /**< Model vertex positions (x, y, z). */
+    std::vector<float> _normals;             /**< Model vertex normals (x, y, z). */
+    std::vector<unsigned int> _vertices;     /**< Two vertex indices per edge, sorted by cluster. */
+    std::vector<unsigned int> _faces;        /**< Two faces per edge, NO_FACE if there is only one. */
+    std::vector<unsigned int> _clusterFirst; /**< First edge of each cluster, one extra at end. */
+    std::vector<unsigned int> _faceFirst;    /**< First entry of each face in _faceEdges, one extra at end. */
+    std::vector<unsigned int> _faceEdges;    /**< Edges of each face. */
+
+public:
+
+    static const unsigned int NO_FACE = 0xffffffff;   /**< Missing face of a boundary edge. */
+
+    /**
+     * @brief Default constructor.
+     */
+    MeshEdges();
+
+    /**
+     * @brief Build the unique edges of a model. Runs in parallel.
+     * @param model Model to process.
+     * @param clusters Clusters of the model.
+     */
+    void build(Model *model, const MeshClusters &clusters);
+
+    /**
+     * @brief Clear the edges.
+     */
+    void clear();
+
+    /**
+     * @brief Exchange the edges with another instance.
+     * @param other Edges to exchange with.
+     */
+    void swap(MeshEdges &other);
+
+    /**
+     * @brief Return number of edges.
+     * @return Number of edges.
+     */
+    unsigned int size() const;
+
+    /**
+     * @brief Return a vertex of an edge.
+     * @param edge Edge index.
+     * @param end 0 or 1.
+     * @return Vertex index.
+     */
+    unsigned int getVertex(unsigned int edge, unsigned int end) const;
+
+    /**
+     * @brief Return a face of an edge. Faces beyond the second one of
+     * non-manifold edges are not kept.
+     * @param edge Edge index.
+     * @param side 0 or 1.
+     * @return Face index, NO_FACE if the edge has no face on that side.
+     */
+    unsigned int getFace(unsigned int edge, unsigned int side) const;
+
+    /**
+     * @brief Return first edge of a cluster.
+     * @param cluster Cluster index.
+     * @return Edge index.
+     */
+    unsigned int firstEdge(unsigned int cluster) const;
+
+    /**
+     * @brief Return number of edges of a cluster.
+     * @param cluster Cluster index.
+     * @return Number of edges.
+     */
+    unsigned int clusterEdges(unsigned int cluster) const;
+
+    /**
+     * @brief Draw the edges of the visible clusters, consecutive clusters
+     * in a single call. The current color is used.
+     * @param visible One flag per cluster, as computed by MeshClusters::cull.
+     */
+    void draw(const std::vector<unsigned char> &visible) const;
+
+    /**
+     * @brief Get if an edge is on the boundary of a face set.
+     * @param edge Edge index.
+     * @param faces Face set.
+     * @return True if exactly one face of the edge is in the set.
+     */
+    bool isBoundary(unsigned int edge, const FaceSelection &faces) const;
+
+    /**
+     * @brief Compute the boundary of a face set. Runs in parallel.
+     * @param faces Face set.
+     * @param edges Result edge set, replaced.
+     */
+    void boundary(const FaceSelection &faces, FaceSelection *edges) const;
+
+    /**
+     * @brief Update the boundary of a face set after some faces changed.
+     * Only the edges of the changed faces are tested again.
+     * @param faces Face set, already changed.
+     * @param changed Faces added to or removed from the set.
+     * @param edges Boundary before the change, updated.
+     */
+    void updateBoundary(const FaceSelection &faces, const FaceSelection &changed, FaceSelection *edges) const;
+
+    /**
+     * @brief Draw a set of edges in a single call. The current color and line width are used.
+     * @param edges Edge set, edges out of range are skipped.
+     */
+    void drawEdges(const FaceSelection &edges) const;
+
+};
+
+#endif // MESHEDGES_H
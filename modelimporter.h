@@ -1,12 +1,27 @@
 #ifndef MODELIMPORTER_H
 #define MODELIMPORTER_H
 
+#include <vector>
 #include "model.h"
 
+/**
+ * @brief Receives the progress of an import. May be called from a worker thread.
+ */
+class ImportObserver
+{
+public:
+    /**
+     * @brief Coarse preview of the vertices read so far.
+     * @param points Vertex positions (x, y, z), centered with the bounds read so far.
+     * @param size Size of the bounds read so far.
+     */
+    virtual void importPreview(const std::vector<float> &points, float size) = 0;
+};
+
 class ModelImporter
 {
 public:
-    virtual bool import(Model *model, QString path) const = 0;
+    virtual bool import(Model *model, QString path, ImportObserver *observer = 0) const = 0;
 };
 
 #endif // MODELIMPORTER_H
@@ -0,0 +1,124 @@
+#include "modelloader.h"
+
+#include <algorithm>
+#include <QtConcurrentRun>
+#include <QMetaType>
+
+ModelLoader::ModelLoader(QObject *parent) : QObject(parent)
+{
+    _model = 0;
+
+    // Previews are queued from the worker thread.
+    qRegisterMetaType< QVector<float> >("QVector<float>");
+    connect(&_watcher, SIGNAL(finished()), this, SLOT(runFinished()));
+}
+
+ModelLoader::~ModelLoader()
+{
+    _watcher.waitForFinished();
+    delete _model;
+}
+
+bool ModelLoader::load(QString path)
+{
+    if ( isLoading() )
+        return false;
+
+    delete _model;
+    _model = new Model();
+    _clusters.clear();
+    _rayPicker.clear();
+    _lod.clear();
+    _edges.clear();
+    _adjacency.clear();
+    _path = path;
+
+    _watcher.setFuture(QtConcurrent::run(this, &ModelLoader::run));
+    return true;
+}
+
+QString ModelLoader::getPath() const
+{
+    return _path;
+}
+
+bool ModelLoader::isLoading() const
+{
+    return _watcher.isRunning();
+}
+
+bool ModelLoader::run()
+{
+    PlyImporter importer;
+    if ( !importer.import(_model, _path, this) )
+        return false;
+
+    {
+        ScopedProbe probe(Profiler::LOAD_CLUSTERS);
+        _clusters.build(_model);
+    }
+    {
+        ScopedProbe probe(Profiler::LOAD_PICKER);
+        _rayPicker.build(_model);
+    }
+    {
+        ScopedProbe probe(Profiler::LOAD_LOD);
+        _lod.build(_model);
+    }
+    {
+        ScopedProbe probe(Profiler::LOAD_EDGES);
+        _edges.build(_model, _clusters);
+    }
+    {
+        ScopedProbe probe(Profiler::LOAD_ADJACENCY);
+        _adjacency.build(_model, _edges);
+    }
+
+    return true;
+}
+
+void ModelLoader::importPreview(const std::vector<float> &points, float size)
+{
+    QVector<float> copy(points.size());
+    if ( !points.empty() )
+        std::copy(points.begin(), points.end(), copy.begin());
+
+    emit preview(copy, size);
+}
+
+void ModelLoader::runFinished()
+{
+    emit finished(_watcher.result());
+}
+
+Model* ModelLoader::takeModel()
+{
+    Model *model = _model;
+    _model = 0;
+    return model;
+}
+
+MeshClusters* ModelLoader::getClusters()
+{
+    return &_clusters;
+}
+
+RayPicker* ModelLoader::getRayPicker()
+{
+    return &_rayPicker;
+}
+
+LodMesh* ModelLoader::getLod()
+{
+    return &_lod;
+}
+
+MeshEdges* ModelLoader::getEdges()
+{
+    return &_edges;
+}
+
+FaceAdjacency* ModelLoader::getAdjacency()
+{
+    return &_adjacency;
+}
@@ -0,0 +1,157 @@
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QVector>
+#include "plyimporter.h"
+#include "meshclusters.h"
+#include "raypicker.h"
+#include "lodmesh.h"
+#include "meshedges.h"
+#include "faceadjacency.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The ModelLoader class loads a ply model in a worker thread. Parsing,
+ * normals, clusters, the ray picker, the reduced models, the unique
+ * edges and the face adjacency are computed out of the GUI thread. While vertices are read, coarse point previews are sent with
+ * the preview signal, so the viewer can show the model before it is
+ * complete. The finished signal is emitted in the GUI thread.
+ */
+class ModelLoader : public QObject, public ImportObserver
+{
+    Q_OBJECT
+
+private:
+
+    QString _path;                   /**< File being loaded. */
+    Model* _model;                   /**< Loaded model, owned until taken. */
+    MeshClusters _clusters;          /**< Clusters of the loaded model. */
+    RayPicker _rayPicker;            /**< Ray picker of the loaded model. */
+    LodMesh _lod;                    /**< Reduced versions of the loaded model. */
+    MeshEdges _edges;                /**< Unique edges of the loaded model. */
+    FaceAdjacency _adjacency;        /**< Face adjacency of the loaded model. */
+    QFutureWatcher<bool> _watcher;   /**< Watches the worker thread. */
+
+    /**
+     * @brief Load the model. Runs in the worker thread.
+     * @return True if model was loaded, false otherwise.
+     */
+    bool run();
+
+public:
+
+    /**
+     * @brief Default constructor.
+     * @param parent Parent object.
+     */
+    explicit ModelLoader(QObject *parent = 0);
+
+    /**
+     * @brief Destructor. Waits for a running load.
+     */
+    ~ModelLoader();
+
+    /**
+     * @brief Start loading a model.
+     * @param path File to load.
+     * @return False if a model is already loading, true otherwise.
+     */
+    bool load(QString path);
+
+    /**
+     * @brief Return the file loaded or being loaded.
+     * @return Model file.
+     */
+    QString getPath() const;
+
+    /**
+     * @brief Get if a model is loading.
+     * @return True if loading, false otherwise.
+     */
+    bool isLoading() const;
+
+    /**
+     * @brief Take the loaded model. Caller owns it.
+     * @return Loaded model, null if there is none.
+     */
+    Model* takeModel();
+
+    /**
+     * @brief Return the clusters of the loaded model.
+     * @return Clusters, can be swapped out by caller.
+     */
+    MeshClusters* getClusters();
+
+    /**
+     * @brief Return the ray picker of the loaded model.
+     * @return Ray picker, can be swapped out by caller.
+     */
+    RayPicker* getRayPicker();
+
+    /**
+     * @brief Return the reduced versions of the loaded model.
+     * @return Reduced models, can be swapped out by caller.
+     */
+    LodMesh* getLod();
+
+    /**
+     * @brief Return the unique edges of the loaded model.
+     * @return Edges, can be swapped out by caller.
+     */
+    MeshEdges* getEdges();
+
+    /**
+     * @brief Return the face adjacency of the loaded model.
+     * @return Adjacency, can be swapped out by caller.
+     */
+    FaceAdjacency* getAdjacency();
+
+    /**
+     * @brief Forward an importer preview. Called from the worker thread.
+     */
+    void importPreview(const std::vector<float> &points, float size);
+
+signals:
+
+    /**
+     * @brief Coarse preview of the model being loaded.
+     * @param points Vertex positions (x, y, z).
+     * @param size Model size.
+     */
+    void preview(QVector<float> points, float size);
+
+    /**
+     * @brief Load finished.
+     * @param loaded True if model was loaded, false otherwise.
+     */
+    void finished(bool loaded);
+
+private slots:
+
+    /**
+     * @brief Emit finished when the worker thread ends.
+     */
+    void runFinished();
+
+};
+
+#endif // MODELLOADER_H
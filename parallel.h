@@ -0,0 +1,203 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <vector>
+#include <QtConcurrentMap>
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Helpers to run a loop over [0, count) in parallel on the global thread
+ * pool. The loop is split in ranges and a kernel (any object with a const
+ * operator()(const ParallelRange&)) is called once per range. Kernels are
+ * shared between threads, so they must only write to their own range or
+ * to per-range storage indexed by ParallelRange::index. parallelSort
+ * sorts an array with the same ranges.
+ */
+
+/**
+ * @brief A contiguous range [begin, end) of a parallel loop.
+ */
+struct ParallelRange
+{
+    unsigned int begin;     /**< First element. */
+    unsigned int end;       /**< Last element (not included). */
+    unsigned int index;     /**< Range index, from 0 to number of ranges - 1. */
+};
+
+static const unsigned int PARALLEL_GRAIN = 16384;   /**< Default elements per range. */
+
+/**
+ * @brief Split [0, count) in ranges of grain elements.
+ * @param count Number of elements.
+ * @param grain Elements per range.
+ * @return Range list.
+ */
+inline std::vector<ParallelRange> parallelRanges(unsigned int count, unsigned int grain = PARALLEL_GRAIN)
+{
+    std::vector<ParallelRange> ranges;
+    if ( grain == 0 )
+        grain = 1;
+
+    for ( unsigned int begin = 0; begin < count; begin += grain )
+    {
+        ParallelRange range;
+        range.begin = begin;
+        range.end = (count - begin > grain) ? begin + grain : count;
+        range.index = ranges.size();
+        ranges.push_back(range);
+    }
+
+    return ranges;
+}
+
+/**
+ * @brief Adapter from a kernel to a QtConcurrent map function.
+ */
+template <typename Kernel>
+class ParallelTask
+{
+private:
+
+    const Kernel *_kernel;
+
+public:
+
+    typedef void result_type;
+
+    ParallelTask(const Kernel *kernel) : _kernel(kernel) { }
+
+    void operator()(ParallelRange &range) const
+    {
+        (*_kernel)(range);
+    }
+};
+
+/**
+ * @brief Run a kernel over a range list. Blocks until all ranges are done.
+ * @param ranges Range list.
+ * @param kernel Kernel to run.
+ */
+template <typename Kernel>
+void parallelMap(std::vector<ParallelRange> &ranges, const Kernel &kernel)
+{
+    if ( ranges.size() == 1 )
+        kernel(ranges[0]);
+    else if ( ranges.size() > 1 )
+        QtConcurrent::blockingMap(ranges, ParallelTask<Kernel>(&kernel));
+}
+
+/**
+ * @brief Run a kernel over [0, count). Blocks until all ranges are done.
+ * @param count Number of elements.
+ * @param kernel Kernel to run.
+ * @param grain Elements per range.
+ */
+template <typename Kernel>
+void parallelFor(unsigned int count, const Kernel &kernel, unsigned int grain = PARALLEL_GRAIN)
+{
+    std::vector<ParallelRange> ranges = parallelRanges(count, grain);
+    parallelMap(ranges, kernel);
+}
+
+/**
+ * @brief Sort each range of an array.
+ */
+template <typename T>
+struct SortKernel
+{
+    T *data;
+
+    void operator()(const ParallelRange &range) const
+    {
+        std::sort(data + range.begin, data + range.end);
+    }
+};
+
+/**
+ * @brief Merge two sorted runs per range: [begin, middle) and [middle, end).
+ */
+template <typename T>
+struct MergeKernel
+{
+    const T *in;
+    T *out;
+    const unsigned int *middles;    /**< Middle of each range, by range index. */
+
+    void operator()(const ParallelRange &range) const
+    {
+        unsigned int middle = middles[range.index];
+        std::merge(in + range.begin, in + middle, in + middle, in + range.end, out + range.begin);
+    }
+};
+
+/**
+ * @brief Sort an array in parallel. Ranges are sorted first and then
+ * merged in pairs, each merge pass running in parallel.
+ * @param data Array to sort.
+ * @param grain Elements per sorted range.
+ */
+template <typename T>
+void parallelSort(std::vector<T> &data, unsigned int grain = PARALLEL_GRAIN)
+{
+    std::vector<ParallelRange> runs = parallelRanges(data.size(), grain);
+    if ( runs.size() < 2 )
+    {
+        std::sort(data.begin(), data.end());
+        return;
+    }
+
+    SortKernel<T> sort;
+    sort.data = &data[0];
+    parallelMap(runs, sort);
+
+    std::vector<T> buffer(data.size());
+    T *in = &data[0];
+    T *out = &buffer[0];
+    while ( runs.size() > 1 )
+    {
+        // A last run without pair is copied as is.
+        std::vector<ParallelRange> merges;
+        std::vector<unsigned int> middles;
+        for ( unsigned int i = 0; i < runs.size(); i += 2 )
+        {
+            ParallelRange merge;
+            merge.begin = runs[i].begin;
+            merge.end = (i + 1 < runs.size()) ? runs[i + 1].end : runs[i].end;
+            merge.index = merges.size();
+            merges.push_back(merge);
+            middles.push_back(runs[i].end);
+        }
+
+        MergeKernel<T> kernel;
+        kernel.in = in;
+        kernel.out = out;
+        kernel.middles = &middles[0];
+        parallelMap(merges, kernel);
+
+        std::swap(in, out);
+        runs.swap(merges);
+    }
+
+    if ( in != &data[0] )
+        data.swap(buffer);
+}
+
+#endif // PARALLEL_H
@@ -1,6 +1,27 @@
 #include "plyimporter.h"
 
-bool PlyImporter::import(Model *model, QString path) const
+#include <algorithm>
+
+void PlyImporter::sendPreview(const std::vector<Vertex> &vertexList, const float min[3], const float max[3],
+                              ImportObserver *observer)
+{
+    unsigned int stride = std::max(1u, (unsigned int)vertexList.size() / PREVIEW_POINTS);
+    float size = std::max(max[0] - min[0], std::max(max[1] - min[1], max[2] - min[2]));
+
+    std::vector<float> points;
+    points.reserve(3 * (vertexList.size() / stride + 1));
+    for ( unsigned int i = 0; i < vertexList.size(); i += stride )
+    {
+        Vertex vertex = vertexList[i];
+        points.push_back(vertex.getX() - (min[0] + max[0]) / 2.0f);
+        points.push_back(vertex.getY() - (min[1] + max[1]) / 2.0f);
+        points.push_back(vertex.getZ() - (min[2] + max[2]) / 2.0f);
+    }
+
+    observer->importPreview(points, size);
+}
+
+bool PlyImporter::import(Model *model, QString path, ImportObserver *observer) const
 {
     enum Area { HEADER, VERTICES, FACES, END };
     Area area = HEADER;
@@ -15,6 +36,11 @@ bool PlyImporter::import(Model *model, QString path) const
     vertexList.clear();
     polyList.clear();
 
+    QElapsedTimer timer;
+    timer.start();
+    QElapsedTimer previewTimer;         // Time since last preview.
+    previewTimer.start();
+
     QFile file(path);
     if ( !file.open(QIODevice::ReadOnly | QIODevice::Text) )
     {
@@ -79,6 +105,15 @@ bool PlyImporter::import(Model *model, QString path) const
                         zmax = vertex->getZ();
                 }
 
+                // Refine the preview while reading, the last one has every vertex read.
+                if ( observer && (vertexList.size() == numVertices || previewTimer.elapsed() >= PREVIEW_INTERVAL) )
+                {
+                    float min[3] = { xmin, ymin, zmin };
+                    float max[3] = { xmax, ymax, zmax };
+                    sendPreview(vertexList, min, max, observer);
+                    previewTimer.restart();
+                }
+
                 if ( vertexList.size() == numVertices )
                     area = FACES;
             }
@@ -128,7 +163,10 @@ bool PlyImporter::import(Model *model, QString path) const
         vertex->setValues(vertex->getX()-centerX, vertex->getY()-centerY, vertex->getZ()-centerZ);
     }
 
+    Profiler::instance()->record(Profiler::LOAD_PARSE, timer.nsecsElapsed());
+
     // Set model
+    ScopedProbe probe(Profiler::LOAD_NORMALS);
     model->setModel(vertexList, polyList, modelSize);
 
     return true;
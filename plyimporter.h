@@ -9,6 +9,7 @@
 #include <QTextStream>
 
 #include "modelimporter.h"
+#include "profiler.h"
 
 /**
  * This source file is part of 3DMarker.
@@ -34,15 +35,31 @@
  */
 class PlyImporter : public ModelImporter
 {
+private:
+
+    /**
+     * @brief Send a strided subset of the vertices read so far to an observer.
+     * @param vertexList Vertices read so far.
+     * @param min Minimum of the vertices bounds.
+     * @param max Maximum of the vertices bounds.
+     * @param observer Observer to notify.
+     */
+    static void sendPreview(const std::vector<Vertex> &vertexList, const float min[3], const float max[3],
+                            ImportObserver *observer);
+
 public:
 
+    static const int PREVIEW_INTERVAL = 100;            /**< Time between previews (ms). */
+    static const unsigned int PREVIEW_POINTS = 100000;  /**< Maximum points of a preview. */
+
     /**
      * @brief Import a model from ply file.
      * @param model Model to be loaded.
      * @param path File to load.
+     * @param observer If not null, receives previews while vertices are read.
      * @return True if model was loaded, false otherwise.
      */
-    bool import(Model *model, QString path) const;
+    bool import(Model *model, QString path, ImportObserver *observer = 0) const;
 
 };
 
@@ -0,0 +1,133 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <vector>
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+
+Profiler::Profiler()
+{
+    for ( int p = 0; p < PROBE_COUNT; ++p )
+        for ( int i = 0; i < WINDOW; ++i )
+            _samples[p][i] = 0.0f;
+}
+
+Profiler* Profiler::instance()
+{
+    static Profiler profiler;
+    return &profiler;
+}
+
+QString Profiler::probeName(Probe probe)
+{
+    switch (probe) {
+        case FRAME_TIME:
+            return "Frame";
+        case PICK_LATENCY:
+            return "Pick";
+        case SELECTION_OVERLAY:
+            return "Selection overlay";
+        case FACE_GRID:
+            return "Face grid";
+        case LOAD_PARSE:
+            return "Load: parse";
+        case LOAD_NORMALS:
+            return "Load: normals";
+        case LOAD_CLUSTERS:
+            return "Load: clusters";
+        case LOAD_PICKER:
+            return "Load: picker";
+        case LOAD_DISPLAY_LISTS:
+            return "Load: display lists";
+        case LOAD_LOD:
+            return "Load: reduced models";
+        case LOAD_EDGES:
+            return "Load: edges";
+        case LOAD_ADJACENCY:
+            return "Load: adjacency";
+        default:
+            return "Unknown";
+    }
+}
+
+void Profiler::record(Probe probe, qint64 nanoseconds)
+{
+    // Unsigned, the ring stays in bounds when the counter wraps.
+    unsigned int index = (unsigned int)_counts[probe].fetchAndAddRelaxed(1);
+    _samples[probe][index % WINDOW] = nanoseconds / 1000000.0f;
+}
+
+Profiler::Stats Profiler::getStats(Probe probe)
+{
+    Stats stats;
+    stats.count = _counts[probe].fetchAndAddRelaxed(0);
+    stats.window = std::min(stats.count, (unsigned int)WINDOW);
+    stats.mean = stats.p50 = stats.p95 = stats.p99 = stats.max = 0.0f;
+
+    if ( stats.window == 0 )
+        return stats;
+
+    std::vector<float> samples(_samples[probe], _samples[probe] + stats.window);
+    std::sort(samples.begin(), samples.end());
+
+    float sum = 0.0f;
+    for ( unsigned int i = 0; i < samples.size(); ++i )
+        sum += samples[i];
+
+    stats.mean = sum / samples.size();
+    stats.p50 = samples[(samples.size() - 1) * 50 / 100];
+    stats.p95 = samples[(samples.size() - 1) * 95 / 100];
+    stats.p99 = samples[(samples.size() - 1) * 99 / 100];
+    stats.max = samples.back();
+
+    return stats;
+}
+
+QString Profiler::report(bool onlyUsed)
+{
+    QString text;
+    for ( int p = 0; p < PROBE_COUNT; ++p )
+    {
+        Stats stats = getStats((Probe)p);
+        if ( onlyUsed && stats.count == 0 )
+            continue;
+
+        text.append(QString("%1: n=%2 mean=%3 p50=%4 p95=%5 p99=%6 max=%7 ms\n")
+                    .arg(probeName((Probe)p))
+                    .arg(stats.count)
+                    .arg(stats.mean, 0, 'f', 2)
+                    .arg(stats.p50, 0, 'f', 2)
+                    .arg(stats.p95, 0, 'f', 2)
+                    .arg(stats.p99, 0, 'f', 2)
+                    .arg(stats.max, 0, 'f', 2));
+    }
+
+    return text;
+}
+
+bool Profiler::save(QString path)
+{
+    QFile file(path);
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Text) )
+        return false;
+
+    QTextStream out(&file);
+    out << "3DMarker performance report, " << QDateTime::currentDateTime().toString(Qt::ISODate) << "\n";
+    out << "Statistics over the last " << WINDOW << " samples of each probe.\n\n";
+    out << report(false);
+
+    file.close();
+    return true;
+}
+
+ScopedProbe::ScopedProbe(Profiler::Probe probe)
+{
+    _probe = probe;
+    _timer.start();
+}
+
+ScopedProbe::~ScopedProbe()
+{
+    Profiler::instance()->record(_probe, _timer.nsecsElapsed());
+}
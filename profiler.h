@@ -0,0 +1,144 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QString>
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The Profiler class collects timings of the viewer and the import path.
+ * Each probe keeps the last WINDOW samples in a ring, so recording is a
+ * counter increment and a store, cheap enough to be always enabled.
+ * Percentiles are only computed when statistics are requested.
+ */
+class Profiler
+{
+public:
+
+    /**
+     * @brief The Probe enum lists the measured stages.
+     */
+    enum Probe {
+        FRAME_TIME,             /**< paintGL. */
+        PICK_LATENCY,           /**< Brush or hit picking. */
+        SELECTION_OVERLAY,      /**< Current selection drawing. */
+        FACE_GRID,              /**< Projected face grid rebuild. */
+        LOAD_PARSE,             /**< Model file parsing. */
+        LOAD_NORMALS,           /**< Model normals computation. */
+        LOAD_CLUSTERS,          /**< Model clusters build. */
+        LOAD_PICKER,            /**< Ray picker build. */
+        LOAD_DISPLAY_LISTS,     /**< Display lists compilation. */
+        LOAD_LOD,               /**< Reduced models build. */
+        LOAD_EDGES,             /**< Unique edges build. */
+        LOAD_ADJACENCY,         /**< Face adjacency build. */
+        PROBE_COUNT
+    };
+
+    /**
+     * @brief Statistics of a probe, in milliseconds.
+     */
+    struct Stats
+    {
+        unsigned int count;     /**< Samples recorded since start. */
+        unsigned int window;    /**< Samples used for the statistics. */
+        float mean;
+        float p50;
+        float p95;
+        float p99;
+        float max;
+    };
+
+    static const int WINDOW = 1024;     /**< Samples kept per probe. */
+
+private:
+
+    float _samples[PROBE_COUNT][WINDOW];    /**< Ring of samples (ms) per probe. */
+    QAtomicInt _counts[PROBE_COUNT];        /**< Samples recorded per probe. */
+
+    /**
+     * @brief Default constructor.
+     */
+    Profiler();
+
+public:
+
+    /**
+     * @brief Return the application profiler.
+     * @return Profiler instance.
+     */
+    static Profiler* instance();
+
+    /**
+     * @brief Return the name of a probe.
+     * @param probe Probe.
+     * @return Probe name.
+     */
+    static QString probeName(Probe probe);
+
+    /**
+     * @brief Add a sample to a probe. Can be called from any thread.
+     * @param probe Probe.
+     * @param nanoseconds Measured time.
+     */
+    void record(Probe probe, qint64 nanoseconds);
+
+    /**
+     * @brief Compute the statistics of a probe over its last samples.
+     * @param probe Probe.
+     * @return Probe statistics.
+     */
+    Stats getStats(Probe probe);
+
+    /**
+     * @brief Return a line per probe with its statistics.
+     * @param onlyUsed True to skip probes without samples.
+     * @return Report text.
+     */
+    QString report(bool onlyUsed = true);
+
+    /**
+     * @brief Write the report to a file.
+     * @param path File path.
+     * @return True if saved, false otherwise.
+     */
+    bool save(QString path);
+
+};
+
+/**
+ * The ScopedProbe class records the time between its construction and its
+ * destruction in a profiler probe.
+ */
+class ScopedProbe
+{
+private:
+
+    Profiler::Probe _probe;     /**< Probe to record. */
+    QElapsedTimer _timer;       /**< Timer started on construction. */
+
+public:
+
+    ScopedProbe(Profiler::Probe probe);
+    ~ScopedProbe();
+
+};
+
+#endif // PROFILER_H
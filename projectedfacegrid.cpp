@@ -0,0 +1,638 @@
+#include "projectedfacegrid.h"
+
+#include <algorithm>
+#include <math.h>
+#include "parallel.h"
+
+const float ProjectedFaceGrid::DEPTH_TOLERANCE = 0.01;
+
+static const unsigned int INVALID_CELL = 0xffffffff;
+
+/**
+ * @brief Project model vertices to widget coordinates.
+ */
+struct ProjectVerticesKernel
+{
+    Model *model;
+    float mvp[16];
+    int viewport[4];
+    int height;
+    float *x, *y, *w;
+
+    void operator()(const ParallelRange &range) const
+    {
+        for ( unsigned int i = range.begin; i < range.end; ++i )
+        {
+            Vertex *vertex = model->getVertexAt(i);
+            float vx = vertex->getX(), vy = vertex->getY(), vz = vertex->getZ();
+            float cx = mvp[0]*vx + mvp[4]*vy + mvp[8]*vz + mvp[12];
+            float cy = mvp[1]*vx + mvp[5]*vy + mvp[9]*vz + mvp[13];
+            float cw = mvp[3]*vx + mvp[7]*vy + mvp[11]*vz + mvp[15];
+
+            if ( cw < Camera::NEAR_PLANE )
+            {
+                w[i] = -1.0f;       // Behind the camera.
+                continue;
+            }
+
+            x[i] = viewport[0] + (cx / cw + 1.0f) * 0.5f * viewport[2];
+            y[i] = height - (viewport[1] + (cy / cw + 1.0f) * 0.5f * viewport[3]);
+            w[i] = cw;
+        }
+    }
+};
+
+/**
+ * @brief Projected face data computed from projected vertices.
+ */
+struct ProjectedFace
+{
+    float xmin, ymin, xmax, ymax;
+    float cx, cy;
+    float depth;
+
+    /**
+     * @brief Compute face data.
+     * @return True if face is front-facing, in front of the camera and on screen.
+     */
+    bool compute(Poly *poly, const float *x, const float *y, const float *w, int width, int height)
+    {
+        int size = poly->size();
+        if ( size < 3 )
+            return false;
+
+        float area = 0.0f;
+        cx = cy = 0.0f;
+        for ( int i = 0; i < size; ++i )
+        {
+            unsigned int v = poly->getAt(i);
+            unsigned int next = poly->getAt((i + 1) % size);
+            if ( w[v] < 0.0f )
+                return false;
+
+            if ( i == 0 )
+            {
+                xmin = xmax = x[v];
+                ymin = ymax = y[v];
+                depth = w[v];
+            }
+            else
+            {
+                xmin = std::min(xmin, x[v]);
+                xmax = std::max(xmax, x[v]);
+                ymin = std::min(ymin, y[v]);
+                ymax = std::max(ymax, y[v]);
+                depth = std::min(depth, w[v]);
+            }
+
+            cx += x[v];
+            cy += y[v];
+            area += x[v] * y[next] - x[next] * y[v];
+        }
+
+        cx /= size;
+        cy /= size;
+
+        // Widget y axis points down, so front faces (counter-clockwise in GL) have negative area.
+        if ( area >= 0.0f )
+            return false;
+
+        return xmax >= 0.0f && ymax >= 0.0f && xmin < width && ymin < height;
+    }
+};
+
+/**
+ * @brief Compute the cell of each face and count faces per cell and range.
+ */
+struct ClassifyFacesKernel
+{
+    Model *model;
+    const MeshClusters *clusters;
+    const unsigned char *visible;
+    const float *x, *y, *w;
+    int width, height, columns, rows;
+    unsigned int *keys;
+    unsigned int *counts;
+
+    void operator()(const ParallelRange &range) const
+    {
+        unsigned int cells = columns * rows + 1;
+        unsigned int *count = counts + range.index * cells;
+
+        for ( unsigned int i = range.begin; i < range.end; ++i )
+        {
+            ProjectedFace face;
+            if ( visible != 0 && !visible[clusters->clusterOf(i)] )
+            {
+                keys[i] = INVALID_CELL;
+                continue;
+            }
+
+            unsigned int index = clusters != 0 ? clusters->getFace(i) : i;
+            if ( !face.compute(model->getPolyAt(index), x, y, w, width, height) )
+            {
+                keys[i] = INVALID_CELL;
+                continue;
+            }
+
+            unsigned int key;
+            if ( face.xmax - face.xmin > ProjectedFaceGrid::CELL_SIZE ||
+                 face.ymax - face.ymin > ProjectedFaceGrid::CELL_SIZE )
+                key = columns * rows;       // Big faces bucket.
+            else
+            {
+                int column = std::max(0, std::min(columns - 1, (int)(face.cx / ProjectedFaceGrid::CELL_SIZE)));
+                int row = std::max(0, std::min(rows - 1, (int)(face.cy / ProjectedFaceGrid::CELL_SIZE)));
+                key = row * columns + column;
+            }
+
+            keys[i] = key;
+            ++count[key];
+        }
+    }
+};
+
+/**
+ * @brief Write faces to their cells.
+ */
+struct ScatterFacesKernel
+{
+    Model *model;
+    const MeshClusters *clusters;
+    const float *x, *y, *w;
+    int width, height, columns, rows;
+    const unsigned int *keys;
+    unsigned int *offsets;
+    unsigned int *entryFace;
+    float *entryCentroid;
+    short *entryBounds;
+    float *entryDepth;
+
+    static short toShort(float value)
+    {
+        return (short)std::max(-32768.0f, std::min(32767.0f, value));
+    }
+
+    void operator()(const ParallelRange &range) const
+    {
+        unsigned int cells = columns * rows + 1;
+        unsigned int *cursor = offsets + range.index * cells;
+
+        for ( unsigned int i = range.begin; i < range.end; ++i )
+        {
+            if ( keys[i] == INVALID_CELL )
+                continue;
+
+            unsigned int index = clusters != 0 ? clusters->getFace(i) : i;
+            ProjectedFace face;
+            face.compute(model->getPolyAt(index), x, y, w, width, height);
+
+            unsigned int entry = cursor[keys[i]]++;
+            entryFace[entry] = index;
+            entryCentroid[entry*2] = face.cx;
+            entryCentroid[entry*2 + 1] = face.cy;
+            entryBounds[entry*4] = toShort(floor(face.xmin));
+            entryBounds[entry*4 + 1] = toShort(floor(face.ymin));
+            entryBounds[entry*4 + 2] = toShort(ceil(face.xmax));
+            entryBounds[entry*4 + 3] = toShort(ceil(face.ymax));
+            entryDepth[entry] = face.depth;
+        }
+    }
+};
+
+/**
+ * @brief Convert window depth to eye depth and flip rows.
+ */
+struct LinearizeDepthKernel
+{
+    const float *depth;
+    float *result;
+    int width, height;
+
+    void operator()(const ParallelRange &range) const
+    {
+        for ( unsigned int row = range.begin; row < range.end; ++row )
+        {
+            const float *source = depth + (height - 1 - row) * width;
+            float *target = result + row * width;
+            for ( int column = 0; column < width; ++column )
+                target[column] = Camera::linearizeDepth(source[column]);
+        }
+    }
+};
+
+/**
+ * @brief Rasterize a polygon in a pixel mask with the even-odd rule, one row at a time.
+ */
+struct PolygonMaskKernel
+{
+    const float *points;
+    unsigned int numPoints;
+    int width;
+    unsigned char *mask;
+
+    void operator()(const ParallelRange &range) const
+    {
+        std::vector<float> crossings;
+        for ( unsigned int row = range.begin; row < range.end; ++row )
+        {
+            // Edges crossing the row at pixel centers.
+            float y = row + 0.5f;
+            crossings.clear();
+            for ( unsigned int i = 0, j = numPoints - 1; i < numPoints; j = i++ )
+            {
+                float yi = points[2*i + 1], yj = points[2*j + 1];
+                if ( (yi <= y) != (yj <= y) )
+                    crossings.push_back(points[2*i] + (y - yi) * (points[2*j] - points[2*i]) / (yj - yi));
+            }
+            std::sort(crossings.begin(), crossings.end());
+
+            unsigned char *line = mask + row * width;
+            for ( unsigned int c = 0; c + 1 < crossings.size(); c += 2 )
+            {
+                int begin = std::max(0, (int)ceil(crossings[c] - 0.5f));
+                int end = std::min(width, (int)ceil(crossings[c + 1] - 0.5f));
+                for ( int column = begin; column < end; ++column )
+                    line[column] = 1;
+            }
+        }
+    }
+};
+
+/**
+ * @brief Collect the entries whose centroid is on a mask pixel and not hidden.
+ */
+struct PolygonFacesKernel
+{
+    const unsigned int *entryFace;
+    const float *entryCentroid;
+    const float *entryDepth;
+    const float *depthBuffer;
+    const unsigned char *mask;
+    int width, height;
+    std::vector<unsigned int> *results;
+
+    void operator()(const ParallelRange &range) const
+    {
+        std::vector<unsigned int> &faces = results[range.index];
+        for ( unsigned int entry = range.begin; entry < range.end; ++entry )
+        {
+            float x = entryCentroid[entry*2];
+            float y = entryCentroid[entry*2 + 1];
+            if ( x < 0.0f || y < 0.0f || x >= width || y >= height )
+                continue;
+
+            unsigned int pixel = (int)y * width + (int)x;
+            if ( !mask[pixel] )
+                continue;
+
+            if ( depthBuffer && entryDepth[entry] > depthBuffer[pixel] * (1.0f + ProjectedFaceGrid::DEPTH_TOLERANCE) )
+                continue;
+
+            faces.push_back(entryFace[entry]);
+        }
+    }
+};
+
+/**
+ * @brief Collect the face ids of the mask pixels, one row at a time.
+ */
+struct PolygonIdsKernel
+{
+    const unsigned int *ids;
+    const unsigned char *mask;
+    int width;
+    std::vector<unsigned int> *results;
+
+    void operator()(const ParallelRange &range) const
+    {
+        std::vector<unsigned int> &faces = results[range.index];
+        for ( unsigned int pixel = range.begin * width; pixel < range.end * width; ++pixel )
+        {
+            // Neighbor pixels mostly see the same face.
+            if ( mask[pixel] && ids[pixel] != 0 && (faces.empty() || faces.back() != ids[pixel] - 1) )
+                faces.push_back(ids[pixel] - 1);
+        }
+    }
+};
+
+ProjectedFaceGrid::ProjectedFaceGrid()
+{
+    clear();
+}
+
+void ProjectedFaceGrid::clear()
+{
+    _built = false;
+    _columns = _rows = 0;
+    _cellStart.clear();
+    _entryFace.clear();
+    _entryCentroid.clear();
+    _entryBounds.clear();
+    _entryDepth.clear();
+    _depthBuffer.clear();
+    _idBuffer.clear();
+}
+
+bool ProjectedFaceGrid::isValid(const Camera &camera) const
+{
+    return _built && _camera == camera;
+}
+
+void ProjectedFaceGrid::build(Model *model, const Camera &camera, const MeshClusters *clusters,
+                              const std::vector<unsigned char> *visible)
+{
+    clear();
+    _camera = camera;
+
+    int width = camera.getWidth();
+    int height = camera.getHeight();
+    _columns = (width + CELL_SIZE - 1) / CELL_SIZE;
+    _rows = (height + CELL_SIZE - 1) / CELL_SIZE;
+    unsigned int cells = _columns * _rows + 1;
+
+    // Project vertices.
+    unsigned int numVertex = model->numVertex();
+    std::vector<float> x(numVertex), y(numVertex), w(numVertex);
+
+    ProjectVerticesKernel project;
+    project.model = model;
+    camera.getModelViewProjectionMatrix(project.mvp);
+    camera.getViewport(project.viewport);
+    project.height = height;
+    project.x = numVertex > 0 ? &x[0] : 0;
+    project.y = numVertex > 0 ? &y[0] : 0;
+    project.w = numVertex > 0 ? &w[0] : 0;
+    parallelFor(numVertex, project);
+
+    // Classify faces and count them per range and cell.
+    unsigned int numFaces = model->numPoly();
+    if ( clusters != 0 && clusters->numFaces() != numFaces )
+        clusters = 0;
+    if ( clusters == 0 || visible == 0 || visible->size() != clusters->size() )
+        visible = 0;
+
+    std::vector<ParallelRange> ranges = parallelRanges(numFaces, 4 * PARALLEL_GRAIN);
+    std::vector<unsigned int> keys(numFaces);
+    std::vector<unsigned int> offsets(ranges.size() * cells, 0);
+
+    ClassifyFacesKernel classify;
+    classify.model = model;
+    classify.clusters = clusters;
+    classify.visible = visible != 0 && !visible->empty() ? &(*visible)[0] : 0;
+    classify.x = project.x;
+    classify.y = project.y;
+    classify.w = project.w;
+    classify.width = width;
+    classify.height = height;
+    classify.columns = _columns;
+    classify.rows = _rows;
+    classify.keys = numFaces > 0 ? &keys[0] : 0;
+    classify.counts = offsets.empty() ? 0 : &offsets[0];
+    parallelMap(ranges, classify);
+
+    // Turn counts into write offsets: cells in order, ranges in order inside each cell.
+    _cellStart.resize(cells + 1);
+    unsigned int total = 0;
+    for ( unsigned int cell = 0; cell < cells; ++cell )
+    {
+        _cellStart[cell] = total;
+        for ( unsigned int r = 0; r < ranges.size(); ++r )
+        {
+            unsigned int count = offsets[r * cells + cell];
+            offsets[r * cells + cell] = total;
+            total += count;
+        }
+    }
+    _cellStart[cells] = total;
+
+    _entryFace.resize(total);
+    _entryCentroid.resize(total * 2);
+    _entryBounds.resize(total * 4);
+    _entryDepth.resize(total);
+
+    // Write entries.
+    ScatterFacesKernel scatter;
+    scatter.model = model;
+    scatter.clusters = clusters;
+    scatter.x = project.x;
+    scatter.y = project.y;
+    scatter.w = project.w;
+    scatter.width = width;
+    scatter.height = height;
+    scatter.columns = _columns;
+    scatter.rows = _rows;
+    scatter.keys = classify.keys;
+    scatter.offsets = classify.counts;
+    scatter.entryFace = total > 0 ? &_entryFace[0] : 0;
+    scatter.entryCentroid = total > 0 ? &_entryCentroid[0] : 0;
+    scatter.entryBounds = total > 0 ? &_entryBounds[0] : 0;
+    scatter.entryDepth = total > 0 ? &_entryDepth[0] : 0;
+    parallelMap(ranges, scatter);
+
+    _built = true;
+}
+
+void ProjectedFaceGrid::setDepthBuffer(const std::vector<float> &depth)
+{
+    int width = _camera.getWidth();
+    int height = _camera.getHeight();
+
+    _depthBuffer.clear();
+    if ( depth.size() != (unsigned int)(width * height) )
+        return;
+
+    _depthBuffer.resize(depth.size());
+
+    LinearizeDepthKernel linearize;
+    linearize.depth = &depth[0];
+    linearize.result = &_depthBuffer[0];
+    linearize.width = width;
+    linearize.height = height;
+    parallelFor(height, linearize, 64);
+}
+
+void ProjectedFaceGrid::setIdBuffer(const std::vector<unsigned int> &ids)
+{
+    int width = _camera.getWidth();
+    int height = _camera.getHeight();
+
+    _idBuffer.clear();
+    if ( ids.size() != (unsigned int)(width * height) )
+        return;
+
+    // Flip rows, queries use window coordinates.
+    _idBuffer.resize(ids.size());
+    for ( int row = 0; row < height; ++row )
+        std::copy(ids.begin() + (height - 1 - row) * width, ids.begin() + (height - row) * width,
+                  _idBuffer.begin() + row * width);
+}
+
+bool ProjectedFaceGrid::hasIdBuffer() const
+{
+    return !_idBuffer.empty();
+}
+
+bool ProjectedFaceGrid::isVisible(unsigned int entry, float x, float y) const
+{
+    if ( _depthBuffer.empty() )
+        return true;
+
+    int width = _camera.getWidth();
+    int height = _camera.getHeight();
+    int px = std::max(0, std::min(width - 1, (int)x));
+    int py = std::max(0, std::min(height - 1, (int)y));
+
+    return _entryDepth[entry] <= _depthBuffer[py * width + px] * (1.0f + DEPTH_TOLERANCE);
+}
+
+void ProjectedFaceGrid::query(float xmin, float ymin, float xmax, float ymax, bool circle,
+                              std::vector<unsigned int> *faces) const
+{
+    if ( !_built )
+        return;
+
+    if ( !_idBuffer.empty() )
+    {
+        queryIds(xmin, ymin, xmax, ymax, circle, faces);
+        return;
+    }
+
+    float centerX = (xmin + xmax) / 2.0f;
+    float centerY = (ymin + ymax) / 2.0f;
+    float radius = (xmax - xmin) / 2.0f;
+
+    // Small faces are bucketed by centroid and are never bigger than a cell.
+    int column0 = std::max(0, (int)floor((xmin - CELL_SIZE) / CELL_SIZE));
+    int column1 = std::min(_columns - 1, (int)floor((xmax + CELL_SIZE) / CELL_SIZE));
+    int row0 = std::max(0, (int)floor((ymin - CELL_SIZE) / CELL_SIZE));
+    int row1 = std::min(_rows - 1, (int)floor((ymax + CELL_SIZE) / CELL_SIZE));
+
+    std::vector<unsigned int> cells;
+    for ( int row = row0; row <= row1; ++row )
+        for ( int column = column0; column <= column1; ++column )
+            cells.push_back(row * _columns + column);
+    cells.push_back(_columns * _rows);
+
+    for ( unsigned int c = 0; c < cells.size(); ++c )
+    {
+        for ( unsigned int entry = _cellStart[cells[c]]; entry < _cellStart[cells[c] + 1]; ++entry )
+        {
+            const short *bounds = &_entryBounds[entry*4];
+            if ( bounds[2] < xmin || bounds[0] > xmax || bounds[3] < ymin || bounds[1] > ymax )
+                continue;
+
+            // Point of the face bounds nearest to the brush center.
+            float px = std::max((float)bounds[0], std::min((float)bounds[2], centerX));
+            float py = std::max((float)bounds[1], std::min((float)bounds[3], centerY));
+
+            if ( circle && (px - centerX)*(px - centerX) + (py - centerY)*(py - centerY) > radius*radius )
+                continue;
+
+            if ( isVisible(entry, px, py) )
+                faces->push_back(_entryFace[entry]);
+        }
+    }
+}
+
+void ProjectedFaceGrid::queryIds(float xmin, float ymin, float xmax, float ymax, bool circle,
+                                 std::vector<unsigned int> *faces) const
+{
+    int width = _camera.getWidth();
+    int height = _camera.getHeight();
+
+    float centerX = (xmin + xmax) / 2.0f;
+    float centerY = (ymin + ymax) / 2.0f;
+    float radius = (xmax - xmin) / 2.0f;
+
+    int column0 = std::max(0, (int)floor(xmin));
+    int column1 = std::min(width - 1, (int)ceil(xmax));
+    int row0 = std::max(0, (int)floor(ymin));
+    int row1 = std::min(height - 1, (int)ceil(ymax));
+
+    // Faces seen at the brush pixels, each face once.
+    unsigned int first = faces->size();
+    for ( int row = row0; row <= row1; ++row )
+    {
+        float dy = row + 0.5f - centerY;
+        const unsigned int *ids = &_idBuffer[row * width];
+        for ( int column = column0; column <= column1; ++column )
+        {
+            float dx = column + 0.5f - centerX;
+            if ( circle && dx*dx + dy*dy > radius*radius )
+                continue;
+
+            if ( ids[column] != 0 )
+                faces->push_back(ids[column] - 1);
+        }
+    }
+
+    std::sort(faces->begin() + first, faces->end());
+    faces->erase(std::unique(faces->begin() + first, faces->end()), faces->end());
+}
+
+void ProjectedFaceGrid::queryPolygon(const std::vector<float> &points, std::vector<unsigned int> *faces) const
+{
+    int width = _camera.getWidth();
+    int height = _camera.getHeight();
+    if ( !_built || points.size() < 6 || width <= 0 || height <= 0 )
+        return;
+
+    std::vector<unsigned char> mask(width * height, 0);
+    PolygonMaskKernel rasterize;
+    rasterize.points = &points[0];
+    rasterize.numPoints = points.size() / 2;
+    rasterize.width = width;
+    rasterize.mask = &mask[0];
+    parallelFor(height, rasterize, 16);
+
+    // Faces found by each range, merged at the end.
+    std::vector<ParallelRange> ranges;
+    std::vector< std::vector<unsigned int> > results;
+    if ( !_idBuffer.empty() )
+    {
+        ranges = parallelRanges(height, 16);
+        results.resize(ranges.size());
+
+        PolygonIdsKernel collect;
+        collect.ids = &_idBuffer[0];
+        collect.mask = &mask[0];
+        collect.width = width;
+        collect.results = results.empty() ? 0 : &results[0];
+        parallelMap(ranges, collect);
+    }
+    else
+    {
+        ranges = parallelRanges(_entryFace.size(), 4 * PARALLEL_GRAIN);
+        results.resize(ranges.size());
+
+        PolygonFacesKernel collect;
+        collect.entryFace = _entryFace.empty() ? 0 : &_entryFace[0];
+        collect.entryCentroid = _entryCentroid.empty() ? 0 : &_entryCentroid[0];
+        collect.entryDepth = _entryDepth.empty() ? 0 : &_entryDepth[0];
+        collect.depthBuffer = _depthBuffer.empty() ? 0 : &_depthBuffer[0];
+        collect.mask = &mask[0];
+        collect.width = width;
+        collect.height = height;
+        collect.results = results.empty() ? 0 : &results[0];
+        parallelMap(ranges, collect);
+    }
+
+    unsigned int first = faces->size();
+    for ( unsigned int r = 0; r < results.size(); ++r )
+        faces->insert(faces->end(), results[r].begin(), results[r].end());
+
+    std::sort(faces->begin() + first, faces->end());
+    faces->erase(std::unique(faces->begin() + first, faces->end()), faces->end());
+}
+
+void ProjectedFaceGrid::queryRect(float x, float y, float width, float height,
+                                  std::vector<unsigned int> *faces) const
+{
+    query(x - width / 2.0f, y - height / 2.0f, x + width / 2.0f, y + height / 2.0f, false, faces);
+}
+
+void ProjectedFaceGrid::queryCircle(float x, float y, float radius, std::vector<unsigned int> *faces) const
+{
+    query(x - radius, y - radius, x + radius, y + radius, true, faces);
+}
@@ -0,0 +1,169 @@
+#ifndef PROJECTEDFACEGRID_H
+#define PROJECTEDFACEGRID_H
+
+#include <vector>
+#include "model.h"
+#include "camera.h"
+#include "meshclusters.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The ProjectedFaceGrid class caches the model faces projected with one
+ * camera. Front-facing faces on screen are bucketed by the cell of their
+ * projected centroid in a 2D grid, so brush queries only visit a few
+ * cells. Faces bigger than a cell are kept in an extra bucket that is
+ * always visited. Faces of clusters culled by the camera are not
+ * projected. An optional depth buffer, captured with the same
+ * camera, rejects faces hidden behind other geometry. With an optional
+ * face id buffer, brushes take exactly the faces seen at their pixels.
+ */
+class ProjectedFaceGrid
+{
+private:
+
+    Camera _camera;                         /**< Camera used to build the grid. */
+    bool _built;                            /**< True when the grid is built. */
+    int _columns;                           /**< Grid columns. */
+    int _rows;                              /**< Grid rows. */
+
+    std::vector<unsigned int> _cellStart;   /**< First entry of each cell (last cell holds big faces). */
+    std::vector<unsigned int> _entryFace;   /**< Face index of each entry. */
+    std::vector<float> _entryCentroid;      /**< Projected centroid (x, y) of each entry. */
+    std::vector<short> _entryBounds;        /**< Screen bounds (xmin, ymin, xmax, ymax) of each entry. */
+    std::vector<float> _entryDepth;         /**< Eye depth of the nearest vertex of each entry. */
+
+    std::vector<float> _depthBuffer;        /**< Eye depth per pixel, top row first. */
+    std::vector<unsigned int> _idBuffer;    /**< Face index + 1 per pixel, top row first, 0 for background. */
+
+    /**
+     * @brief Return true if an entry is not hidden by the depth buffer.
+     * @param entry Entry index.
+     * @param x Horizontal sample position.
+     * @param y Vertical sample position.
+     */
+    bool isVisible(unsigned int entry, float x, float y) const;
+
+    /**
+     * @brief Collect the faces whose bounds pass a brush test.
+     * @param xmin Brush left limit.
+     * @param ymin Brush top limit.
+     * @param xmax Brush right limit.
+     * @param ymax Brush bottom limit.
+     * @param circle True for a circle inscribed in the limits, false for a rectangle.
+     * @param faces Result face list.
+     */
+    void query(float xmin, float ymin, float xmax, float ymax, bool circle,
+               std::vector<unsigned int> *faces) const;
+
+    /**
+     * @brief Collect the faces of the id buffer under a brush.
+     * @param xmin Brush left limit.
+     * @param ymin Brush top limit.
+     * @param xmax Brush right limit.
+     * @param ymax Brush bottom limit.
+     * @param circle True for a circle inscribed in the limits, false for a rectangle.
+     * @param faces Result face list.
+     */
+    void queryIds(float xmin, float ymin, float xmax, float ymax, bool circle,
+                  std::vector<unsigned int> *faces) const;
+
+public:
+
+    static const int CELL_SIZE = 16;             /**< Cell size in pixels. */
+    static const float DEPTH_TOLERANCE;          /**< Relative depth tolerance of the visibility test. */
+
+    /**
+     * @brief Default constructor.
+     */
+    ProjectedFaceGrid();
+
+    /**
+     * @brief Clear the grid.
+     */
+    void clear();
+
+    /**
+     * @brief Project the model faces with a camera and bucket them. Runs in parallel.
+     * @param model Model to project.
+     * @param camera Viewer camera.
+     * @param clusters If not null, faces are visited in cluster order.
+     * @param visible If not null, faces of clusters not visible are skipped.
+     */
+    void build(Model *model, const Camera &camera, const MeshClusters *clusters = 0,
+               const std::vector<unsigned char> *visible = 0);
+
+    /**
+     * @brief Set the depth buffer used by the visibility test.
+     * @param depth Window depth values as read by glReadPixels (bottom row first).
+     */
+    void setDepthBuffer(const std::vector<float> &depth);
+
+    /**
+     * @brief Set the face id buffer. Queries then return the faces seen at
+     * the brush pixels instead of testing projected faces.
+     * @param ids Face index + 1 per pixel, 0 for background (bottom row first).
+     */
+    void setIdBuffer(const std::vector<unsigned int> &ids);
+
+    /**
+     * @brief Get if queries use a face id buffer.
+     * @return True if an id buffer is set, false otherwise.
+     */
+    bool hasIdBuffer() const;
+
+    /**
+     * @brief Get if the grid is built for a camera.
+     * @param camera Viewer camera.
+     * @return True if grid can be queried with this camera, false otherwise.
+     */
+    bool isValid(const Camera &camera) const;
+
+    /**
+     * @brief Return the faces touched by a rectangle brush.
+     * @param x Brush center (horizontal).
+     * @param y Brush center (vertical).
+     * @param width Brush width.
+     * @param height Brush height.
+     * @param faces Faces are appended to this list.
+     */
+    void queryRect(float x, float y, float width, float height, std::vector<unsigned int> *faces) const;
+
+    /**
+     * @brief Return the faces touched by a circle brush.
+     * @param x Brush center (horizontal).
+     * @param y Brush center (vertical).
+     * @param radius Brush radius.
+     * @param faces Faces are appended to this list.
+     */
+    void queryCircle(float x, float y, float radius, std::vector<unsigned int> *faces) const;
+
+    /**
+     * @brief Return the faces whose projected centroid is inside a polygon,
+     * or the faces seen inside it if an id buffer is set. The polygon is
+     * rasterized once (even-odd rule), so each face costs a single lookup
+     * whatever the number of polygon points. Runs in parallel.
+     * @param points Polygon points (x, y), closed from the last to the first one.
+     * @param faces Faces are appended to this list, sorted and each face once.
+     */
+    void queryPolygon(const std::vector<float> &points, std::vector<unsigned int> *faces) const;
+
+};
+
+#endif // PROJECTEDFACEGRID_H
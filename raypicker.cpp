@@ -0,0 +1,279 @@
+#include "raypicker.h"
+
+#include <algorithm>
+#include <float.h>
+
+/**
+ * @brief Order faces by centroid along one axis.
+ */
+struct CentroidLess
+{
+    const std::vector<float> *centroids;
+    int axis;
+
+    bool operator()(unsigned int a, unsigned int b) const
+    {
+        return (*centroids)[a*3 + axis] < (*centroids)[b*3 + axis];
+    }
+};
+
+RayPicker::RayPicker()
+{
+    clear();
+}
+
+void RayPicker::clear()
+{
+    _model = 0;
+    _nodes.clear();
+    _faces.clear();
+}
+
+void RayPicker::swap(RayPicker &other)
+{
+    std::swap(_model, other._model);
+    _nodes.swap(other._nodes);
+    _faces.swap(other._faces);
+}
+
+bool RayPicker::isBuilt() const
+{
+    return !_nodes.empty();
+}
+
+void RayPicker::build(Model *model)
+{
+    clear();
+    _model = model;
+
+    unsigned int numFaces = model->numPoly();
+    if ( numFaces == 0 )
+        return;
+
+    // Face centroids and bounds.
+    std::vector<float> centroids(numFaces * 3, 0.0f);
+    std::vector<float> bounds(numFaces * 6, 0.0f);
+    for ( unsigned int i = 0; i < numFaces; ++i )
+    {
+        Poly *poly = model->getPolyAt(i);
+        float *min = &bounds[i*6];
+        float *max = &bounds[i*6 + 3];
+        float *centroid = &centroids[i*3];
+
+        for ( int j = 0; j < poly->size(); ++j )
+        {
+            Vertex *vertex = model->getVertexAt(poly->getAt(j));
+            float p[3] = { vertex->getX(), vertex->getY(), vertex->getZ() };
+            for ( int k = 0; k < 3; ++k )
+            {
+                if ( j == 0 || p[k] < min[k] )
+                    min[k] = p[k];
+                if ( j == 0 || p[k] > max[k] )
+                    max[k] = p[k];
+                centroid[k] += p[k];
+            }
+        }
+
+        if ( poly->size() > 0 )
+            for ( int k = 0; k < 3; ++k )
+                centroid[k] /= poly->size();
+    }
+
+    _faces.resize(numFaces);
+    for ( unsigned int i = 0; i < numFaces; ++i )
+        _faces[i] = i;
+
+    _nodes.reserve(2 * (numFaces / LEAF_SIZE + 1));
+    buildNode(0, numFaces, centroids, bounds);
+}
+
+unsigned int RayPicker::buildNode(unsigned int first, unsigned int last,
+                                  const std::vector<float> &centroids, const std::vector<float> &bounds)
+{
+    unsigned int index = _nodes.size();
+    _nodes.push_back(Node());
+
+    // Node bounds and centroid extent.
+    Node node;
+    float centroidMin[3], centroidMax[3];
+    for ( int k = 0; k < 3; ++k )
+    {
+        node.min[k] = centroidMin[k] = FLT_MAX;
+        node.max[k] = centroidMax[k] = -FLT_MAX;
+    }
+
+    for ( unsigned int i = first; i < last; ++i )
+    {
+        unsigned int face = _faces[i];
+        for ( int k = 0; k < 3; ++k )
+        {
+            node.min[k] = std::min(node.min[k], bounds[face*6 + k]);
+            node.max[k] = std::max(node.max[k], bounds[face*6 + 3 + k]);
+            centroidMin[k] = std::min(centroidMin[k], centroids[face*3 + k]);
+            centroidMax[k] = std::max(centroidMax[k], centroids[face*3 + k]);
+        }
+    }
+
+    if ( last - first <= LEAF_SIZE )
+    {
+        node.first = first;
+        node.count = last - first;
+        _nodes[index] = node;
+        return index;
+    }
+
+    // Split at the median of the longest centroid axis.
+    int axis = 0;
+    for ( int k = 1; k < 3; ++k )
+        if ( centroidMax[k] - centroidMin[k] > centroidMax[axis] - centroidMin[axis] )
+            axis = k;
+
+    unsigned int middle = first + (last - first) / 2;
+    CentroidLess less;
+    less.centroids = &centroids;
+    less.axis = axis;
+    std::nth_element(_faces.begin() + first, _faces.begin() + middle, _faces.begin() + last, less);
+
+    buildNode(first, middle, centroids, bounds);
+    node.first = buildNode(middle, last, centroids, bounds);
+    node.count = 0;
+    _nodes[index] = node;
+
+    return index;
+}
+
+/**
+ * @brief Ray / box slab test.
+ * @return Entry distance, or FLT_MAX if box is missed.
+ */
+static float intersectBox(const float min[3], const float max[3], const float origin[3], const float inverse[3])
+{
+    float tmin = 0.0f, tmax = FLT_MAX;
+    for ( int k = 0; k < 3; ++k )
+    {
+        float t1 = (min[k] - origin[k]) * inverse[k];
+        float t2 = (max[k] - origin[k]) * inverse[k];
+        if ( t1 > t2 )
+            std::swap(t1, t2);
+        tmin = std::max(tmin, t1);
+        tmax = std::min(tmax, t2);
+        if ( tmin > tmax )
+            return FLT_MAX;
+    }
+
+    return tmin;
+}
+
+bool RayPicker::intersectFace(unsigned int face, const float origin[3], const float direction[3],
+                              bool cullBackFaces, float *distance) const
+{
+    const float epsilon = 1e-12f;
+    bool hit = false;
+
+    Poly *poly = _model->getPolyAt(face);
+    if ( poly->size() < 3 )
+        return false;
+
+    Vertex *v0 = _model->getVertexAt(poly->getAt(0));
+    float p0[3] = { v0->getX(), v0->getY(), v0->getZ() };
+
+    // Polygons are drawn as a triangle fan.
+    for ( int i = 1; i + 1 < poly->size(); ++i )
+    {
+        Vertex *v1 = _model->getVertexAt(poly->getAt(i));
+        Vertex *v2 = _model->getVertexAt(poly->getAt(i+1));
+        float e1[3] = { v1->getX() - p0[0], v1->getY() - p0[1], v1->getZ() - p0[2] };
+        float e2[3] = { v2->getX() - p0[0], v2->getY() - p0[1], v2->getZ() - p0[2] };
+
+        float p[3] = { direction[1]*e2[2] - direction[2]*e2[1],
+                       direction[2]*e2[0] - direction[0]*e2[2],
+                       direction[0]*e2[1] - direction[1]*e2[0] };
+        float det = e1[0]*p[0] + e1[1]*p[1] + e1[2]*p[2];
+
+        // det > 0 means counter-clockwise on screen, i.e. a front face.
+        if ( cullBackFaces ? det <= epsilon : fabs(det) <= epsilon )
+            continue;
+
+        float inverse = 1.0f / det;
+        float t[3] = { origin[0] - p0[0], origin[1] - p0[1], origin[2] - p0[2] };
+        float u = (t[0]*p[0] + t[1]*p[1] + t[2]*p[2]) * inverse;
+        if ( u < 0.0f || u > 1.0f )
+            continue;
+
+        float q[3] = { t[1]*e1[2] - t[2]*e1[1],
+                       t[2]*e1[0] - t[0]*e1[2],
+                       t[0]*e1[1] - t[1]*e1[0] };
+        float v = (direction[0]*q[0] + direction[1]*q[1] + direction[2]*q[2]) * inverse;
+        if ( v < 0.0f || u + v > 1.0f )
+            continue;
+
+        float d = (e2[0]*q[0] + e2[1]*q[1] + e2[2]*q[2]) * inverse;
+        if ( d > 0.0f && d < *distance )
+        {
+            *distance = d;
+            hit = true;
+        }
+    }
+
+    return hit;
+}
+
+int RayPicker::intersect(const float origin[3], const float direction[3], bool cullBackFaces,
+                         float *distance) const
+{
+    if ( _nodes.empty() )
+        return -1;
+
+    float inverse[3];
+    for ( int k = 0; k < 3; ++k )
+        inverse[k] = direction[k] != 0.0f ? 1.0f / direction[k] : FLT_MAX;
+
+    int result = -1;
+    float best = FLT_MAX;
+
+    unsigned int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+
+    while ( top > 0 )
+    {
+        const Node &node = _nodes[stack[--top]];
+        if ( intersectBox(node.min, node.max, origin, inverse) >= best )
+            continue;
+
+        if ( node.count > 0 )
+        {
+            for ( unsigned int i = node.first; i < node.first + node.count; ++i )
+                if ( intersectFace(_faces[i], origin, direction, cullBackFaces, &best) )
+                    result = _faces[i];
+        }
+        else
+        {
+            // Visit the nearest child first.
+            unsigned int left = &node - &_nodes[0] + 1;
+            unsigned int right = node.first;
+            float leftDistance = intersectBox(_nodes[left].min, _nodes[left].max, origin, inverse);
+            float rightDistance = intersectBox(_nodes[right].min, _nodes[right].max, origin, inverse);
+
+            if ( leftDistance < rightDistance )
+                std::swap(left, right);
+
+            stack[top++] = left;
+            stack[top++] = right;
+        }
+    }
+
+    if ( distance != 0 )
+        *distance = best;
+
+    return result;
+}
+
+int RayPicker::pick(const Camera &camera, int x, int y) const
+{
+    float origin[3], direction[3];
+    if ( !camera.getRay(x, y, origin, direction) )
+        return -1;
+
+    return intersect(origin, direction, true);
+}
@@ -0,0 +1,130 @@
+#ifndef RAYPICKER_H
+#define RAYPICKER_H
+
+#include <vector>
+#include "model.h"
+#include "camera.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The RayPicker class finds the face under a viewer position without
+ * OpenGL. Faces are stored in a bounding volume hierarchy, and a ray built
+ * from the camera is traversed front to back. Once built, picking only
+ * reads the model, so it can be used from any thread.
+ */
+class RayPicker
+{
+private:
+
+    /**
+     * @brief Hierarchy node. Leaves have count > 0 and reference the
+     * faces [first, first + count) of the face list. Inner nodes have
+     * count == 0, the left child next to them and the right child at first.
+     */
+    struct Node
+    {
+        float min[3];
+        float max[3];
+        unsigned int first;
+        unsigned int count;
+    };
+
+    Model* _model;                       /**< Model used to build the hierarchy. */
+    std::vector<Node> _nodes;            /**< Hierarchy nodes, root first. */
+    std::vector<unsigned int> _faces;    /**< Face indices sorted by leaf. */
+
+    /**
+     * @brief Build a node over faces [first, last) of the face list.
+     * @param first First face.
+     * @param last Last face (not included).
+     * @param centroids Face centroids (3 floats per face).
+     * @param bounds Face bounds (6 floats per face: min, max).
+     * @return Index of the new node.
+     */
+    unsigned int buildNode(unsigned int first, unsigned int last,
+                           const std::vector<float> &centroids, const std::vector<float> &bounds);
+
+    /**
+     * @brief Intersect a ray with a face (triangle fan).
+     * @param face Face index.
+     * @param origin Ray origin.
+     * @param direction Ray direction.
+     * @param cullBackFaces True to ignore back faces.
+     * @param distance Distance to hit, updated only if closer.
+     * @return True if face was hit closer than distance.
+     */
+    bool intersectFace(unsigned int face, const float origin[3], const float direction[3],
+                       bool cullBackFaces, float *distance) const;
+
+public:
+
+    static const unsigned int LEAF_SIZE = 4;    /**< Maximum faces per leaf. */
+
+    /**
+     * @brief Default constructor.
+     */
+    RayPicker();
+
+    /**
+     * @brief Build the hierarchy for a model.
+     * @param model Model to pick.
+     */
+    void build(Model *model);
+
+    /**
+     * @brief Clear the hierarchy.
+     */
+    void clear();
+
+    /**
+     * @brief Exchange the hierarchy with another picker.
+     * @param other Picker to exchange with.
+     */
+    void swap(RayPicker &other);
+
+    /**
+     * @brief Get if the hierarchy was built.
+     * @return True if built, false otherwise.
+     */
+    bool isBuilt() const;
+
+    /**
+     * @brief Return the front-most face hit by a ray.
+     * @param origin Ray origin.
+     * @param direction Normalized ray direction.
+     * @param cullBackFaces True to ignore back faces (as picking with GL_CULL_FACE).
+     * @param distance If not null, distance from origin to hit.
+     * @return Face index, or -1 if no face was hit.
+     */
+    int intersect(const float origin[3], const float direction[3], bool cullBackFaces = true,
+                  float *distance = 0) const;
+
+    /**
+     * @brief Return the front-most face under a viewer position.
+     * @param camera Viewer camera.
+     * @param x Horizontal mouse position.
+     * @param y Vertical mouse position.
+     * @return Face index, or -1 if no face was hit.
+     */
+    int pick(const Camera &camera, int x, int y) const;
+
+};
+
+#endif // RAYPICKER_H
@@ -0,0 +1,127 @@
+#include "regiongrow.h"
+
+#include <algorithm>
+#include <cmath>
+
+RegionGrow::RegionGrow()
+{
+    _adjacency = 0;
+    _criterion = DIHEDRAL_ANGLE;
+    _seed = 0;
+}
+
+void RegionGrow::clear()
+{
+    _adjacency = 0;
+    std::vector<float>().swap(_level);
+    std::vector<unsigned char>().swap(_settled);
+    _front = std::priority_queue<Front>();
+    std::vector<unsigned int>().swap(_order);
+    std::vector<float>().swap(_orderLevel);
+}
+
+void RegionGrow::start(const FaceAdjacency *adjacency, unsigned int seed, GrowCriterion criterion)
+{
+    clear();
+    if ( seed >= adjacency->numFaces() )
+        return;
+
+    _adjacency = adjacency;
+    _criterion = criterion;
+    _seed = seed;
+    _level.assign(adjacency->numFaces(), HUGE_VAL);
+    _settled.assign(adjacency->numFaces(), 0);
+
+    Front front;
+    front.level = 0.0;
+    front.face = seed;
+    _level[seed] = 0.0;
+    _front.push(front);
+}
+
+bool RegionGrow::isActive() const
+{
+    return _adjacency != 0;
+}
+
+unsigned int RegionGrow::getSeed() const
+{
+    return _seed;
+}
+
+unsigned int RegionGrow::grow(float threshold)
+{
+    if ( !_adjacency )
+        return 0;
+
+    const float *seedNormal = _adjacency->getNormal(_seed);
+
+    // Settle the front up to the threshold. Settled levels never decrease.
+    while ( !_front.empty() && _front.top().level <= threshold )
+    {
+        Front top = _front.top();
+        _front.pop();
+        if ( _settled[top.face] )
+            continue;
+
+        _settled[top.face] = 1;
+        _order.push_back(top.face);
+        _orderLevel.push_back(top.level);
+
+        for ( unsigned int i = _adjacency->first(top.face); i < _adjacency->last(top.face); ++i )
+        {
+            unsigned int neighbor = _adjacency->getNeighbor(i);
+            if ( _settled[neighbor] )
+                continue;
+
+            // A path is as good as its worst step.
+            float step;
+            if ( _criterion == DIHEDRAL_ANGLE )
+                step = _adjacency->getAngle(i);
+            else
+            {
+                const float *n = _adjacency->getNormal(neighbor);
+                float cosine = n[0]*seedNormal[0] + n[1]*seedNormal[1] + n[2]*seedNormal[2];
+                step = acos(std::max(-1.0f, std::min(1.0f, cosine)));
+            }
+
+            float level = std::max(top.level, step);
+            if ( level < _level[neighbor] )
+            {
+                _level[neighbor] = level;
+                Front front;
+                front.level = level;
+                front.face = neighbor;
+                _front.push(front);
+            }
+        }
+    }
+
+    // Lower thresholds are a prefix of the settled faces.
+    return std::upper_bound(_orderLevel.begin(), _orderLevel.end(), threshold) - _orderLevel.begin();
+}
+
+unsigned int RegionGrow::getFace(unsigned int index) const
+{
+    return _order[index];
+}
+
+void RegionGrow::insert(unsigned int begin, unsigned int end, FaceSelection *selection) const
+{
+    if ( begin >= end )
+        return;
+
+    std::vector<unsigned int> faces(_order.begin() + begin, _order.begin() + end);
+    std::sort(faces.begin(), faces.end());
+    selection->insert(faces);
+}
+
+void RegionGrow::remove(unsigned int begin, unsigned int end, FaceSelection *selection) const
+{
+    if ( begin >= end )
+        return;
+
+    std::vector<unsigned int> faces(_order.begin() + begin, _order.begin() + end);
+    std::sort(faces.begin(), faces.end());
+    selection->remove(faces);
+}
@@ -0,0 +1,138 @@
+#ifndef REGIONGROW_H
+#define REGIONGROW_H
+
+#include <queue>
+#include <vector>
+#include "faceadjacency.h"
+#include "faceselection.h"
+
+/**
+ * @brief The GrowCriterion enum represents which angle limits a region:
+ * DIHEDRAL_ANGLE: Angle between the normals of adjacent faces.
+ * SEED_NORMAL: Angle between the normal of each face and the seed normal.
+ */
+enum GrowCriterion {
+    DIHEDRAL_ANGLE,
+    SEED_NORMAL
+};
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The RegionGrow class floods a region of faces from a seed face, across
+ * adjacent faces, while the angle of the criterion stays under a
+ * threshold. The level of a face is the lowest threshold that reaches it:
+ * faces are settled in increasing level order with a priority queue, so
+ * the region of any threshold is a prefix of the settled faces. Raising
+ * the threshold resumes the flood from the current front, and lowering it
+ * only shortens the prefix.
+ */
+class RegionGrow
+{
+private:
+
+    /**
+     * @brief A face of the front and the level it is reached with.
+     */
+    struct Front
+    {
+        float level;
+        unsigned int face;
+
+        bool operator<(const Front &other) const
+        {
+            return level > other.level;     // Lowest level on top.
+        }
+    };
+
+    const FaceAdjacency *_adjacency;    /**< Adjacency of the model. */
+    GrowCriterion _criterion;           /**< Angle limiting the region. */
+    unsigned int _seed;                 /**< Seed face. */
+    std::vector<float> _level;          /**< Best level found for each face. */
+    std::vector<unsigned char> _settled;  /**< 1 for faces with a final level. */
+    std::priority_queue<Front> _front;  /**< Faces reached but not settled. */
+    std::vector<unsigned int> _order;   /**< Settled faces, in increasing level. */
+    std::vector<float> _orderLevel;     /**< Level of each settled face. */
+
+public:
+
+    /**
+     * @brief Default constructor. No region.
+     */
+    RegionGrow();
+
+    /**
+     * @brief Start a new region.
+     * @param adjacency Adjacency of the model. Must outlive the region.
+     * @param seed Seed face.
+     * @param criterion Angle limiting the region.
+     */
+    void start(const FaceAdjacency *adjacency, unsigned int seed, GrowCriterion criterion);
+
+    /**
+     * @brief Drop the region.
+     */
+    void clear();
+
+    /**
+     * @brief Get if there is a region.
+     * @return True if a region was started, false otherwise.
+     */
+    bool isActive() const;
+
+    /**
+     * @brief Return the seed face.
+     * @return Face index.
+     */
+    unsigned int getSeed() const;
+
+    /**
+     * @brief Return the number of faces of the region under a threshold,
+     * flooding further if needed.
+     * @param threshold Maximum angle (radians).
+     * @return Number of faces. The region is the first ones of getFace.
+     */
+    unsigned int grow(float threshold);
+
+    /**
+     * @brief Return a face of the region, in increasing level.
+     * @param index Index, less than the value returned by grow.
+     * @return Face index.
+     */
+    unsigned int getFace(unsigned int index) const;
+
+    /**
+     * @brief Add faces of the region to a selection.
+     * @param begin First index.
+     * @param end Last index (not included).
+     * @param selection Selection to modify.
+     */
+    void insert(unsigned int begin, unsigned int end, FaceSelection *selection) const;
+
+    /**
+     * @brief Remove faces of the region from a selection.
+     * @param begin First index.
+     * @param end Last index (not included).
+     * @param selection Selection to modify.
+     */
+    void remove(unsigned int begin, unsigned int end, FaceSelection *selection) const;
+
+};
+
+#endif // REGIONGROW_H
@@ -0,0 +1,521 @@
+#include "renderthread.h"
+
+#include <stdlib.h>
+#include <QElapsedTimer>
+#include <QFont>
+#include <QFontMetrics>
+#include <QImage>
+#include <QPainter>
+#include <QStringList>
+
+RenderState::RenderState()
+{
+    renderMode = SOLID;
+    cameraMoving = false;
+    showSelection = false;
+    showOutline = false;
+    showAllOutlines = false;
+    showStats = false;
+    showAllBookmarks = false;
+    captureDepth = false;
+    captureIds = false;
+}
+
+RenderThread::RenderThread(QGLWidget *widget) : QThread(widget)
+{
+    _widget = widget;
+    _pendingState.fetchAndStoreOrdered(0);
+    _depthFrame.fetchAndStoreOrdered(0);
+    _stop.fetchAndStoreOrdered(0);
+
+    _listIndex = 0;
+    _listCount = 0;
+    _compiledClusters = 0;
+    _compiledIdClusters = 0;
+    _idsSupported = false;
+    _compileTime = 0;
+    _depthCaptured = false;
+    _depthIds = false;
+}
+
+RenderThread::~RenderThread()
+{
+    delete _pendingState.fetchAndStoreOrdered(0);
+    delete _depthFrame.fetchAndStoreOrdered(0);
+}
+
+void RenderThread::publish(RenderState *state)
+{
+    delete _pendingState.fetchAndStoreOrdered(state);
+    _wake.release();
+}
+
+DepthFrame* RenderThread::takeDepthFrame()
+{
+    return _depthFrame.fetchAndStoreOrdered(0);
+}
+
+void RenderThread::stop()
+{
+    _stop.fetchAndStoreOrdered(1);
+    _wake.release();
+}
+
+void RenderThread::run()
+{
+    _widget->makeCurrent();
+    GLScene::initialize();
+
+    // Face ids are drawn as 24 bit colors.
+    GLint redBits = 0, greenBits = 0, blueBits = 0;
+    glGetIntegerv(GL_RED_BITS, &redBits);
+    glGetIntegerv(GL_GREEN_BITS, &greenBits);
+    glGetIntegerv(GL_BLUE_BITS, &blueBits);
+    _idsSupported = redBits >= 8 && greenBits >= 8 && blueBits >= 8;
+
+    while ( true )
+    {
+        // Sleep until a new state arrives, unless display lists are compiling.
+        if ( !isCompiling() )
+            _wake.acquire();
+        _wake.tryAcquire(_wake.available());
+
+        if ( _stop.fetchAndAddOrdered(0) )
+            break;
+
+        RenderState *state = _pendingState.fetchAndStoreOrdered(0);
+        if ( state )
+        {
+            _state = *state;
+            delete state;
+        }
+
+        updateScene();
+        drawFrame();
+
+        if ( isCompiling() )
+            compileDisplayLists();
+        else if ( _state.captureDepth && _listScene && _listScene->model->isLoaded()
+                  && (!_depthCaptured || _depthCamera != _state.camera || _depthIds != _state.captureIds) )
+            captureDepth();
+    }
+
+    glDeleteLists(_listIndex, _listCount);
+    _labelMesh.clear();
+    _listScene.clear();
+    _widget->doneCurrent();
+}
+
+bool RenderThread::isCompiling() const
+{
+    if ( !_listScene )
+        return false;
+
+    unsigned int numClusters = _listScene->clusters.size();
+    return _compiledClusters < numClusters || (drawsIds() && _compiledIdClusters < numClusters);
+}
+
+bool RenderThread::drawsIds() const
+{
+    return _state.captureIds && _idsSupported && _listScene && _listScene->model->numPoly() <= MAX_ID_FACES;
+}
+
+void RenderThread::updateScene()
+{
+    if ( _state.scene == _listScene )
+        return;
+
+    glDeleteLists(_listIndex, _listCount);
+    _labelMesh.clear();
+    _listScene = _state.scene;
+    _listIndex = 0;
+    _listCount = 0;
+    _compiledClusters = 0;
+    _compiledIdClusters = 0;
+    _compileTime = 0;
+    _frameCost.clear();
+    _depthCaptured = false;
+
+    if ( !_listScene )
+        return;
+
+    _listCount = 2 * _listScene->clusters.size();
+    if ( _listCount > 0 )
+        _listIndex = glGenLists(_listCount);
+    _frameCost.assign(_listScene->lod.size() + 1, 0.0);
+}
+
+void RenderThread::compileDisplayLists()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    Model *model = _listScene->model.data();
+    const MeshClusters &clusters = _listScene->clusters;
+    unsigned int numClusters = clusters.size();
+
+    // Face ids, drawn as colors by depth captures.
+    if ( _compiledClusters == numClusters )
+    {
+        for ( ; _compiledIdClusters < numClusters && timer.elapsed() < COMPILE_BUDGET; ++_compiledIdClusters )
+        {
+            unsigned int c = _compiledIdClusters;
+            unsigned int first = clusters.firstFace(c);
+            unsigned int last = first + clusters.clusterSize(c);
+
+            glNewList(_listIndex + numClusters + c, GL_COMPILE);
+                for ( unsigned int i = first; i < last; ++i )
+                {
+                    unsigned int id = clusters.getFace(i) + 1;
+                    glColor3ub(id & 0xff, (id >> 8) & 0xff, (id >> 16) & 0xff);
+                    GLScene::drawPoly( model, model->getPolyAt(clusters.getFace(i)), false );
+                }
+            glEndList();
+        }
+        return;
+    }
+
+    // Wire is drawn from the unique edges, only faces are compiled.
+    for ( ; _compiledClusters < numClusters && timer.elapsed() < COMPILE_BUDGET; ++_compiledClusters )
+    {
+        unsigned int c = _compiledClusters;
+        unsigned int first = clusters.firstFace(c);
+        unsigned int last = first + clusters.clusterSize(c);
+
+        glNewList(_listIndex + c, GL_COMPILE);
+            glColor3f(0.44, 0.6, 0.95);   // Set model color.
+            for ( unsigned int i = first; i < last; ++i )
+                GLScene::drawPoly( model, model->getPolyAt(clusters.getFace(i)), false );
+        glEndList();
+    }
+
+    _compileTime += timer.nsecsElapsed();
+    if ( _compiledClusters == numClusters )
+    {
+        Profiler::instance()->record(Profiler::LOAD_DISPLAY_LISTS, _compileTime);
+        emit sceneCompiled();
+    }
+}
+
+void RenderThread::drawFrame()
+{
+    ScopedProbe frameProbe(Profiler::FRAME_TIME);
+    QElapsedTimer timer;
+    timer.start();
+
+    Model *model = _listScene ? _listScene->model.data() : 0;
+    bool labeled = _state.showAllBookmarks && _state.labels;
+    int level = (_listScene && _state.cameraMoving && !labeled) ? chooseLodLevel() : -1;
+
+    GLScene::loadCamera(_state.camera);
+    GLScene::setRenderMode(_state.renderMode);
+
+    // Clear buffers.
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if ( model && model->isLoaded() )
+    {
+        // Draw current selection.
+        if ( _state.showSelection && _state.showOutline )
+        {
+            QVector<FaceSelection> outlines;
+            outlines.append(_state.outline);
+            drawOutlines(outlines, 0);
+        }
+        else if ( _state.showSelection && !_state.selection.isEmpty() )
+        {
+            ScopedProbe selectionProbe(Profiler::SELECTION_OVERLAY);
+            glColor3f(0.5, 1.0, 0.5);
+
+            FaceSelection::const_iterator it = _state.selection.begin();
+            for (;it != _state.selection.end(); ++it)
+                GLScene::drawPoly( model, model->getPolyAt(*it), false );
+        }
+
+        // Draw visible part of the model. Back faces are seen through in points and wire modes.
+        if ( labeled )
+        {
+            // Whole model colored by bookmark, in one call.
+            if ( _labelMesh.getModel() != model )
+                _labelMesh.build(model);
+            _labelMesh.update(_state.labels);
+            _labelMesh.draw();
+        }
+        else if ( level >= 0 )
+            _listScene->lod.draw(level);
+        else
+            drawModel(_state.renderMode != WIRED, _state.renderMode == WIRED || _state.renderMode == SOLID_WIRE,
+                      _state.renderMode == SOLID || _state.renderMode == SOLID_WIRE);
+    }
+
+    if ( model && model->isLoaded() && _state.showAllOutlines )
+        drawOutlines(_state.outlines, 1);
+
+    if ( !_state.preview.isEmpty() )
+        drawPreview();
+
+    if ( !_state.lasso.isEmpty() )
+        drawLasso();
+
+    if ( _state.showStats )
+        drawStats();
+
+    _widget->swapBuffers();
+
+    // Frames of a partially compiled model do not measure its cost.
+    unsigned int index = level + 1;
+    if ( index < _frameCost.size() && !labeled && (level >= 0 || !isCompiling()) )
+    {
+        double cost = timer.nsecsElapsed();
+        _frameCost[index] = _frameCost[index] > 0.0 ? 0.75 * _frameCost[index] + 0.25 * cost : cost;
+    }
+}
+
+void RenderThread::drawModel(bool solid, bool wire, bool cullBackFaces)
+{
+    const MeshClusters &clusters = _listScene->clusters;
+    clusters.cull(_state.camera, cullBackFaces, &_visibleClusters);
+
+    // Clusters still compiling are not drawn yet.
+    if ( solid )
+        for ( unsigned int c = 0; c < _compiledClusters; ++c )
+            if ( _visibleClusters[c] )
+                glCallList(_listIndex + c);
+
+    // Each edge once, in a few calls.
+    if ( wire )
+    {
+        if ( solid )
+            glColor3f(1.0, 1.0, 1.0);     // Set wire color.
+        else
+            glColor3f(0.44, 0.6, 0.95);   // Set model color.
+        _listScene->edges.draw(_visibleClusters);
+    }
+}
+
+void RenderThread::drawPreview()
+{
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glColor3f(0.44, 0.6, 0.95);   // Set model color.
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, _state.preview.constData());
+    glDrawArrays(GL_POINTS, 0, _state.preview.size() / 3);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glPopAttrib();
+}
+
+void RenderThread::drawStats()
+{
+    // Previous frames statistics, this frame is still running.
+    if ( _statsImage.isNull() || !_statsTimer.isValid() || _statsTimer.elapsed() >= STATS_INTERVAL )
+    {
+        _statsTimer.start();
+        _statsImage = QImage();
+
+        QStringList lines = Profiler::instance()->report().split("\n", QString::SkipEmptyParts);
+        if ( lines.isEmpty() )
+            return;
+
+        // Text is painted in an image, widget painting belongs to the GUI thread.
+        QFont font;
+        QFontMetrics metrics(font);
+        int width = 0;
+        for ( int i = 0; i < lines.size(); ++i )
+            width = qMax(width, metrics.width(lines[i]));
+
+        QImage image(width + 20, lines.size() * 15 + 10, QImage::Format_ARGB32);
+        image.fill(0);
+        QPainter painter(&image);
+        painter.setFont(font);
+        painter.setPen(Qt::black);
+        for ( int i = 0; i < lines.size(); ++i )
+            painter.drawText(10, 20 + i * 15, lines[i]);
+        painter.end();
+        _statsImage = QGLWidget::convertToGLFormat(image);
+    }
+
+    if ( _statsImage.isNull() )
+        return;
+
+    int viewWidth = _state.camera.getWidth();
+    int viewHeight = _state.camera.getHeight();
+
+    glPushAttrib(GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glViewport(0, 0, viewWidth, viewHeight);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, viewWidth, 0, viewHeight, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glRasterPos2i(0, qMax(0, viewHeight - _statsImage.height()));
+    glDrawPixels(_statsImage.width(), _statsImage.height(), GL_RGBA, GL_UNSIGNED_BYTE, _statsImage.bits());
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+}
+
+void RenderThread::drawOutlines(const QVector<FaceSelection> &outlines, unsigned short first)
+{
+    if ( !_listScene )
+        return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_LINE_BIT | GL_DEPTH_BUFFER_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glDepthFunc(GL_LEQUAL);
+    glLineWidth(OUTLINE_WIDTH);
+
+    for ( int i = 0; i < outlines.size(); ++i )
+    {
+        if ( first == 0 )
+            glColor3f(0.5, 1.0, 0.5);     // Selection color.
+        else
+        {
+            unsigned char rgb[3];
+            BookmarkLabels::labelColor(first + i, rgb);
+            glColor3ub(rgb[0], rgb[1], rgb[2]);
+        }
+        _listScene->edges.drawEdges(outlines[i]);
+    }
+
+    glPopAttrib();
+}
+
+void RenderThread::drawLasso()
+{
+    int viewWidth = _state.camera.getWidth();
+    int viewHeight = _state.camera.getHeight();
+
+    glPushAttrib(GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glViewport(0, 0, viewWidth, viewHeight);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, viewWidth, 0, viewHeight, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    // Widget y axis points down.
+    glColor3f(1.0, 0.8, 0.2);
+    glBegin(GL_LINE_LOOP);
+    for ( int i = 0; i < _state.lasso.size(); ++i )
+        glVertex2f(_state.lasso[i].x() + 0.5f, viewHeight - _state.lasso[i].y() - 0.5f);
+    glEnd();
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+}
+
+void RenderThread::captureDepth()
+{
+    ScopedProbe probe(Profiler::FACE_GRID);
+
+    int width = _state.camera.getWidth();
+    int height = _state.camera.getHeight();
+    bool ids = drawsIds();
+
+    // Render the model filled to get the depth of the visible surface.
+    glPushAttrib(GL_POLYGON_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    if ( ids )
+    {
+        // Exact colors: no lighting, dithering or sample blending, black background.
+        glDisable(GL_LIGHTING);
+        glDisable(GL_DITHER);
+        glDisable(GL_MULTISAMPLE);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    GLScene::loadCamera(_state.camera);
+    if ( ids )
+    {
+        // Same pass draws ids instead of shaded faces.
+        unsigned int numClusters = _listScene->clusters.size();
+        _listScene->clusters.cull(_state.camera, true, &_visibleClusters);
+        for ( unsigned int c = 0; c < numClusters; ++c )
+            if ( _visibleClusters[c] )
+                glCallList(_listIndex + numClusters + c);
+    }
+    else
+        drawModel(true, false, true);
+    glPopAttrib();
+
+    DepthFrame *frame = new DepthFrame();
+    frame->camera = _state.camera;
+    frame->captureIds = _state.captureIds;
+    frame->depth.resize(width * height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, &frame->depth[0]);
+
+    if ( ids )
+    {
+        std::vector<unsigned char> colors(width * height * 3);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &colors[0]);
+
+        frame->ids.resize(width * height);
+        for ( unsigned int i = 0; i < frame->ids.size(); ++i )
+            frame->ids[i] = colors[3*i] | (colors[3*i + 1] << 8) | (colors[3*i + 2] << 16);
+    }
+
+    _depthCamera = _state.camera;
+    _depthCaptured = true;
+    _depthIds = _state.captureIds;
+
+    delete _depthFrame.fetchAndStoreOrdered(frame);
+    emit depthReady();
+}
+
+unsigned int RenderThread::levelFaces(int level) const
+{
+    return level < 0 ? _listScene->model->numPoly() : _listScene->lod.numFaces(level);
+}
+
+double RenderThread::estimateFrameCost(int level) const
+{
+    int index = level + 1;
+    if ( index >= (int)_frameCost.size() )
+        return 0.0;
+    if ( _frameCost[index] > 0.0 )
+        return _frameCost[index];
+
+    // Scale the nearest measured level.
+    int nearest = -1;
+    for ( int i = 0; i < (int)_frameCost.size(); ++i )
+        if ( _frameCost[i] > 0.0 && (nearest < 0 || abs(i - index) < abs(nearest - index)) )
+            nearest = i;
+
+    if ( nearest < 0 || levelFaces(nearest - 1) == 0 )
+        return 0.0;
+
+    return _frameCost[nearest] * levelFaces(level) / levelFaces(nearest - 1);
+}
+
+int RenderThread::chooseLodLevel() const
+{
+    double target = TARGET_FRAME_TIME * 1000000.0;
+    for ( int level = -1; level < (int)_listScene->lod.size(); ++level )
+        if ( estimateFrameCost(level) <= target )
+            return level;
+
+    return (int)_listScene->lod.size() - 1;
+}
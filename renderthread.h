@@ -0,0 +1,274 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <vector>
+#include <QThread>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QSemaphore>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QSharedPointer>
+#include <QVector>
+#include <QPoint>
+#include <QGLWidget>
+#include "glscene.h"
+#include "meshclusters.h"
+#include "lodmesh.h"
+#include "meshedges.h"
+#include "faceselection.h"
+#include "labelmesh.h"
+#include "bookmarklabels.h"
+#include "profiler.h"
+
+/**
+ * @brief Model geometry shared by the GUI and render threads. It is not
+ * modified once published, a new model is published as a new scene.
+ */
+struct RenderScene
+{
+    QSharedPointer<Model> model;     /**< 3D model. */
+    MeshClusters clusters;           /**< Spatial clusters of model faces. */
+    LodMesh lod;                     /**< Reduced models drawn while the camera moves. */
+    MeshEdges edges;                 /**< Unique edges drawn in wire modes. */
+};
+
+/**
+ * @brief Snapshot of the viewer state needed to draw one frame.
+ */
+struct RenderState
+{
+    QSharedPointer<RenderScene> scene;                          /**< Geometry to draw. */
+    Camera camera;                                              /**< Viewer camera and viewport size. */
+    RenderMode renderMode;                                      /**< Render mode. */
+    bool cameraMoving;                                          /**< True to draw a reduced model if the full one is slow. */
+    bool showSelection;                                         /**< True to draw the selection. */
+    FaceSelection selection;                                    /**< Selected faces, shared with the viewer. */
+    bool showOutline;                                           /**< True to draw the selection outline instead of its faces. */
+    FaceSelection outline;                                      /**< Boundary edges of the selection. */
+    bool showAllOutlines;                                       /**< True to draw the outline of every bookmark. */
+    QVector<FaceSelection> outlines;                            /**< Boundary edges of each bookmark, from bookmark 1. */
+    QVector<float> preview;                                     /**< Points shown while the model loads. */
+    bool showStats;                                             /**< True to draw the performance overlay. */
+    bool showAllBookmarks;                                      /**< True to color faces by bookmark. */
+    QSharedPointer<const FaceLabels> labels;                    /**< Bookmark label of each face. */
+    QVector<QPoint> lasso;                                      /**< Lasso outline in widget coordinates, empty if none. */
+    bool captureDepth;                                          /**< True to capture the depth buffer of this camera. */
+    bool captureIds;                                            /**< True to capture face ids with the depth. */
+
+    /**
+     * @brief Default constructor.
+     */
+    RenderState();
+};
+
+/**
+ * @brief Depth of the visible surface, captured by the render thread.
+ */
+struct DepthFrame
+{
+    Camera camera;                 /**< Camera of the capture. */
+    std::vector<float> depth;      /**< Window depth values as read by glReadPixels (bottom row first). */
+    bool captureIds;               /**< True if face ids were asked for. */
+    std::vector<unsigned int> ids; /**< Face index + 1 per pixel (bottom row first), empty if not captured. */
+};
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The RenderThread class owns the GL context of a viewer and does all
+ * its GL work: drawing, display list compilation and depth capture.
+ * The GUI thread publishes RenderState snapshots through an atomic
+ * pointer; only the latest one is drawn and the GUI never waits for the
+ * render thread. Depth captures, with face ids when asked for, go back
+ * the same way, announced by the depthReady signal.
+ */
+class RenderThread : public QThread
+{
+    Q_OBJECT
+
+private:
+
+    QGLWidget *_widget;                          /**< Widget owning the GL context. */
+    QAtomicPointer<RenderState> _pendingState;   /**< Latest published state, null if drawn. */
+    QAtomicPointer<DepthFrame> _depthFrame;      /**< Latest depth capture, null if taken. */
+    QSemaphore _wake;                            /**< Released when there is work. */
+    QAtomicInt _stop;                            /**< Non zero to end the thread. */
+
+    // Render thread data.
+    RenderState _state;                          /**< State being drawn. */
+    QSharedPointer<RenderScene> _listScene;      /**< Scene of the display lists. */
+    GLuint _listIndex;                           /**< First display list (faces, then face ids, per cluster). */
+    GLsizei _listCount;                          /**< Number of display lists. */
+    unsigned int _compiledClusters;              /**< Clusters whose face lists are compiled. */
+    unsigned int _compiledIdClusters;            /**< Clusters whose face id lists are compiled. */
+    bool _idsSupported;                          /**< True if the color buffer can hold face ids. */
+    qint64 _compileTime;                         /**< Time spent compiling display lists (ns). */
+    std::vector<unsigned char> _visibleClusters; /**< Clusters visible with the current camera. */
+    std::vector<double> _frameCost;              /**< Measured frame time per level (ns, 0 if unknown), full model first. */
+    LabelMesh _labelMesh;                        /**< Model colored by bookmark. */
+    Camera _depthCamera;                         /**< Camera of the last depth capture. */
+    bool _depthCaptured;                         /**< True if a depth capture was done for the current scene. */
+    bool _depthIds;                              /**< True if face ids were asked for in the last capture. */
+    QImage _statsImage;                          /**< Performance overlay, in GL format. */
+    QElapsedTimer _statsTimer;                   /**< Time since the overlay was painted. */
+
+    /**
+     * @brief Return true while the display lists of the scene are compiling.
+     */
+    bool isCompiling() const;
+
+    /**
+     * @brief Return true if face ids are asked for and fit in the color buffer.
+     */
+    bool drawsIds() const;
+
+    /**
+     * @brief Replace the display lists when the state has a new scene.
+     */
+    void updateScene();
+
+    /**
+     * @brief Compile display lists for COMPILE_BUDGET ms. Face id lists
+     * are compiled after the face lists, only when drawsIds() is true.
+     */
+    void compileDisplayLists();
+
+    /**
+     * @brief Draw the state and swap buffers.
+     */
+    void drawFrame();
+
+    /**
+     * @brief Draw the clusters visible with the state camera.
+     * @param solid True to draw the compiled faces.
+     * @param wire True to draw the unique edges, white over solid faces.
+     * @param cullBackFaces True to skip clusters completely back-facing.
+     */
+    void drawModel(bool solid, bool wire, bool cullBackFaces);
+
+    /**
+     * @brief Draw the loading preview points.
+     */
+    void drawPreview();
+
+    /**
+     * @brief Draw the performance statistics over the scene. The text is
+     * painted again every STATS_INTERVAL ms only.
+     */
+    void drawStats();
+
+    /**
+     * @brief Draw the lasso outline over the scene.
+     */
+    void drawLasso();
+
+    /**
+     * @brief Draw edge sets as thick lines over the model.
+     * @param outlines Edge sets.
+     * @param first Label of the first set, to color it. 0 for the selection color.
+     */
+    void drawOutlines(const QVector<FaceSelection> &outlines, unsigned short first);
+
+    /**
+     * @brief Render the full model filled and publish its depth buffer.
+     * When face ids are asked for, the same pass draws each face with its
+     * id as color and the color buffer is published too.
+     */
+    void captureDepth();
+
+    /**
+     * @brief Return number of faces of a level.
+     * @param level Reduced model index, -1 for the full model.
+     * @return Number of faces.
+     */
+    unsigned int levelFaces(int level) const;
+
+    /**
+     * @brief Estimate the frame time of a level from the measured ones,
+     * scaled by number of faces when the level was not measured yet.
+     * @param level Reduced model index, -1 for the full model.
+     * @return Frame time (ns), 0 if nothing was measured.
+     */
+    double estimateFrameCost(int level) const;
+
+    /**
+     * @brief Choose the finest level whose frame time fits TARGET_FRAME_TIME.
+     * @return Reduced model index, -1 for the full model.
+     */
+    int chooseLodLevel() const;
+
+protected:
+
+    /**
+     * @brief Render loop.
+     */
+    void run();
+
+public:
+
+    static const int COMPILE_BUDGET = 8;        /**< Display list compilation time per frame (ms). */
+    static const int TARGET_FRAME_TIME = 20;    /**< Frame time to keep while the camera moves (ms). */
+    static const unsigned int MAX_ID_FACES = 0xffffff;  /**< Faces that fit in a 24 bit face id (0 is background). */
+    static const int OUTLINE_WIDTH = 3;         /**< Width of outline lines (pixels). */
+    static const int STATS_INTERVAL = 250;      /**< Time between updates of the performance overlay (ms). */
+
+    /**
+     * @brief Constructor.
+     * @param widget Widget owning the GL context. Its context must not be current in the GUI thread.
+     */
+    explicit RenderThread(QGLWidget *widget);
+
+    /**
+     * @brief Destructor. The thread must be stopped.
+     */
+    ~RenderThread();
+
+    /**
+     * @brief Publish a state to draw. Never blocks. A state not drawn yet is replaced.
+     * @param state State to draw, owned by the render thread from now.
+     */
+    void publish(RenderState *state);
+
+    /**
+     * @brief Take the latest depth capture.
+     * @return Depth capture owned by caller, null if there is none.
+     */
+    DepthFrame* takeDepthFrame();
+
+    /**
+     * @brief Ask the render loop to end. Use wait() to join it.
+     */
+    void stop();
+
+signals:
+
+    /**
+     * @brief A depth capture can be taken.
+     */
+    void depthReady();
+
+    /**
+     * @brief All display lists of the current scene are compiled.
+     */
+    void sceneCompiled();
+
+};
+
+#endif // RENDERTHREAD_H
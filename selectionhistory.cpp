@@ -0,0 +1,117 @@
+#include "selectionhistory.h"
+
+SelectionHistory::SelectionHistory()
+{
+    _position = 0;
+    _memory = 0;
+}
+
+void SelectionHistory::clear()
+{
+    _steps.clear();
+    _position = 0;
+    _memory = 0;
+    _open.added.clear();
+    _open.removed.clear();
+}
+
+void SelectionHistory::record(const FaceSelection &faces, FaceSelection &forward, FaceSelection &backward)
+{
+    // A face removed and added back by the same edit is not a change.
+    FaceSelection cancelled = faces;
+    cancelled.intersect(backward);
+    backward.subtract(cancelled);
+
+    FaceSelection changes = faces;
+    forward.unite(changes.subtract(cancelled));
+}
+
+void SelectionHistory::added(const FaceSelection &faces)
+{
+    record(faces, _open.added, _open.removed);
+}
+
+void SelectionHistory::removed(const FaceSelection &faces)
+{
+    record(faces, _open.removed, _open.added);
+}
+
+void SelectionHistory::changed(const FaceSelection &before, const FaceSelection &after)
+{
+    FaceSelection faces = after;
+    added(faces.subtract(before));
+
+    faces = before;
+    removed(faces.subtract(after));
+}
+
+bool SelectionHistory::commit()
+{
+    if ( _open.added.isEmpty() && _open.removed.isEmpty() )
+        return false;
+
+    // A new edit drops the steps that could be redone.
+    while ( _steps.size() > _position )
+    {
+        _memory -= _steps.back().memory;
+        _steps.pop_back();
+    }
+
+    _open.memory = _open.added.memoryUsage() + _open.removed.memoryUsage();
+    _steps.push_back(_open);
+    _memory += _open.memory;
+    ++_position;
+
+    _open.added.clear();
+    _open.removed.clear();
+
+    // Oldest steps go first, the last one is always kept.
+    while ( _steps.size() > 1 && (_steps.size() > MAX_STEPS || _memory > MAX_MEMORY) )
+    {
+        _memory -= _steps.front().memory;
+        _steps.pop_front();
+        --_position;
+    }
+
+    return true;
+}
+
+bool SelectionHistory::canUndo() const
+{
+    return _position > 0 || !_open.added.isEmpty() || !_open.removed.isEmpty();
+}
+
+bool SelectionHistory::canRedo() const
+{
+    return _position < _steps.size() && _open.added.isEmpty() && _open.removed.isEmpty();
+}
+
+bool SelectionHistory::undo(FaceSelection *selection)
+{
+    commit();
+    if ( _position == 0 )
+        return false;
+
+    --_position;
+    const Step &step = _steps[_position];
+    selection->subtract(step.added);
+    selection->unite(step.removed);
+    return true;
+}
+
+bool SelectionHistory::redo(FaceSelection *selection)
+{
+    if ( !canRedo() )
+        return false;
+
+    const Step &step = _steps[_position];
+    selection->subtract(step.removed);
+    selection->unite(step.added);
+    ++_position;
+    return true;
+}
+
+unsigned int SelectionHistory::memoryUsage() const
+{
+    return _memory;
+}
@@ -0,0 +1,134 @@
+#ifndef SELECTIONHISTORY_H
+#define SELECTIONHISTORY_H
+
+#include <deque>
+#include "faceselection.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The SelectionHistory class is the undo/redo stack of selection edits.
+ * Each step keeps only the faces a stroke added and removed, as
+ * compressed selections, so undoing a step costs the size of that step
+ * and not the size of the selection. Faces changed by the stroke in
+ * progress are recorded in an open step, closed by commit(). The oldest
+ * steps are dropped when the history exceeds MAX_STEPS or MAX_MEMORY.
+ */
+class SelectionHistory
+{
+private:
+
+    /**
+     * @brief Faces changed by a selection edit.
+     */
+    struct Step
+    {
+        FaceSelection added;      /**< Faces not selected before the edit. */
+        FaceSelection removed;    /**< Faces selected before the edit. */
+        unsigned int memory;      /**< Memory used by both selections. */
+    };
+
+    std::deque<Step> _steps;      /**< Committed steps, oldest first. */
+    unsigned int _position;       /**< Steps done, the ones after it can be redone. */
+    unsigned int _memory;         /**< Memory used by the committed steps. */
+    Step _open;                   /**< Step of the edit in progress. */
+
+    /**
+     * @brief Record faces changed by the edit in progress.
+     * @param faces Faces changed.
+     * @param forward Changes of the same kind as faces.
+     * @param backward Changes of the opposite kind, cancelled by faces.
+     */
+    static void record(const FaceSelection &faces, FaceSelection &forward, FaceSelection &backward);
+
+public:
+
+    static const unsigned int MAX_STEPS = 256;                 /**< Maximum number of steps kept. */
+    static const unsigned int MAX_MEMORY = 64 * 1024 * 1024;   /**< Maximum memory of the steps kept (bytes). */
+
+    /**
+     * @brief Default constructor. Empty history.
+     */
+    SelectionHistory();
+
+    /**
+     * @brief Drop all steps, including the open one.
+     */
+    void clear();
+
+    /**
+     * @brief Record faces just added to the selection by the edit in progress.
+     * @param faces Faces added, none of them was selected.
+     */
+    void added(const FaceSelection &faces);
+
+    /**
+     * @brief Record faces just removed from the selection by the edit in progress.
+     * @param faces Faces removed, all of them were selected.
+     */
+    void removed(const FaceSelection &faces);
+
+    /**
+     * @brief Record the edit in progress as the difference of two selections.
+     * @param before Selection before the change.
+     * @param after Selection after the change.
+     */
+    void changed(const FaceSelection &before, const FaceSelection &after);
+
+    /**
+     * @brief Close the edit in progress. Steps that could be redone are dropped.
+     * @return True if the edit changed any face, false otherwise.
+     */
+    bool commit();
+
+    /**
+     * @brief Get if there is a step to undo.
+     * @return True if undo is possible, false otherwise.
+     */
+    bool canUndo() const;
+
+    /**
+     * @brief Get if there is a step to redo.
+     * @return True if redo is possible, false otherwise.
+     */
+    bool canRedo() const;
+
+    /**
+     * @brief Revert the last step done. The edit in progress is committed first.
+     * @param selection Selection to modify.
+     * @return True if a step was reverted, false otherwise.
+     */
+    bool undo(FaceSelection *selection);
+
+    /**
+     * @brief Apply again the last step reverted.
+     * @param selection Selection to modify.
+     * @return True if a step was applied, false otherwise.
+     */
+    bool redo(FaceSelection *selection);
+
+    /**
+     * @brief Return the memory used by the committed steps.
+     * @return Size in bytes.
+     */
+    unsigned int memoryUsage() const;
+
+};
+
+#endif // SELECTIONHISTORY_H
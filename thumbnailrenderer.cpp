@@ -0,0 +1,210 @@
+#include "thumbnailrenderer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <float.h>
+#include <QDir>
+#include <QImage>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include "glscene.h"
+
+#ifdef HAVE_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+/**
+ * @brief Runs a ThumbnailRenderer worker loop in the thread pool.
+ */
+class ThumbnailWorker : public QRunnable
+{
+private:
+
+    ThumbnailRenderer *_renderer;
+
+public:
+
+    ThumbnailWorker(ThumbnailRenderer *renderer) : _renderer(renderer) { }
+
+    void run()
+    {
+        _renderer->renderWorker();
+    }
+};
+
+ThumbnailRenderer::ThumbnailRenderer(Model *model, BookmarkList *bookmarkList)
+{
+    _model = model;
+    _bookmarkList = bookmarkList;
+    _size = 512;
+    _threads = QThread::idealThreadCount();
+}
+
+void ThumbnailRenderer::setSize(int size)
+{
+    _size = std::max(1, std::min(size, MAX_SIZE));
+}
+
+void ThumbnailRenderer::setThreads(int threads)
+{
+    _threads = threads > 0 ? threads : 1;
+}
+
+bool ThumbnailRenderer::isAvailable()
+{
+#ifdef HAVE_OSMESA
+    return true;
+#else
+    return false;
+#endif
+}
+
+int ThumbnailRenderer::render(QString outputPath)
+{
+    if ( !isAvailable() )
+    {
+        std::cerr << "Error: Offscreen rendering not available. Build with CONFIG+=osmesa." << std::endl;
+        return -1;
+    }
+
+    _outputPath = outputPath;
+    QDir().mkpath(_outputPath);
+
+    _next.fetchAndStoreOrdered(1);      // Skip 'None' bookmark.
+    _written.fetchAndStoreOrdered(0);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(_threads);
+    for ( int i = 0; i < _threads; ++i )
+        pool.start(new ThumbnailWorker(this));
+    pool.waitForDone();
+
+    return _written.fetchAndAddOrdered(0);
+}
+
+bool ThumbnailRenderer::frameBookmark(Bookmark *bookmark, Camera *camera)
+{
+    FaceSelection *faces = bookmark->getFaces();
+    if ( faces->isEmpty() )
+        return false;
+
+    float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    float normal[3] = { 0.0f, 0.0f, 0.0f };
+
+    FaceSelection::const_iterator it = faces->begin();
+    for ( ; it != faces->end(); ++it )
+    {
+        Poly *poly = _model->getPolyAt(*it);
+        for ( int j = 0; j < poly->size(); ++j )
+        {
+            Vertex *vertex = _model->getVertexAt(poly->getAt(j));
+            float p[3] = { vertex->getX(), vertex->getY(), vertex->getZ() };
+            for ( int k = 0; k < 3; ++k )
+            {
+                min[k] = std::min(min[k], p[k]);
+                max[k] = std::max(max[k], p[k]);
+            }
+            normal[0] += vertex->getNormalX();
+            normal[1] += vertex->getNormalY();
+            normal[2] += vertex->getNormalZ();
+        }
+    }
+
+    float center[3], radius = 0.0f;
+    for ( int k = 0; k < 3; ++k )
+    {
+        center[k] = (min[k] + max[k]) / 2.0f;
+        radius += (max[k] - center[k]) * (max[k] - center[k]);
+    }
+    radius = sqrt(radius);
+    if ( radius <= 0.0f )
+        radius = _model->getSize() / 100.0f;
+
+    camera->setViewportSize(_size, _size);
+    camera->frame(center, radius, normal);
+
+    return true;
+}
+
+QString ThumbnailRenderer::imagePath(unsigned int index)
+{
+    QString name = _bookmarkList->getAt(index)->getName();
+    for ( int i = 0; i < name.length(); ++i )
+        if ( !name[i].isLetterOrNumber() )
+            name[i] = '_';
+
+    return QDir(_outputPath).filePath(QString("%1_%2.png").arg(index, 4, 10, QChar('0')).arg(name));
+}
+
+void ThumbnailRenderer::renderWorker()
+{
+#ifdef HAVE_OSMESA
+    OSMesaContext context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+    if ( !context )
+    {
+        std::cerr << "Error: Unable to create OSMesa context." << std::endl;
+        return;
+    }
+
+    std::vector<unsigned char> buffer(_size * _size * 4);
+    if ( !OSMesaMakeCurrent(context, &buffer[0], GL_UNSIGNED_BYTE, _size, _size) )
+    {
+        std::cerr << "Error: Unable to activate OSMesa context." << std::endl;
+        OSMesaDestroyContext(context);
+        return;
+    }
+
+    // Same state as the viewer.
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    GLScene::initialize();
+
+    GLuint modelList = glGenLists(1);
+    glNewList(modelList, GL_COMPILE);
+        glColor3f(0.44, 0.6, 0.95);   // Set model color.
+        for ( unsigned int i = 0; i < _model->numPoly(); ++i )
+            GLScene::drawPoly( _model, _model->getPolyAt(i), false );
+    glEndList();
+
+    int index;
+    while ( (index = _next.fetchAndAddOrdered(1)) < _bookmarkList->size() )
+    {
+        Bookmark *bookmark = _bookmarkList->getAt(index);
+        Camera camera;
+        if ( !frameBookmark(bookmark, &camera) )
+            continue;
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        GLScene::loadCamera(camera);
+
+        // Highlighted faces first, as in the viewer.
+        glColor3f(0.5, 1.0, 0.5);
+        FaceSelection::const_iterator it = bookmark->getFaces()->begin();
+        for ( ; it != bookmark->getFaces()->end(); ++it )
+            GLScene::drawPoly( _model, _model->getPolyAt(*it), false );
+
+        glCallList(modelList);
+        glFinish();
+
+        // OSMesa rows start at the bottom.
+        QImage image(_size, _size, QImage::Format_RGB32);
+        for ( int y = 0; y < _size; ++y )
+        {
+            const unsigned char *source = &buffer[(_size - 1 - y) * _size * 4];
+            QRgb *target = (QRgb *)image.scanLine(y);
+            for ( int x = 0; x < _size; ++x )
+                target[x] = qRgb(source[x*4], source[x*4 + 1], source[x*4 + 2]);
+        }
+
+        if ( image.save(imagePath(index), "PNG") )
+            _written.fetchAndAddOrdered(1);
+        else
+            std::cerr << "Error: Unable to write " << imagePath(index).toStdString() << std::endl;
+    }
+
+    glDeleteLists(modelList, 1);
+    OSMesaDestroyContext(context);
+#endif
+}
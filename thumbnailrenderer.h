@@ -0,0 +1,108 @@
+#ifndef THUMBNAILRENDERER_H
+#define THUMBNAILRENDERER_H
+
+#include <vector>
+#include <QAtomicInt>
+#include <QString>
+#include "model.h"
+#include "camera.h"
+#include "bookmarklist.h"
+
+/**
+ * This source file is part of 3DMarker.
+ * @author Jose Manuel Rabasco de Damas (rabasco@gmail.com)
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * 3DMarker is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 3, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * The ThumbnailRenderer class renders one PNG image per bookmark without
+ * a window, using OSMesa software contexts. Each bookmark is highlighted
+ * as in the viewer and framed on its bounds, looking against its mean
+ * normal. Several worker threads, each one with its own context, share
+ * the bookmark list. Needs a build with CONFIG+=osmesa.
+ */
+class ThumbnailRenderer
+{
+    friend class ThumbnailWorker;
+
+private:
+
+    Model *_model;                  /**< Model to render. */
+    BookmarkList *_bookmarkList;    /**< Bookmarks to render. */
+    QString _outputPath;            /**< Output directory. */
+    int _size;                      /**< Image size in pixels. */
+    int _threads;                   /**< Number of worker contexts. */
+    QAtomicInt _next;               /**< Next bookmark to render. */
+    QAtomicInt _written;            /**< Number of images written. */
+
+    /**
+     * @brief Worker loop: create a context and render bookmarks until none is left.
+     */
+    void renderWorker();
+
+    /**
+     * @brief Compute the camera framing a bookmark.
+     * @param bookmark Bookmark to frame.
+     * @param camera Result camera.
+     * @return False if bookmark has no faces.
+     */
+    bool frameBookmark(Bookmark *bookmark, Camera *camera);
+
+    /**
+     * @brief Return the image path of a bookmark.
+     * @param index Bookmark index.
+     * @return Image path.
+     */
+    QString imagePath(unsigned int index);
+
+public:
+
+    static const int MAX_SIZE = 8192;   /**< Maximum image size in pixels. */
+
+    /**
+     * @brief Constructor.
+     * @param model Model to render.
+     * @param bookmarkList Bookmarks to render.
+     */
+    ThumbnailRenderer(Model *model, BookmarkList *bookmarkList);
+
+    /**
+     * @brief Set image size, clamped to 1..MAX_SIZE.
+     * @param size Image width and height in pixels.
+     */
+    void setSize(int size);
+
+    /**
+     * @brief Set number of worker contexts.
+     * @param threads Number of workers.
+     */
+    void setThreads(int threads);
+
+    /**
+     * @brief Get if offscreen rendering was built in.
+     * @return True if available, false otherwise.
+     */
+    static bool isAvailable();
+
+    /**
+     * @brief Render all bookmarks (except 'None').
+     * @param outputPath Output directory.
+     * @return Number of images written, or -1 if rendering is not available.
+     */
+    int render(QString outputPath);
+
+};
+
+#endif // THUMBNAILRENDERER_H